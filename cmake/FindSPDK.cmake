@@ -15,7 +15,20 @@ endif()
 
 # Needed to ensure that PKG_CONFIG also looks at our SPDK installation.
 message("Looking for SPDK packages...")
-pkg_search_module(SPDK REQUIRED IMPORTED_TARGET spdk_nvme)
+pkg_check_modules(SPDK REQUIRED IMPORTED_TARGET spdk_nvme)
+# The bdev layer and the bdevs that can be zoned without an SSD (szd_open_bdev).
+if (SZD_BDEV)
+    pkg_check_modules(SPDK_BDEV IMPORTED_TARGET spdk_init spdk_event_bdev
+        spdk_bdev_malloc spdk_bdev_aio spdk_bdev_zone_block)
+    if (SPDK_BDEV_FOUND)
+        list(APPEND SPDK_LINK_LIBRARIES ${SPDK_BDEV_LINK_LIBRARIES})
+        list(REMOVE_DUPLICATES SPDK_LINK_LIBRARIES)
+        list(APPEND SPDK_INCLUDE_DIRS ${SPDK_BDEV_INCLUDE_DIRS})
+    else()
+        message(WARNING "SPDK bdev modules not found, building without szd_open_bdev")
+        set(SZD_BDEV OFF)
+    endif()
+endif()
 pkg_search_module(DPDK REQUIRED IMPORTED_TARGET spdk_env_dpdk)
 pkg_search_module(SYS REQUIRED IMPORTED_TARGET spdk_syslibs)
 set(ENV{PKG_CONFIG_LIBDIR} "${TMP_PKG_CONFIG_LIBDIR}")
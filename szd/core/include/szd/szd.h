@@ -42,6 +42,7 @@
 #include "szd/szd_status_code.h"
 
 #include <pthread.h>
+#include <sys/uio.h>
 
 #ifdef SZD_USDT
 #include <sys/sdt.h>
@@ -68,6 +69,7 @@ typedef struct spdk_nvme_zns_ns_data t_spdk_nvme_zns_ns_data;
 typedef struct spdk_nvme_ns_data t_spdk_nvme_ns_data;
 typedef struct spdk_nvme_zns_ctrlr_data t_spdk_nvme_zns_ctrlr_data;
 typedef struct spdk_nvme_ctrlr_data t_spdk_nvme_ctrlr_data;
+typedef struct spdk_nvme_zns_zone_desc t_spdk_nvme_zns_zone_desc;
 
 #ifdef __cplusplus
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
@@ -75,13 +77,30 @@ namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 
 #define MAX_TRADDR_LENGTH 0x100
 #define MAX_DEVICE_COUNT 0x100
+#define MAX_PIPELINE_DEPTH 0x40
+#define DEFAULT_PIPELINE_DEPTH 0x8
+#define MAX_CALLBACK_REQUESTS 0x100
+#define MAX_GROUP_DEVICES 0x10
+#define SZD_SOCKET_ID_ANY (-1)        /**< No NUMA preference, as SPDK.*/
+#define SZD_DMA_POOL_MAX_CLASSES 0x20 /**< Size classes of a DMA pool.*/
+#define SZD_DMA_CACHE_SIZE 0x8        /**< Kept by a cache of each class.*/
+#define SZD_DMA_CACHE_BATCH 0x4       /**< Moved between cache and pool.*/
+#define SZD_DMA_POOL_DEPOT 0x20       /**< Kept by a pool of each class.*/
+#define SZD_WAIT_SPIN_NS 0x2000       /**< Spin this long before yielding.*/
+#define SZD_WAIT_MIN_SLEEP_NS 0x4000  /**< Shorter sleeps are not worth it.*/
+#define SZD_WAIT_EWMA_SHIFT 3         /**< Weight of a new sample is 1/8.*/
+#define SZD_EMU_MEM_SIZE_MB 0x400     /**< SPDK memory, emulated devices.*/
 
 /**
  * @brief Options to pass to the ZNS device on initialisation.
  */
 typedef struct {
-  const char *name;      /**< Name used by SPDK to identify application. */
-  const bool setup_spdk; /**< Set to false during reset. */
+  const char *name;        /**< Name used by SPDK to identify application. */
+  const bool setup_spdk;   /**< Set to false during reset. */
+  const bool emulated;     /**< Only emulated devices are used (szd_open_emu),
+                              SPDK is set up without hugepages and PCI. */
+  const char *bdev_config; /**< SPDK JSON config with the bdevs to create for
+                              szd_open_bdev, NULL skips the bdev layer. */
 } DeviceOptions;
 extern const DeviceOptions DeviceOptions_default;
 
@@ -95,6 +114,62 @@ typedef struct {
 } DeviceOpenOptions;
 extern const DeviceOpenOptions DeviceOpenOptions_default;
 
+/**
+ * @brief Geometry of an emulated device, see szd_open_emu.
+ */
+typedef struct {
+  uint64_t lba_size;         /**< Size of one lba in bytes, a power of 2.*/
+  uint64_t zone_size;        /**< Size of one zone in lbas.*/
+  uint64_t zone_cap;         /**< Writable lbas of each zone.*/
+  uint64_t nr_zones;         /**< Zones of the device.*/
+  uint64_t mdts;             /**< Maximum data transfer size in bytes.*/
+  uint64_t zasl;             /**< Maximum size of one append in bytes.*/
+  uint32_t max_open_zones;   /**< 0 is unlimited.*/
+  uint32_t max_active_zones; /**< 0 is unlimited.*/
+  const char *path; /**< File that holds the device, data and zone states
+                       survive a close. NULL keeps the device in memory.*/
+} EmuOptions;
+extern const EmuOptions EmuOptions_default;
+
+/**
+ * @brief What executes the commands of a device.
+ */
+typedef enum {
+  SZD_BACKEND_NVME = 0, /**< An NVMe ZNS namespace, through SPDK.*/
+  SZD_BACKEND_EMU = 1,  /**< A zoned namespace emulated in memory.*/
+  SZD_BACKEND_BDEV = 2, /**< A zoned SPDK bdev, through the bdev layer.*/
+} DeviceBackend;
+
+/**
+ * @brief Options to pick when creating a QPair, 0 picks the SPDK default.
+ */
+typedef struct {
+  uint32_t io_queue_size;     /**< Entries in the submission queue, at most
+                                 the maximum queue size of the controller.*/
+  uint32_t io_queue_requests; /**< Requests that can be outstanding, queued
+                                 in software once the submission queue is
+                                 full. At least io_queue_size.*/
+  bool delay_cmd_submit;      /**< Ring the doorbell once per poll instead
+                                 of once per submitted command.*/
+} QPairOptions;
+extern const QPairOptions QPairOptions_default;
+
+/**
+ * @brief Options of the transport a device is opened over (PCIe, RDMA, TCP),
+ * see szd_open_transport. 0 picks the SPDK default of the transport.
+ */
+typedef struct {
+  QPairOptions qpair;             /**< Used by szd_create_qpair on the device,
+                                     the controller is connected with room for
+                                     queues of this size.*/
+  uint32_t keep_alive_timeout_ms; /**< Fabrics only.*/
+  uint8_t transport_retry_count;  /**< Fabrics only, retries of RDMA and TCP.*/
+  uint64_t connect_timeout_us;    /**< Fabrics only, of the connect command.*/
+  bool header_digest;             /**< TCP only, CRC32C of PDU headers.*/
+  bool data_digest;               /**< TCP only, CRC32C of PDU data.*/
+} TransportOptions;
+extern const TransportOptions TransportOptions_default;
+
 /**
  * @brief Holds general information about a ZNS device.
  */
@@ -102,7 +177,8 @@ typedef struct {
   uint64_t
       lba_size; /**< Size of one block, also known as logical block address.*/
   uint64_t zone_size; /**<  Size of one zone in lbas.*/
-  uint64_t zone_cap;  /**< Size of user availabe space in one zone. */
+  uint64_t zone_cap;  /**< Size of user availabe space in the first zone,
+                         zones can differ (see szd_get_zone_cap_prefix). */
   uint64_t mdts;      /**<  Maximum data transfer size in bytes.*/
   uint64_t zasl;      /**<  Maximum size of one append command in bytes.*/
   uint64_t lba_cap;   /**<  Amount of lbas available on the device.*/
@@ -112,28 +188,115 @@ typedef struct {
 } DeviceInfo;
 extern const DeviceInfo DeviceInfo_default;
 
+/**
+ * @brief State of a zone, values are equal to the ZNS zone states.
+ */
+typedef enum {
+  SZD_ZONE_EMPTY = 0x1,
+  SZD_ZONE_IMPLICIT_OPEN = 0x2,
+  SZD_ZONE_EXPLICIT_OPEN = 0x3,
+  SZD_ZONE_CLOSED = 0x4,
+  SZD_ZONE_READ_ONLY = 0xD,
+  SZD_ZONE_FULL = 0xE,
+  SZD_ZONE_OFFLINE = 0xF
+} ZoneState;
+
+/**
+ * @brief Information of one zone as reported by the device.
+ */
+typedef struct {
+  uint64_t zslba;  /**< Starting lba of the zone.*/
+  uint64_t zcap;   /**< Capacity of the zone in lbas.*/
+  uint64_t wp;     /**< Write pointer, not valid for full zones.*/
+  ZoneState state; /**< State of the zone.*/
+} ZoneDescriptor;
+
+/**
+ * @brief Range of lbas to copy, see szd_copy.
+ */
+typedef struct {
+  uint64_t slba; /**< First lba, the range skips the end of zones as reads.*/
+  uint64_t nlb;  /**< Number of lbas in the range.*/
+} CopyRange;
+
 /**
  * @brief Do not touch, is to be used by Device Manager only
  */
 typedef struct {
   uint64_t zone_min_;
   uint64_t zone_max_;
+  // Zone state table for zones [zone_min_, zone_max_), kept up to date by
+  // completions of appends, resets and finishes.
+  uint64_t *zone_wp_;   /**< Write pointer of each zone.*/
+  uint64_t *zone_cap_;  /**< Capacity of each zone.*/
+  uint8_t *zone_state_; /**< ZoneState of each zone.*/
+  // Prefix sums of zone_cap_ (one extra entry), start of each zone when zones
+  // are placed back to back without the gap between capacity and size.
+  uint64_t *zone_cap_prefix_;
+  // Members of a device group (0 and NULL for one device). Zone z of the group
+  // is zone z / group_size_ of member z % group_size_.
+  uint32_t group_size_;
+  struct DeviceManager **group_;
+  QPairOptions qpair_options_; /**< Used by szd_create_qpair.*/
+  // QPair that seeded the zone state table at open, it is handed out by the
+  // first szd_create_qpair if that asks for qpair_options_ and destroyed
+  // otherwise. Until then (or close) it holds one I/O queue of the device.
+  void *spare_qpair_;
 } DeviceManagerInternal;
 extern const DeviceManagerInternal DeviceManagerInternal_default;
 
 /**
- * @brief General structure that aids in managing one ZNS namespace.
- * The core structure in SimpleZnsDevice.
+ * @brief General structure that aids in managing one ZNS namespace, or a
+ * group of them (see szd_open_group). The core structure in SimpleZnsDevice.
  */
-typedef struct {
+typedef struct DeviceManager {
   t_spdk_nvme_transport_id
       *g_trid;              /**< transport id used to communicate with SSD*/
   t_spdk_nvme_ctrlr *ctrlr; /**< Controller of the selected SSD*/
   t_spdk_nvme_ns *ns;       /**< Selected namespace of the selected SSD*/
   DeviceInfo info;          /**< Information of selected SSD*/
+  DeviceBackend backend;    /**< Backend of the opened device.*/
   void *private_;           /**< To be used by SZD only */
+  void *backend_;           /**< To be used by SZD only */
 } DeviceManager;
 
+/**
+ * @brief How synchronous calls wait on the device.
+ */
+typedef enum {
+  SZD_WAIT_SPIN = 0,       /**< Busy poll, lowest latency (default).*/
+  SZD_WAIT_SPIN_YIELD = 1, /**< Busy poll, yield the core when it takes long.*/
+  SZD_WAIT_HYBRID = 2,     /**< Sleep for half of the expected latency of the
+                              operation, then as SZD_WAIT_SPIN_YIELD.*/
+} WaitPolicy;
+
+/**
+ * @brief Operations that are waited on, each has its own expected latency.
+ */
+typedef enum {
+  SZD_WAIT_OP_READ = 0,
+  SZD_WAIT_OP_APPEND,
+  SZD_WAIT_OP_RESET,
+  SZD_WAIT_OP_FINISH,
+  SZD_WAIT_OP_REPORT,
+  SZD_WAIT_OP_ASYNC, /**< szd_poll_async, operation unknown.*/
+  SZD_WAIT_OP_COUNT
+} WaitOp;
+
+/**
+ * @brief Counters of the wait policy of one QPair. Not updated with
+ * SZD_WAIT_SPIN, spinning costs nothing to count.
+ */
+typedef struct {
+  uint64_t waits;            /**< Synchronous waits.*/
+  uint64_t sleeps;           /**< Sleeps done by SZD_WAIT_HYBRID.*/
+  uint64_t yields;           /**< Yields of the core.*/
+  uint64_t saved_ns;         /**< Time slept or yielded, CPU time saved.*/
+  uint64_t added_latency_ns; /**< Estimated latency added, half of each sleep
+                                or yield that a completion arrived in.*/
+  uint64_t ewma_ns[SZD_WAIT_OP_COUNT]; /**< Observed latency of each op.*/
+} WaitStats;
+
 /**
  * @brief Thread unsafe I/O channel.
  * Can be used for writing and reading of data.
@@ -141,8 +304,28 @@ typedef struct {
 typedef struct {
   t_spdk_nvme_qpair *qpair; /**< internal I/O channel */
   DeviceManager *man;       /**< Manager of the channel*/
+  QPairOptions options;     /**< Options in use, without SPDK defaults.*/
+  void *cb_requests_; /**< Do not touch, requests of the callback API.*/
+  t_spdk_nvme_qpair **group_qpairs_; /**< Do not touch, one qpair for each
+                                        member of a device group.*/
+  uint32_t group_size_;              /**< Do not touch, members of the group.*/
+  WaitPolicy wait_policy_; /**< Do not touch, see szd_set_wait_policy.*/
+  WaitStats wait_stats_;   /**< Do not touch, see szd_get_wait_stats.*/
+  void *backend_qpair_;    /**< Do not touch, qpair of other backends.*/
+  void **group_backend_qpairs_; /**< Do not touch, qpairs of the members of
+                                   an emulated device group.*/
 } QPair;
 
+/**
+ * @brief Called once for each request submitted with a callback, from within
+ * a poll on the QPair that submitted it.
+ * @param cb_arg argument given on submission.
+ * @param err 0 on success, NVMe status code otherwise (same as Completion).
+ * @param lba lba the request started at. For appends this is the lba assigned
+ * by the device.
+ */
+typedef void (*szd_completion_cb)(void *cb_arg, uint16_t err, uint64_t lba);
+
 /**
  * @brief Used for synchronous I/O calls to communicate (QPairs and their
  * callbacks).
@@ -150,6 +333,10 @@ typedef struct {
 typedef struct {
   bool done;    /**< Synchronous call is done.*/
   uint16_t err; /**< return code after call is done.*/
+  // Do not touch, used by SZD to update the zone state table on completion.
+  DeviceManager *man_; /**< Manager of the zone state table.*/
+  uint64_t slba_;      /**< (First) zone the operation targets.*/
+  uint64_t nr_;        /**< Number of lbas appended or zones reset.*/
 } Completion;
 extern const Completion Completion_default;
 
@@ -162,6 +349,7 @@ typedef struct {
   struct spdk_nvme_ctrlr **ctrlr; /**< The controller(s) of the devices.*/
   uint8_t devices;                /**< Used to identify global device count.*/
   pthread_mutex_t *mut; /**< Ensures that probe information is thread safe.*/
+  bool attached_; /**< Do not touch, controllers are still attached.*/
 } ProbeInformation;
 
 /**
@@ -173,8 +361,43 @@ typedef struct {
   const size_t traddr_len; /**< Length in bytes to check for the target id
                               (long ids).*/
   bool found;              /**< Whether the device is found or not.*/
+  const TransportOptions *transport; /**< Applied to the controller.*/
 } DeviceTarget;
 
+/**
+ * @brief Free DMA buffers of one size, linked through their first bytes.
+ */
+typedef struct {
+  void *head_;     /**< Do not touch, first free buffer.*/
+  uint32_t count_; /**< Do not touch, buffers in the list.*/
+} DMAFreeList;
+
+/**
+ * @brief Thread safe pool of DMA buffers, see szd_dma_pool_create.
+ * Buffers are handed out by DMACache.
+ */
+typedef struct {
+  uint64_t lba_size; /**< Smallest buffer, every buffer is alligned to it.*/
+  uint64_t max_size; /**< Largest pooled buffer, larger ones are not pooled.*/
+  uint32_t classes;  /**< Size classes, class c holds lba_size << c bytes.*/
+  int32_t socket_id; /**< NUMA node of all buffers.*/
+  uint32_t refs_;    /**< Do not touch, the pool and each of its caches.*/
+  bool lock_;        /**< Do not touch, protects depot_.*/
+  // Do not touch, free buffers of each class.
+  DMAFreeList depot_[SZD_DMA_POOL_MAX_CLASSES];
+} DMAPool;
+
+/**
+ * @brief Thread unsafe cache in front of a DMAPool, one for each thread.
+ * Getting and putting buffers only touches the pool when the cache of the
+ * class is empty or full.
+ */
+typedef struct {
+  DMAPool *pool; /**< Pool the buffers come from and go to.*/
+  // Do not touch, free buffers of each class.
+  DMAFreeList free_[SZD_DMA_POOL_MAX_CLASSES];
+} DMACache;
+
 /**
  * @brief inits SPDK and the general device manager, always call ONCE before
  * ANY other function is called.
@@ -202,17 +425,79 @@ int szd_reinit(DeviceManager **manager);
 int szd_probe(DeviceManager *manager, ProbeInformation **probe_info);
 
 /**
- * @brief Frees information from probe information.
+ * @brief szd_probe, but the controllers stay attached. One of them can then be
+ * opened with szd_open_probed without probing and attaching it again,
+ * szd_free_probe_information detaches the others.
+ */
+int szd_probe_attached(DeviceManager *manager, ProbeInformation **probe_info);
+
+/**
+ * @brief Frees information from probe information, detaches controllers that
+ * are still attached (szd_probe_attached).
  */
 void szd_free_probe_information(ProbeInformation *probe_info);
 
 /**
  * @brief Opens a ZNS device, provided it exists and is a ZNS device.
+ * traddr is either the PCIe address of the device or a transport ID as parsed
+ * by SPDK, for example "trtype:TCP adrfam:IPv4 traddr:127.0.0.1 trsvcid:4420
+ * subnqn:nqn.2016-06.io.spdk:cnode1" for NVMe-oF.
  * This device is then set as the current device in the manager.
  */
 int szd_open(DeviceManager *manager, const char *traddr,
              DeviceOpenOptions *options);
 
+/**
+ * @brief Opens the device at traddr that is attached by szd_probe_attached.
+ * The manager takes its controller over from probe_info.
+ */
+int szd_open_probed(DeviceManager *manager, ProbeInformation *probe_info,
+                    const char *traddr, DeviceOpenOptions *options);
+
+/**
+ * @brief szd_open with options for the transport, such as the queue sizes
+ * that suit a fabric or the digests of TCP.
+ */
+int szd_open_transport(DeviceManager *manager, const char *traddr,
+                       const TransportOptions *transport_options,
+                       DeviceOpenOptions *options);
+
+/**
+ * @brief Opens n ZNS devices as one device group (RAID-0) in the manager.
+ * Zones are interleaved across the devices, zone z of the group is zone z / n
+ * of device traddrs[z % n]. Commands to different zones can therefore be
+ * processed by different devices at the same time. All devices need the same
+ * lba and zone size; each contributes as many zones as the smallest one.
+ * Options are in zones of the group, close with szd_close.
+ */
+int szd_open_group(DeviceManager *manager, const char **traddrs, uint32_t n,
+                   DeviceOpenOptions *options);
+
+/**
+ * @brief Opens a zoned namespace that is emulated in memory (or in the file
+ * emu_options->path) instead of an SSD. It behaves as a ZNS device with the
+ * given geometry, including the open and active zone limits, and needs no
+ * hugepages, PCI device or root. Close with szd_close.
+ */
+int szd_open_emu(DeviceManager *manager, const EmuOptions *emu_options,
+                 DeviceOpenOptions *options);
+
+/**
+ * @brief szd_open_group with n emulated devices, member i is emulated with
+ * emu_options[i]. Groups can so be used without SSDs.
+ */
+int szd_open_group_emu(DeviceManager *manager, const EmuOptions *emu_options,
+                       uint32_t n, DeviceOpenOptions *options);
+
+/**
+ * @brief Opens the zoned SPDK bdev bdev_name, such as a bdev_zone_block on top
+ * of a malloc or AIO bdev. The bdev must be created by the bdev_config passed
+ * to szd_init. SZD owns the SPDK threads, it can not be used within an SPDK
+ * application. Close with szd_close.
+ */
+int szd_open_bdev(DeviceManager *manager, const char *bdev_name,
+                  DeviceOpenOptions *options);
+
 /**
  * @brief  If the manager holds a device, shut it down and free associated
  * data.
@@ -225,28 +510,114 @@ int szd_close(DeviceManager *man);
  */
 int szd_get_device_info(DeviceInfo *info, DeviceManager *manager);
 
+/**
+ * @brief Gets the NUMA node (socket) the controller of manager is attached to.
+ * Stores SZD_SOCKET_ID_ANY when it is unknown, e.g. for remote controllers.
+ * For device groups the node of the first device is used.
+ */
+int szd_get_socket_id(DeviceManager *manager, int32_t *socket_id);
+
+/**
+ * @brief Gets the NUMA node (socket) of the core the caller is running on, or
+ * SZD_SOCKET_ID_ANY if it can not be determined.
+ */
+int32_t szd_current_socket_id(void);
+
 /**
  * @brief Creates a Qpair to be used for I/O oprations
  * @param qpair, pointer to unallocated qpair pointer to be created.
  */
 int szd_create_qpair(DeviceManager *man, QPair **qpair);
 
+/**
+ * @brief Creates a Qpair to be used for I/O oprations with options.
+ * @param qpair, pointer to unallocated qpair pointer to be created.
+ * @param options, sizes of the queue and doorbell batching. The options in
+ * use, after clamping to what the controller allows, are in qpair->options.
+ */
+int szd_create_qpair_with_options(DeviceManager *man, QPair **qpair,
+                                  const QPairOptions *options);
+
 /**
  * @brief Destroys the qpair if it is still valid.
  */
 int szd_destroy_qpair(QPair *qpair);
 
+/**
+ * @brief Sets how synchronous calls on qpair wait for the device. Latencies
+ * observed earlier are kept.
+ */
+int szd_set_wait_policy(QPair *qpair, WaitPolicy policy);
+
+/**
+ * @brief Copies the counters of the wait policy of qpair to stats.
+ */
+int szd_get_wait_stats(QPair *qpair, WaitStats *stats);
+
 /**
  * @brief Custom calloc that uses DMA logic necessary for SPDK.
  * Must be alligned with the device lba_size (see DeviceInfo).
  */
 void *szd_calloc(uint64_t __allign, size_t __nmemb, size_t __size);
 
+/**
+ * @brief Same as szd_calloc, but places the memory on NUMA node socket_id.
+ * Falls back to any node if the node has no memory left.
+ */
+void *szd_calloc_socket(uint64_t __allign, size_t __nmemb, size_t __size,
+                        int32_t socket_id);
+
 /**
  * @brief Custom free that can free memory from z_calloc.
  */
 void szd_free(void *buffer);
 
+/**
+ * @brief Whether buffer can be submitted to the device of manager as is, so
+ * without copying it to memory from szd_calloc first. That is memory that SPDK
+ * can translate for DMA (szd_calloc, or registered with SPDK) and that is
+ * dword aligned. The same holds for emulated devices, although they could use
+ * any memory.
+ */
+bool szd_dma_capable(const DeviceManager *manager, const void *buffer,
+                     uint64_t size);
+
+/**
+ * @brief Creates a pool of DMA buffers from lba_size up to max_size bytes on
+ * NUMA node socket_id. Sizes are rounded up to a power of two lbas.
+ * Reusing buffers avoids the heap lock and zeroing of szd_calloc for each I/O.
+ */
+int szd_dma_pool_create(DMAPool **pool, uint64_t lba_size, uint64_t max_size,
+                        int32_t socket_id);
+
+/**
+ * @brief Releases the pool. Its memory is freed when the last cache of the
+ * pool is destroyed as well.
+ */
+int szd_dma_pool_destroy(DMAPool *pool);
+
+/**
+ * @brief Creates a cache of pool, to be used by one thread at a time.
+ */
+int szd_dma_cache_create(DMAPool *pool, DMACache **cache);
+
+/**
+ * @brief Returns all buffers in cache to its pool and frees the cache.
+ */
+int szd_dma_cache_destroy(DMACache *cache);
+
+/**
+ * @brief Gets a DMA buffer of at least size bytes from cache.
+ * @param zero whether the buffer is zeroed, reused buffers hold old data.
+ * @returns NULL when out of memory, return with szd_dma_put.
+ */
+void *szd_dma_get(DMACache *cache, uint64_t size, bool zero);
+
+/**
+ * @brief Returns buffer of size bytes (same as szd_dma_get) to cache.
+ */
+void szd_dma_put(DMACache *cache, void *buffer, uint64_t size);
+
 /**
  * @brief Reads n bytes synchronously from the ZNS device.
  * @param qpair channel to use for I/O
@@ -261,6 +632,60 @@ int szd_read(QPair *qpair, uint64_t lba, void *buffer, uint64_t size);
 int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
                        uint64_t *nr_reads);
 
+/**
+ * @brief Reads n bytes synchronously from the ZNS device, but keeps up to
+ * queue_depth MDTS-sized reads in flight at once (also across zone borders).
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to read from (can read in non-written
+ * areas)
+ * @param buffer zcalloced buffer to store the read data in.
+ * @param size Amount of data to read in bytes (lba_size alligned)
+ * @param nr_reads ptr to variable that can be used for diagnostics, can be
+ * set to NULL.
+ * @param queue_depth maximum number of outstanding reads, at most
+ * MAX_PIPELINE_DEPTH. A depth of 1 is equal to szd_read.
+ */
+int szd_read_pipelined(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                       uint32_t queue_depth);
+int szd_read_pipelined_with_diag(QPair *qpair, uint64_t lba, void *buffer,
+                                 uint64_t size, uint64_t *nr_reads,
+                                 uint32_t queue_depth);
+
+/**
+ * @brief Reads n bytes synchronously from the ZNS device into a vector of
+ * z_calloced segments, as if it was one buffer. Uses SGLs.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to read from (can read in non-written
+ * areas)
+ * @param iov zcalloced segments to store the read data in, the total size must
+ * be lba_size alligned. Same PRP rules as szd_appendv apply.
+ * @param iovcnt number of segments
+ * @param nr_reads ptr to variable that can be used for diagnostics, can be
+ * set to NULL.
+ */
+int szd_readv(QPair *qpair, uint64_t lba, const struct iovec *iov, int iovcnt);
+int szd_readv_with_diag(QPair *qpair, uint64_t lba, const struct iovec *iov,
+                        int iovcnt, uint64_t *nr_reads);
+
+/**
+ * @brief Reads n bytes asynchronously from the ZNS device.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to read from (can read in non-written
+ * areas)
+ * @param buffer zcalloced buffer to store the read data in, must remain valid
+ * till the completion is done.
+ * @param size Amount of data to read in bytes (lba_size alligned), can be at
+ * most MDTS and can not cross a zone border.
+ * @param nr_reads ptr to variable that can be used for diagnostics, can be
+ * set to NULL.
+ * @param completion can be used to poll for completion later on (sync)
+ */
+int szd_read_async(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                   Completion *completion);
+int szd_read_async_with_diag(QPair *qpair, uint64_t lba, void *buffer,
+                             uint64_t size, uint64_t *nr_reads,
+                             Completion *completion);
+
 /**
  * @brief Append z_calloced data synchronously to a zone.
  * @param qpair channel to use for I/O
@@ -275,6 +700,70 @@ int szd_append(QPair *qpair, uint64_t *lba, void *buffer, uint64_t size);
 int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
                          uint64_t size, uint64_t *nr_appends);
 
+/**
+ * @brief Append z_calloced data synchronously to a zone, but keep up to
+ * queue_depth ZASL-sized appends in flight at once. lba is only updated after
+ * all appends completed. The device is free to reorder the appends, therefore
+ * each completion is verified to land at its expected address and a reordered
+ * append is reported as an error.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to write to (UNVERIFIED, but must equal
+ * write_head of zone), will be updated after all writes completed. On an error
+ * it is moved past the appends that landed in order before the first failed
+ * (or reordered) one.
+ * @param buffer zcalloced data
+ * @param size size of buffer
+ * @param nr_appends ptr to variable that can be used for diagnostics, can be
+ * set to NULL.
+ * @param queue_depth maximum number of outstanding appends, at most
+ * MAX_PIPELINE_DEPTH. A depth of 1 is equal to szd_append.
+ */
+int szd_append_pipelined(QPair *qpair, uint64_t *lba, void *buffer,
+                         uint64_t size, uint32_t queue_depth);
+int szd_append_pipelined_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
+                                   uint64_t size, uint64_t *nr_appends,
+                                   uint32_t queue_depth);
+
+/**
+ * @brief Append a vector of z_calloced segments synchronously to a zone, as if
+ * it was one buffer. Uses SGLs so that the segments do not need to be copied.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to write to (UNVERIFIED, but must equal
+ * write_head of zone), will be updated after each succesful write.
+ * @param iov zcalloced segments, the total size must be lba_size alligned. If
+ * the controller does not support SGLs, segments must follow PRP rules (only
+ * the first segment may start and only the last may end unalligned to a page).
+ * @param iovcnt number of segments
+ * @param nr_appends ptr to variable that can be used for diagnostics, can be
+ * set to NULL.
+ */
+int szd_appendv(QPair *qpair, uint64_t *lba, const struct iovec *iov,
+                int iovcnt);
+int szd_appendv_with_diag(QPair *qpair, uint64_t *lba, const struct iovec *iov,
+                          int iovcnt, uint64_t *nr_appends);
+
+/**
+ * @brief Whether the device can copy data by itself with NVMe Copy. Never for
+ * device groups, data can not move between their devices.
+ */
+bool szd_copy_supported(DeviceManager *manager);
+
+/**
+ * @brief Copies ranges of lbas synchronously to a zone, in order and as if
+ * they were appended. If the device supports it (see szd_copy_supported), the
+ * data does not leave the device. Otherwise it is read and appended back.
+ * @param qpair channel to use for I/O
+ * @param ranges ranges to copy, may not overlap the zone that is written to.
+ * @param n number of ranges
+ * @param lba logical block address to write to (must equal write_head of
+ * zone), will be updated after each succesful write.
+ * @param nr_copies ptr to variable that can be used for diagnostics, can be
+ * set to NULL. Counts copies, or appends if copies are not supported.
+ */
+int szd_copy(QPair *qpair, const CopyRange *ranges, uint32_t n, uint64_t *lba);
+int szd_copy_with_diag(QPair *qpair, const CopyRange *ranges, uint32_t n,
+                       uint64_t *lba, uint64_t *nr_copies);
+
 /**
  * @brief Append z_calloced data asynchronously to a zone.
  * @param qpair channel to use for I/O
@@ -291,6 +780,64 @@ int szd_append_async(QPair *qpair, uint64_t *lba, void *buffer, uint64_t size,
 int szd_append_async_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
                                uint64_t size, uint64_t *nr_appends,
                                Completion *completion);
+/**
+ * @brief Reads asynchronously and calls cb from a poll when done, instead of
+ * setting a Completion. Same restrictions as szd_read_async. Requests are taken
+ * from a pool of MAX_CALLBACK_REQUESTS for each QPair, no memory is allocated
+ * on the I/O path.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to read from
+ * @param buffer zcalloced buffer, must remain valid till cb is called.
+ * @param size Amount of data to read in bytes (lba_size alligned), can be at
+ * most MDTS and can not cross a zone border.
+ * @param cb called when the read is done
+ * @param cb_arg passed to cb
+ * @return SZD_SC_SPDK_ERROR_QPAIR when all requests are in use or the queue
+ * is full, poll and try again.
+ */
+int szd_read_async_cb(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                      szd_completion_cb cb, void *cb_arg);
+
+/**
+ * @brief Appends asynchronously and calls cb from a poll when done, instead of
+ * setting a Completion. Same restrictions as szd_append_async, the lba passed
+ * to cb is where the device placed the data.
+ * @param qpair channel to use for I/O
+ * @param lba logical block address to write to (UNVERIFIED, but must equal
+ * write_head of zone), will be updated after a succesful submission.
+ * @param buffer zcalloced data, must remain valid till cb is called.
+ * @param size size of buffer, at most ZASL and can not cross a zone border.
+ * @param cb called when the append is done
+ * @param cb_arg passed to cb
+ * @return SZD_SC_SPDK_ERROR_QPAIR when all requests are in use or the queue
+ * is full, poll and try again.
+ */
+int szd_append_async_cb(QPair *qpair, uint64_t *lba, void *buffer,
+                        uint64_t size, szd_completion_cb cb, void *cb_arg);
+
+/**
+ * @brief Resets or finishes a zone asynchronously and calls cb from a poll
+ * when done.
+ * @param qpair channel to use for I/O
+ * @param slba starting logical block address of the zone
+ * @param cb called when the reset/finish is done
+ * @param cb_arg passed to cb
+ */
+int szd_reset_async_cb(QPair *qpair, uint64_t slba, szd_completion_cb cb,
+                       void *cb_arg);
+int szd_finish_zone_async_cb(QPair *qpair, uint64_t slba, szd_completion_cb cb,
+                             void *cb_arg);
+
+/**
+ * @brief Processes completions of a QPair, calling the callbacks of all
+ * requests that are done.
+ * @param qpair channel to use for I/O
+ * @param max_completions maximum number of completions to process, 0 for all
+ * that are available.
+ * @return number of completions processed, negative on a QPair failure.
+ */
+int32_t szd_process_completions(QPair *qpair, uint32_t max_completions);
+
 /**
  * @brief
  * Can be used on an asynchronously function to ensure that is synced to the
@@ -313,6 +860,28 @@ int szd_reset(QPair *qpair, uint64_t slba);
  */
 int szd_reset_all(QPair *qpair);
 
+/**
+ * @brief Resets a zone asynchronously.
+ * @param qpair channel to use for I/O
+ * @param slba starting logical block address of zone to reset
+ * @param completion can be used to poll for completion later on (sync)
+ */
+int szd_reset_async(QPair *qpair, uint64_t slba, Completion *completion);
+
+/**
+ * @brief Resets multiple zones synchronously, but keeps up to
+ * MAX_PIPELINE_DEPTH resets in flight at once. A failing zone does not stop
+ * the other resets.
+ * @param qpair channel to use for I/O
+ * @param slbas starting logical block addresses of the zones to reset
+ * @param n number of zones to reset
+ * @param status array of n entries to store the status code of each reset in,
+ * can be set to NULL.
+ * @return SZD_SC_SUCCESS if all zones are reset, otherwise an error.
+ */
+int szd_reset_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                   int *status);
+
 /**
  * @brief Finishes a zone synchronously, preventing too many active zones.
  * @param qpair channel to use for I/O
@@ -320,6 +889,20 @@ int szd_reset_all(QPair *qpair);
  */
 int szd_finish_zone(QPair *qpair, uint64_t slba);
 
+/**
+ * @brief Finishes a zone asynchronously.
+ * @param qpair channel to use for I/O
+ * @param slba starting logical block address of zone to finish
+ * @param completion can be used to poll for completion later on (sync)
+ */
+int szd_finish_zone_async(QPair *qpair, uint64_t slba, Completion *completion);
+
+/**
+ * @brief Finishes multiple zones, see szd_reset_many.
+ */
+int szd_finish_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                    int *status);
+
 /**
  * @brief Gets the write head of a zone synchronously as a logical block
  * address (lba).
@@ -354,6 +937,45 @@ int szd_get_zone_heads(QPair *qpair, uint64_t slba, uint64_t eslba,
  */
 int szd_get_zone_cap(QPair *qpair, uint64_t slba, uint64_t *zone_cap);
 
+/**
+ * @brief Gets the start of zones when all zones are placed back to back, each
+ * with its own capacity (no gap between capacity and size). The first zone of
+ * the device manager starts at min_lba / zone_size * zone_cap. Served from the
+ * zone state table, allows translating to and from lbas when zone capacities
+ * differ between zones.
+ * @param manager manager of the device.
+ * @param slba starting logical block address of the first zone.
+ * @param eslba starting logical block address of the last zone, can be equal
+ * to slba.
+ * @param zone_cap_prefix pointer to store the starts in. Must be allocated
+ * before and must have at least (eslba - slba) / zone_size + 2 entries, the
+ * last entry is the end of the last zone.
+ */
+int szd_get_zone_cap_prefix(DeviceManager *manager, uint64_t slba,
+                            uint64_t eslba, uint64_t *zone_cap_prefix);
+
+/**
+ * @brief Gets the descriptors of a range of zones with one batched zone report
+ * from the device. Also resyncs the zone state table for these zones.
+ * @param qpair channel to use for I/O
+ * @param slba starting logical block address of the first zone.
+ * @param eslba starting logical block address of the last zone, can be equal
+ * to slba.
+ * @param descs pointer to store the descriptors in. Must be allocated before
+ * and must have at least (eslba - slba) / zone_size + 1 entries.
+ */
+int szd_get_zone_descriptors(QPair *qpair, uint64_t slba, uint64_t eslba,
+                             ZoneDescriptor *descs);
+
+/**
+ * @brief Zone heads and capacities are served from an in-memory zone state
+ * table. It is seeded when opening a device and kept up to date by the
+ * completions of SZD. Use this to resync the table with the device after it
+ * was modified by something other than this device manager.
+ * @param qpair channel to use for I/O
+ */
+int szd_refresh_zone_table(QPair *qpair);
+
 /**
  * @brief Converts status code of SZD to human readable messages.
  * @param status If an SZD code retun appropriate message, else return default
@@ -384,6 +1006,10 @@ long int szd_spdk_strtol(const char *nptr, int base);
 #define SZD_DTRACE_PROBE(name) DTRACE_PROBE(szd, name)
 #define SZD_DTRACE_PROBE1(name, a1) DTRACE_PROBE1(szd, name, a1)
 #define SZD_DTRACE_PROBE2(name, a1, a2) DTRACE_PROBE2(szd, name, a1, a2)
+#define SZD_DTRACE_PROBE3(name, a1, a2, a3)                                    \
+  DTRACE_PROBE3(szd, name, a1, a2, a3)
+#define SZD_DTRACE_PROBE4(name, a1, a2, a3, a4)                                \
+  DTRACE_PROBE4(szd, name, a1, a2, a3, a4)
 #else
 #define SZD_DTRACE_PROBE(...)                                                  \
   do {                                                                         \
@@ -394,6 +1020,12 @@ long int szd_spdk_strtol(const char *nptr, int base);
 #define SZD_DTRACE_PROBE2(...)                                                 \
   do {                                                                         \
   } while (0)
+#define SZD_DTRACE_PROBE3(...)                                                 \
+  do {                                                                         \
+  } while (0)
+#define SZD_DTRACE_PROBE4(...)                                                 \
+  do {                                                                         \
+  } while (0)
 #endif
 
 void __szd_error_log(const char *file, const int line, const char *func,
@@ -409,6 +1041,8 @@ void __szd_probe_attach_cb(void *cb_ctx, const t_spdk_nvme_transport_id *trid,
 int __szd_open_create_private(DeviceManager *manager,
                               DeviceOpenOptions *options);
 
+void __szd_free_private(DeviceManager *manager);
+
 bool __szd_open_probe_cb(void *cb_ctx, const t_spdk_nvme_transport_id *trid,
                          t_spdk_nvme_ctrlr_opts *opts);
 
@@ -426,12 +1060,43 @@ void __read_complete(void *arg, const t_spdk_nvme_cpl *completion);
 
 void __append_complete(void *arg, const t_spdk_nvme_cpl *completion);
 
+void __copy_complete(void *arg, const t_spdk_nvme_cpl *completion);
+
+void __append_pipelined_complete(void *arg,
+                                 const t_spdk_nvme_cpl *completion);
+
 void __reset_zone_complete(void *arg, const t_spdk_nvme_cpl *completion);
 
+void __sgl_reset(void *arg, uint32_t offset);
+
+int __sgl_next_sge(void *arg, void **address, uint32_t *length);
+
 void __finish_zone_complete(void *arg, const t_spdk_nvme_cpl *completion);
 
 void __get_zone_head_complete(void *arg, const t_spdk_nvme_cpl *completion);
 
+void __callback_complete(void *arg, const t_spdk_nvme_cpl *completion);
+
+int __szd_report_zones(QPair *qpair, uint64_t slba, uint64_t nr_zones,
+                       t_spdk_nvme_zns_zone_desc *descs);
+
+void __zone_table_track(Completion *completion, DeviceManager *man,
+                        uint64_t slba, uint64_t nr);
+
+void __zone_table_advance(DeviceManager *man, uint64_t wp);
+
+void __zone_table_reset(DeviceManager *man, uint64_t slba, uint64_t nr_zones);
+
+void __zone_table_finish(DeviceManager *man, uint64_t slba);
+
+void __zone_table_build_prefix(DeviceManager *man);
+
+int __zone_management_submit(QPair *qpair, uint64_t slba, bool finish,
+                             Completion *completion);
+
+int __zone_management_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                           int *status, bool finish);
+
 #ifdef __cplusplus
 }
 } // namespace SimpleZNSDeviceNamespace
@@ -0,0 +1,189 @@
+/** \file
+ * Zoned SPDK bdev, the backend of devices opened with szd_open_bdev.
+ * Commands are translated to the bdev zone API and completed with NVMe
+ * completions, as with SPDK's NVMe driver. Only to be used by SZD itself.
+ * Without SZD_BDEV (SPDK's bdev modules were not found), the functions are
+ * stubs and no bdev can be opened.
+ */
+#pragma once
+#ifndef SZD_BDEV_H
+#define SZD_BDEV_H
+
+#include "szd/szd.h"
+
+#include <spdk/nvme.h>
+
+#include <errno.h>
+
+#ifdef __cplusplus
+namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
+extern "C" {
+#endif
+
+#define SZD_BDEV_DEFAULT_QUEUE_REQUESTS 0x200
+#define SZD_BDEV_MAX_XFER_SIZE 0x20000 /**< bdevs have no mdts, pick one.*/
+#define SZD_BDEV_MAX_IOVS 0x10         /**< Segments of one vectored command.*/
+
+typedef struct BdevNamespace BdevNamespace;
+typedef struct BdevQPair BdevQPair;
+
+#ifdef SZD_BDEV
+/**
+ * @brief Sets up the SPDK thread library and the bdev layer with the bdevs in
+ * the SPDK JSON config. SPDK's env must already be initialised.
+ */
+int szd_bdev_init(const char *config);
+
+/**
+ * @brief Tears down what szd_bdev_init set up, no-op if it was not called.
+ */
+void szd_bdev_fini(void);
+
+/**
+ * @brief Config the bdev layer was set up with, NULL if it is not.
+ */
+const char *szd_bdev_config(void);
+
+/**
+ * @brief Opens the zoned bdev bdev_name.
+ */
+int szd_bdev_open(BdevNamespace **ns, const char *bdev_name);
+
+/**
+ * @brief Closes ns, all its qpairs must be freed.
+ */
+void szd_bdev_close(BdevNamespace *ns);
+
+/**
+ * @brief Gets the geometry of ns, as szd_get_device_info would for an SSD.
+ * Zone capacities are only known through zone reports.
+ */
+void szd_bdev_get_info(BdevNamespace *ns, DeviceInfo *info);
+
+/**
+ * @brief Creates a qpair that can hold io_queue_requests requests, 0 picks
+ * SZD_BDEV_DEFAULT_QUEUE_REQUESTS. Each qpair has its own SPDK thread and I/O
+ * channel, so it can be used from any thread.
+ */
+BdevQPair *szd_bdev_alloc_qpair(BdevNamespace *ns, uint32_t io_queue_requests);
+void szd_bdev_free_qpair(BdevQPair *qpair);
+uint32_t szd_bdev_qpair_size(BdevQPair *qpair);
+
+/**
+ * @brief Polls the SPDK thread of qpair, returns the number of commands that
+ * completed. max_completions is only a hint.
+ */
+int32_t szd_bdev_process_completions(BdevQPair *qpair,
+                                     uint32_t max_completions);
+
+// Same as their SPDK NVMe counterparts, return -ENOMEM when the qpair is full.
+int szd_bdev_read(BdevQPair *qpair, void *buffer, uint64_t lba,
+                  uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_bdev_readv(BdevQPair *qpair, uint64_t lba, uint32_t lba_count,
+                   spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                   spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                   spdk_nvme_req_next_sge_cb next_sge_fn);
+int szd_bdev_zone_append(BdevQPair *qpair, void *buffer, uint64_t zslba,
+                         uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                         void *cb_arg);
+int szd_bdev_zone_appendv(BdevQPair *qpair, uint64_t zslba, uint32_t lba_count,
+                          spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                          spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                          spdk_nvme_req_next_sge_cb next_sge_fn);
+// bdevs have no select all, zones are reset and finished one at a time.
+int szd_bdev_reset_zone(BdevQPair *qpair, uint64_t slba,
+                        spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_bdev_finish_zone(BdevQPair *qpair, uint64_t slba,
+                         spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_bdev_report_zones(BdevQPair *qpair, void *payload,
+                          uint32_t payload_size, uint64_t slba,
+                          spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+#else
+// No bdevs can be opened, so the qpair functions are never reached.
+static inline int szd_bdev_init(const char *config) {
+  (void)config;
+  return SZD_SC_SPDK_ERROR_INIT;
+}
+static inline void szd_bdev_fini(void) {}
+static inline const char *szd_bdev_config(void) { return NULL; }
+static inline int szd_bdev_open(BdevNamespace **ns, const char *bdev_name) {
+  (void)ns;
+  (void)bdev_name;
+  return SZD_SC_SPDK_ERROR_OPEN;
+}
+static inline void szd_bdev_close(BdevNamespace *ns) { (void)ns; }
+static inline void szd_bdev_get_info(BdevNamespace *ns, DeviceInfo *info) {
+  (void)ns;
+  (void)info;
+}
+static inline BdevQPair *szd_bdev_alloc_qpair(BdevNamespace *ns,
+                                              uint32_t io_queue_requests) {
+  (void)ns;
+  (void)io_queue_requests;
+  return NULL;
+}
+static inline void szd_bdev_free_qpair(BdevQPair *qpair) { (void)qpair; }
+static inline uint32_t szd_bdev_qpair_size(BdevQPair *qpair) {
+  (void)qpair;
+  return 0;
+}
+static inline int32_t szd_bdev_process_completions(BdevQPair *qpair,
+                                                   uint32_t max_completions) {
+  (void)qpair;
+  (void)max_completions;
+  return -ENXIO;
+}
+static inline int szd_bdev_read(BdevQPair *qpair, void *buffer, uint64_t lba,
+                                uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                                void *cb_arg) {
+  (void)qpair;
+  (void)buffer;
+  (void)lba;
+  (void)lba_count;
+  (void)cb_fn;
+  (void)cb_arg;
+  return -ENXIO;
+}
+static inline int szd_bdev_readv(BdevQPair *qpair, uint64_t lba,
+                                 uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                                 void *cb_arg,
+                                 spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                                 spdk_nvme_req_next_sge_cb next_sge_fn) {
+  (void)reset_sgl_fn;
+  (void)next_sge_fn;
+  return szd_bdev_read(qpair, NULL, lba, lba_count, cb_fn, cb_arg);
+}
+static inline int szd_bdev_zone_append(BdevQPair *qpair, void *buffer,
+                                       uint64_t zslba, uint32_t lba_count,
+                                       spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  return szd_bdev_read(qpair, buffer, zslba, lba_count, cb_fn, cb_arg);
+}
+static inline int szd_bdev_zone_appendv(BdevQPair *qpair, uint64_t zslba,
+                                        uint32_t lba_count,
+                                        spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                                        spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                                        spdk_nvme_req_next_sge_cb next_sge_fn) {
+  return szd_bdev_readv(qpair, zslba, lba_count, cb_fn, cb_arg, reset_sgl_fn,
+                        next_sge_fn);
+}
+static inline int szd_bdev_reset_zone(BdevQPair *qpair, uint64_t slba,
+                                      spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  return szd_bdev_read(qpair, NULL, slba, 0, cb_fn, cb_arg);
+}
+static inline int szd_bdev_finish_zone(BdevQPair *qpair, uint64_t slba,
+                                       spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  return szd_bdev_read(qpair, NULL, slba, 0, cb_fn, cb_arg);
+}
+static inline int szd_bdev_report_zones(BdevQPair *qpair, void *payload,
+                                        uint32_t payload_size, uint64_t slba,
+                                        spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  (void)payload_size;
+  return szd_bdev_read(qpair, payload, slba, 0, cb_fn, cb_arg);
+}
+#endif
+
+#ifdef __cplusplus
+}
+} // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
+#endif
+#endif
@@ -0,0 +1,82 @@
+/** \file
+ * Emulated zoned namespace, the backend of devices opened with szd_open_emu.
+ * Commands are executed on submission and complete when their qpair is
+ * polled, as with SPDK. Only to be used by SZD itself.
+ */
+#pragma once
+#ifndef SZD_EMU_H
+#define SZD_EMU_H
+
+#include "szd/szd.h"
+
+#include <spdk/nvme.h>
+
+#ifdef __cplusplus
+namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
+extern "C" {
+#endif
+
+#define SZD_EMU_DEFAULT_QUEUE_REQUESTS 0x200
+
+typedef struct EmuNamespace EmuNamespace;
+typedef struct EmuQPair EmuQPair;
+
+/**
+ * @brief Creates an emulated namespace, see EmuOptions.
+ */
+int szd_emu_open(EmuNamespace **ns, const EmuOptions *options);
+
+/**
+ * @brief Frees ns, data of file backed namespaces is kept in the file.
+ */
+void szd_emu_close(EmuNamespace *ns);
+
+/**
+ * @brief Gets the geometry of ns, as szd_get_device_info would for an SSD.
+ */
+void szd_emu_get_info(EmuNamespace *ns, DeviceInfo *info);
+
+/**
+ * @brief Creates a qpair that can hold io_queue_requests requests, 0 picks
+ * SZD_EMU_DEFAULT_QUEUE_REQUESTS.
+ */
+EmuQPair *szd_emu_alloc_qpair(EmuNamespace *ns, uint32_t io_queue_requests);
+void szd_emu_free_qpair(EmuQPair *qpair);
+uint32_t szd_emu_qpair_size(EmuQPair *qpair);
+
+/**
+ * @brief Calls the callbacks of at most max_completions completed commands
+ * (0 is all), same as spdk_nvme_qpair_process_completions.
+ */
+int32_t szd_emu_process_completions(EmuQPair *qpair, uint32_t max_completions);
+
+// Same as their SPDK counterparts, return -ENOMEM when the qpair is full.
+int szd_emu_read(EmuQPair *qpair, void *buffer, uint64_t lba,
+                 uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_emu_readv(EmuQPair *qpair, uint64_t lba, uint32_t lba_count,
+                  spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                  spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                  spdk_nvme_req_next_sge_cb next_sge_fn);
+int szd_emu_zone_append(EmuQPair *qpair, void *buffer, uint64_t zslba,
+                        uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                        void *cb_arg);
+int szd_emu_zone_appendv(EmuQPair *qpair, uint64_t zslba, uint32_t lba_count,
+                         spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                         spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                         spdk_nvme_req_next_sge_cb next_sge_fn);
+int szd_emu_reset_zone(EmuQPair *qpair, uint64_t slba, bool select_all,
+                       spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_emu_finish_zone(EmuQPair *qpair, uint64_t slba, bool select_all,
+                        spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_emu_report_zones(EmuQPair *qpair, void *payload, uint32_t payload_size,
+                         uint64_t slba, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int szd_emu_copy(EmuQPair *qpair,
+                 const struct spdk_nvme_scc_source_range *ranges,
+                 uint16_t num_ranges, uint64_t dest_lba,
+                 spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+
+#ifdef __cplusplus
+}
+} // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
+#endif
+#endif
@@ -31,7 +31,13 @@
  *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // sched_getcpu
+#endif
+
 #include "szd/szd.h"
+#include "szd/szd_bdev.h"
+#include "szd/szd_emu.h"
 #include "szd/szd_status_code.h"
 
 #include <spdk/env.h>
@@ -43,6 +49,11 @@
 #include <spdk/string.h>
 #include <spdk/util.h>
 
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -62,12 +73,270 @@ typedef struct spdk_nvme_ctrlr_data t_spdk_nvme_ctrlr_data;
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 #endif
 
-const DeviceOptions DeviceOptions_default = {"znsdevice", true};
+const DeviceOptions DeviceOptions_default = {"znsdevice", true, false, NULL};
 const DeviceOpenOptions DeviceOpenOptions_default = {0, 0};
-const Completion Completion_default = {false, SZD_SC_SUCCESS};
-const DeviceManagerInternal DeviceManagerInternal_default = {0, 0};
+const QPairOptions QPairOptions_default = {0, 0, false};
+const TransportOptions TransportOptions_default = {
+    {0, 0, false}, 0, 0, 0, false, false};
+const Completion Completion_default = {false, SZD_SC_SUCCESS, NULL, 0, 0};
+const DeviceManagerInternal DeviceManagerInternal_default = {
+    0, 0, NULL, NULL, NULL, NULL, 0, NULL, {0, 0, false}, NULL};
 const DeviceInfo DeviceInfo_default = {0, 0, 0, 0, 0, 0, 0, 0, "SZD"};
 
+// Used for pipelined appends, we need to know where the device placed data.
+typedef struct {
+  Completion completion;
+  uint64_t alba;  /**< lba assigned by the device after the append.*/
+  uint64_t elba;  /**< lba we expect the device to assign.*/
+  uint64_t seq;   /**< Order in which the append was issued.*/
+  bool in_flight; /**< Whether the slot is in use.*/
+} PipelinedCompletion;
+
+// Used for vectored I/O, SPDK walks the segments with the SGL callbacks.
+typedef struct {
+  Completion completion;    /**< Must be first, used by completion cbs.*/
+  const struct iovec *iov;  /**< Segments of the entire request.*/
+  int iovcnt;               /**< Number of segments.*/
+  uint64_t base;            /**< Offset of the current command in bytes.*/
+  int iov_pos;              /**< Segment the SGL cursor is in.*/
+  uint64_t iov_offset;      /**< Offset of the SGL cursor in the segment.*/
+} VectoredCompletion;
+
+// Request of the callback API, taken from the pool of a QPair.
+typedef struct CallbackRequest {
+  Completion completion;        /**< Must be first, used by completion cbs.*/
+  spdk_nvme_cmd_cb complete_fn; /**< Completion of the polled variant.*/
+  szd_completion_cb cb;         /**< Callback of the user.*/
+  void *cb_arg;                 /**< Argument of the user.*/
+  uint64_t lba;                 /**< lba the request started at.*/
+  struct CallbackRequest *next; /**< Next free request in the pool.*/
+  struct CallbackPool *pool;    /**< Pool the request belongs to.*/
+} CallbackRequest;
+
+typedef struct CallbackPool {
+  CallbackRequest *free_requests;
+  CallbackRequest requests[MAX_CALLBACK_REQUESTS];
+} CallbackPool;
+
+// Namespace, qpair and lba a command for one zone is submitted to.
+typedef struct {
+  struct spdk_nvme_ns *ns;
+  struct spdk_nvme_qpair *qpair;
+  uint64_t lba;
+  EmuQPair *emu;   /**< qpair of emulated devices, ns and qpair are NULL.*/
+  BdevQPair *bdev; /**< qpair of bdevs, ns and qpair are NULL.*/
+} SubmitTarget;
+
+// Whether a device is opened in the manager, by any backend.
+static inline bool __is_open(const DeviceManager *man) {
+  return man->ctrlr != NULL || man->backend_ != NULL;
+}
+
+static inline bool __is_group(const DeviceManager *man) {
+  const DeviceManagerInternal *private_ =
+      (const DeviceManagerInternal *)man->private_;
+  return private_ != NULL && private_->group_size_ > 0;
+}
+
+// Device groups interleave zones, zone z of the group is zone z / n of member
+// z % n. Translates lba of the group to the lba on its member.
+static inline uint32_t __group_member_lba(const DeviceManagerInternal *private_,
+                                          uint64_t zone_size, uint64_t *lba) {
+  uint64_t zone = *lba / zone_size;
+  *lba = (zone / private_->group_size_) * zone_size + *lba % zone_size;
+  return (uint32_t)(zone % private_->group_size_);
+}
+
+static inline SubmitTarget __submit_target(QPair *qpair, uint64_t lba) {
+  SubmitTarget target = {qpair->man->ns, qpair->qpair, lba, NULL, NULL};
+  if (spdk_unlikely(qpair->backend_qpair_ != NULL)) {
+    if (qpair->man->backend == SZD_BACKEND_BDEV) {
+      target.bdev = (BdevQPair *)qpair->backend_qpair_;
+    } else {
+      target.emu = (EmuQPair *)qpair->backend_qpair_;
+    }
+  }
+  if (spdk_unlikely(qpair->group_size_ > 0)) {
+    DeviceManagerInternal *private_ =
+        (DeviceManagerInternal *)qpair->man->private_;
+    uint32_t member = __group_member_lba(private_, qpair->man->info.zone_size,
+                                         &target.lba);
+    target.ns = private_->group_[member]->ns;
+    if (qpair->group_backend_qpairs_ != NULL) {
+      target.emu = (EmuQPair *)qpair->group_backend_qpairs_[member];
+    } else {
+      target.qpair = qpair->group_qpairs_[member];
+    }
+  }
+  return target;
+}
+
+// Submits a command to the backend of target, same as the SPDK commands.
+static inline int __cmd_read(const SubmitTarget *target, void *payload,
+                             uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                             void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_read(target->emu, payload, target->lba, lba_count, cb_fn,
+                        cb_arg);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return szd_bdev_read(target->bdev, payload, target->lba, lba_count, cb_fn,
+                         cb_arg);
+  }
+  return spdk_nvme_ns_cmd_read(target->ns, target->qpair, payload, target->lba,
+                               lba_count, cb_fn, cb_arg, 0);
+}
+
+static inline int __cmd_readv(const SubmitTarget *target, uint32_t lba_count,
+                              spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_readv(target->emu, target->lba, lba_count, cb_fn, cb_arg,
+                         __sgl_reset, __sgl_next_sge);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return szd_bdev_readv(target->bdev, target->lba, lba_count, cb_fn, cb_arg,
+                          __sgl_reset, __sgl_next_sge);
+  }
+  return spdk_nvme_ns_cmd_readv(target->ns, target->qpair, target->lba,
+                                lba_count, cb_fn, cb_arg, 0, __sgl_reset,
+                                __sgl_next_sge);
+}
+
+static inline int __cmd_append(const SubmitTarget *target, void *payload,
+                               uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                               void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_zone_append(target->emu, payload, target->lba, lba_count,
+                               cb_fn, cb_arg);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return szd_bdev_zone_append(target->bdev, payload, target->lba, lba_count,
+                                cb_fn, cb_arg);
+  }
+  return spdk_nvme_zns_zone_append(target->ns, target->qpair, payload,
+                                   target->lba, lba_count, cb_fn, cb_arg, 0);
+}
+
+static inline int __cmd_appendv(const SubmitTarget *target, uint32_t lba_count,
+                                spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_zone_appendv(target->emu, target->lba, lba_count, cb_fn,
+                                cb_arg, __sgl_reset, __sgl_next_sge);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return szd_bdev_zone_appendv(target->bdev, target->lba, lba_count, cb_fn,
+                                 cb_arg, __sgl_reset, __sgl_next_sge);
+  }
+  return spdk_nvme_zns_zone_appendv(target->ns, target->qpair, target->lba,
+                                    lba_count, cb_fn, cb_arg, 0, __sgl_reset,
+                                    __sgl_next_sge);
+}
+
+static inline int __cmd_reset(const SubmitTarget *target, bool select_all,
+                              spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_reset_zone(target->emu, target->lba, select_all, cb_fn,
+                              cb_arg);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return select_all ? -ENOTSUP
+                      : szd_bdev_reset_zone(target->bdev, target->lba, cb_fn,
+                                            cb_arg);
+  }
+  return spdk_nvme_zns_reset_zone(target->ns, target->qpair, target->lba,
+                                  select_all, cb_fn, cb_arg);
+}
+
+static inline int __cmd_finish(const SubmitTarget *target, bool select_all,
+                               spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_finish_zone(target->emu, target->lba, select_all, cb_fn,
+                               cb_arg);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return select_all ? -ENOTSUP
+                      : szd_bdev_finish_zone(target->bdev, target->lba, cb_fn,
+                                             cb_arg);
+  }
+  return spdk_nvme_zns_finish_zone(target->ns, target->qpair, target->lba,
+                                   select_all, cb_fn, cb_arg);
+}
+
+static inline int __cmd_report_zones(const SubmitTarget *target,
+                                     void *payload, uint32_t payload_size,
+                                     spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_report_zones(target->emu, payload, payload_size,
+                                target->lba, cb_fn, cb_arg);
+  }
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return szd_bdev_report_zones(target->bdev, payload, payload_size,
+                                 target->lba, cb_fn, cb_arg);
+  }
+  return spdk_nvme_zns_report_zones(target->ns, target->qpair, payload,
+                                    payload_size, target->lba,
+                                    SPDK_NVME_ZRA_LIST_ALL, true, cb_fn,
+                                    cb_arg);
+}
+
+static inline int
+__cmd_copy(const SubmitTarget *target,
+           const struct spdk_nvme_scc_source_range *ranges,
+           uint16_t num_ranges, spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  if (spdk_unlikely(target->emu != NULL)) {
+    return szd_emu_copy(target->emu, ranges, num_ranges, target->lba, cb_fn,
+                        cb_arg);
+  }
+  // bdevs are never asked to copy, see szd_copy_supported.
+  if (spdk_unlikely(target->bdev != NULL)) {
+    return -ENOTSUP;
+  }
+  return spdk_nvme_ns_cmd_copy(target->ns, target->qpair, ranges, num_ranges,
+                               target->lba, cb_fn, cb_arg);
+}
+
+// Processes completions of all qpairs of a (group) QPair.
+static inline int32_t __qpair_process_completions(QPair *qpair,
+                                                  uint32_t max_completions) {
+  if (spdk_unlikely(qpair->backend_qpair_ != NULL)) {
+    if (qpair->man->backend == SZD_BACKEND_BDEV) {
+      return szd_bdev_process_completions((BdevQPair *)qpair->backend_qpair_,
+                                          max_completions);
+    }
+    return szd_emu_process_completions((EmuQPair *)qpair->backend_qpair_,
+                                       max_completions);
+  }
+  if (spdk_likely(qpair->group_size_ == 0)) {
+    return spdk_nvme_qpair_process_completions(qpair->qpair, max_completions);
+  }
+  int32_t completed = 0;
+  for (uint32_t member = 0; member < qpair->group_size_; member++) {
+    int32_t rc =
+        qpair->group_backend_qpairs_ != NULL
+            ? szd_emu_process_completions(
+                  (EmuQPair *)qpair->group_backend_qpairs_[member],
+                  max_completions)
+            : spdk_nvme_qpair_process_completions(qpair->group_qpairs_[member],
+                                                  max_completions);
+    if (spdk_unlikely(rc < 0)) {
+      return rc;
+    }
+    completed += rc;
+  }
+  return completed;
+}
+
+// lba assigned by an append, members of a device group assign their own lbas.
+static inline uint64_t __append_alba(const Completion *completed,
+                                     const struct spdk_nvme_cpl *completion) {
+  // Zone append returns the assigned lba in dword 0 and 1.
+  uint64_t alba = ((uint64_t)completion->cdw1 << 32) | completion->cdw0;
+  if (spdk_unlikely(completed->man_ != NULL && __is_group(completed->man_))) {
+    alba = completed->slba_ + alba % completed->man_->info.zone_size;
+  }
+  return alba;
+}
+
 // Needed because of DPDK and reattaching, we need to remember what we have
 // seen...
 static char *found_devices[MAX_DEVICE_COUNT];
@@ -100,6 +369,13 @@ int szd_init(DeviceManager **manager, DeviceOptions *options) {
   if (options->setup_spdk) {
     opts.name = options->name;
     spdk_env_opts_init(&opts);
+    // Emulated devices only need memory for buffers, which does not have to
+    // be pinned.
+    if (options->emulated) {
+      opts.no_pci = true;
+      opts.env_context = (void *)"--no-huge";
+      opts.mem_size = SZD_EMU_MEM_SIZE_MB;
+    }
   }
   // Setup SPDK
   (*manager)->g_trid =
@@ -112,34 +388,124 @@ int szd_init(DeviceManager **manager, DeviceOptions *options) {
     free(*manager);
     return SZD_SC_SPDK_ERROR_INIT;
   }
+  // bdevs live in the bdev layer, which runs on SPDK threads.
+  if (options->bdev_config != NULL &&
+      szd_bdev_init(options->bdev_config) != SZD_SC_SUCCESS) {
+    spdk_env_fini();
+    free((*manager)->g_trid);
+    free(*manager);
+    return SZD_SC_SPDK_ERROR_INIT;
+  }
   // setup stub info, we do not want to create extra UB.
   (*manager)->info = DeviceInfo_default;
   (*manager)->info.name = options->name;
   (*manager)->ctrlr = NULL;
   (*manager)->ns = NULL;
+  (*manager)->backend = SZD_BACKEND_NVME;
   (*manager)->private_ = NULL;
+  (*manager)->backend_ = NULL;
   SZD_DTRACE_PROBE(szd_init);
   return SZD_SC_SUCCESS;
 }
 
-int szd_get_device_info(DeviceInfo *info, DeviceManager *manager) {
-  RETURN_ERR_ON_NULL(info);
+int szd_get_socket_id(DeviceManager *manager, int32_t *socket_id) {
   RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(socket_id);
+  if (manager->backend != SZD_BACKEND_NVME) {
+    RETURN_ERR_ON_NULL(manager->backend_);
+    *socket_id = SZD_SOCKET_ID_ANY;
+    return SZD_SC_SUCCESS;
+  }
   RETURN_ERR_ON_NULL(manager->ctrlr);
-  RETURN_ERR_ON_NULL(manager->ns);
-  info->lba_size = (uint64_t)spdk_nvme_ns_get_sector_size(manager->ns);
-  info->zone_size =
-      (uint64_t)spdk_nvme_zns_ns_get_zone_size_sectors(manager->ns);
-  info->mdts = (uint64_t)spdk_nvme_ctrlr_get_max_xfer_size(manager->ctrlr);
-  info->zasl =
-      (uint64_t)spdk_nvme_zns_ctrlr_get_max_zone_append_size(manager->ctrlr);
-  info->lba_cap = (uint64_t)spdk_nvme_ns_get_num_sectors(manager->ns);
+  // Only PCIe controllers have a device, fabrics are local to every node.
+  struct spdk_pci_device *dev = spdk_nvme_ctrlr_get_pci_device(manager->ctrlr);
+  *socket_id = dev == NULL ? SZD_SOCKET_ID_ANY
+                           : (int32_t)spdk_pci_device_get_socket_id(dev);
+  if (*socket_id < 0) {
+    *socket_id = SZD_SOCKET_ID_ANY;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+// Whether SPDK has an lcore with this number, only those have a socket.
+static bool __is_spdk_core(uint32_t core) {
+  uint32_t lcore;
+  SPDK_ENV_FOREACH_CORE(lcore) {
+    if (lcore == core) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t szd_current_socket_id(void) {
+  uint32_t core = spdk_env_get_current_core();
+  // Threads not created by SPDK have no lcore, use the cpu instead. SPDK
+  // numbers its lcores after the cpus they are pinned to, cpus outside of the
+  // core mask would be looked up out of bounds.
+  if (core == SPDK_ENV_LCORE_ID_ANY) {
+    int cpu = sched_getcpu();
+    if (cpu < 0 || !__is_spdk_core((uint32_t)cpu)) {
+      return SZD_SOCKET_ID_ANY;
+    }
+    core = (uint32_t)cpu;
+  }
+  int32_t socket_id = (int32_t)spdk_env_get_socket_id(core);
+  return socket_id < 0 ? SZD_SOCKET_ID_ANY : socket_id;
+}
+
+// Everything but the capacity of the zones, that needs a qpair.
+static int __szd_get_device_geometry(DeviceInfo *info,
+                                     DeviceManager *manager) {
+  // A device group is described at open, its members can differ.
+  if (spdk_unlikely(__is_group(manager))) {
+    *info = manager->info;
+    return SZD_SC_SUCCESS;
+  }
+  if (manager->backend == SZD_BACKEND_EMU) {
+    RETURN_ERR_ON_NULL(manager->backend_);
+    szd_emu_get_info((EmuNamespace *)manager->backend_, info);
+    info->min_lba = manager->info.min_lba;
+    info->max_lba = manager->info.max_lba;
+    return SZD_SC_SUCCESS;
+  }
+  if (manager->backend == SZD_BACKEND_BDEV) {
+    RETURN_ERR_ON_NULL(manager->backend_);
+    szd_bdev_get_info((BdevNamespace *)manager->backend_, info);
+  } else {
+    RETURN_ERR_ON_NULL(manager->ctrlr);
+    RETURN_ERR_ON_NULL(manager->ns);
+    info->lba_size = (uint64_t)spdk_nvme_ns_get_sector_size(manager->ns);
+    info->zone_size =
+        (uint64_t)spdk_nvme_zns_ns_get_zone_size_sectors(manager->ns);
+    info->mdts = (uint64_t)spdk_nvme_ctrlr_get_max_xfer_size(manager->ctrlr);
+    info->zasl = (uint64_t)spdk_nvme_zns_ctrlr_get_max_zone_append_size(
+        manager->ctrlr);
+    info->lba_cap = (uint64_t)spdk_nvme_ns_get_num_sectors(manager->ns);
+  }
   info->min_lba = manager->info.min_lba;
   info->max_lba = manager->info.max_lba;
+  return SZD_SC_SUCCESS;
+}
+
+int szd_get_device_info(DeviceInfo *info, DeviceManager *manager) {
+  RETURN_ERR_ON_NULL(info);
+  RETURN_ERR_ON_NULL(manager);
+  int rc = __szd_get_device_geometry(info, manager);
+  // Emulated devices and groups know their zone capacity.
+  if (rc != SZD_SC_SUCCESS || manager->backend == SZD_BACKEND_EMU ||
+      __is_group(manager)) {
+    return rc;
+  }
   // printf("INFO: %lu %lu %lu %lu %lu %lu %lu \n", info->lba_size,
   // info->zone_size, info->mdts, info->zasl,
   //   info->lba_cap, info->min_lba, info->max_lba);
-  // TODO: zone cap can differ between zones...
+  // Capacity of the first zone only, capacities of all zones are in the zone
+  // state table (szd_get_zone_cap_prefix). An opened device already knows it.
+  if (manager->private_ != NULL) {
+    info->zone_cap = manager->info.zone_cap;
+    return SZD_SC_SUCCESS;
+  }
   QPair **temp = (QPair **)calloc(1, sizeof(QPair *));
   szd_create_qpair(manager, temp);
   szd_get_zone_cap(*temp, info->min_lba, &info->zone_cap);
@@ -148,6 +514,32 @@ int szd_get_device_info(DeviceInfo *info, DeviceManager *manager) {
   return SZD_SC_SUCCESS;
 }
 
+// Controllers of fabrics only allow queues as large as they are connected
+// with.
+static void __szd_apply_transport_options(struct spdk_nvme_ctrlr_opts *opts,
+                                          const TransportOptions *transport) {
+  if (transport->qpair.io_queue_size != 0) {
+    opts->io_queue_size = transport->qpair.io_queue_size;
+  }
+  if (transport->qpair.io_queue_requests != 0) {
+    opts->io_queue_requests = transport->qpair.io_queue_requests;
+  }
+  if (opts->io_queue_requests < opts->io_queue_size) {
+    opts->io_queue_requests = opts->io_queue_size;
+  }
+  if (transport->keep_alive_timeout_ms != 0) {
+    opts->keep_alive_timeout_ms = transport->keep_alive_timeout_ms;
+  }
+  if (transport->transport_retry_count != 0) {
+    opts->transport_retry_count = transport->transport_retry_count;
+  }
+  if (transport->connect_timeout_us != 0) {
+    opts->fabrics_connect_timeout_us = transport->connect_timeout_us;
+  }
+  opts->header_digest = transport->header_digest;
+  opts->data_digest = transport->data_digest;
+}
+
 bool __szd_open_probe_cb(void *cb_ctx,
                          const struct spdk_nvme_transport_id *trid,
                          struct spdk_nvme_ctrlr_opts *opts) {
@@ -166,7 +558,9 @@ bool __szd_open_probe_cb(void *cb_ctx,
       0) {
     return false;
   }
-  (void)opts;
+  if (prober->transport != NULL) {
+    __szd_apply_transport_options(opts, prober->transport);
+  }
   return true;
 }
 
@@ -221,20 +615,184 @@ int __szd_open_create_private(DeviceManager *manager,
   }
   DeviceManagerInternal *private_ =
       (DeviceManagerInternal *)calloc(1, sizeof(DeviceManagerInternal));
-  *private_ = DeviceManagerInternal_default;
   RETURN_ERR_ON_NULL(private_);
+  *private_ = DeviceManagerInternal_default;
   private_->zone_min_ = zone_min;
   private_->zone_max_ = zone_max;
+  // Zone state table, seeded later on (+1 so that an empty range allocates).
+  uint64_t zones = zone_max - zone_min;
+  private_->zone_wp_ = (uint64_t *)calloc(zones + 1, sizeof(uint64_t));
+  private_->zone_cap_ = (uint64_t *)calloc(zones + 1, sizeof(uint64_t));
+  private_->zone_state_ = (uint8_t *)calloc(zones + 1, sizeof(uint8_t));
+  private_->zone_cap_prefix_ =
+      (uint64_t *)calloc(zones + 1, sizeof(uint64_t));
   manager->private_ = (void *)private_;
+  if (spdk_unlikely(private_->zone_wp_ == NULL ||
+                    private_->zone_cap_ == NULL ||
+                    private_->zone_state_ == NULL ||
+                    private_->zone_cap_prefix_ == NULL)) {
+    __szd_free_private(manager);
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+void __szd_free_private(DeviceManager *manager) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  if (private_ == NULL) {
+    return;
+  }
+  free(private_->zone_wp_);
+  free(private_->zone_cap_);
+  free(private_->zone_state_);
+  free(private_->zone_cap_prefix_);
+  free(private_);
+  manager->private_ = NULL;
+}
+
+// Destroys the qpair the device was opened with if nobody took it.
+static void __szd_release_spare_qpair(DeviceManager *manager) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  if (private_ == NULL) {
+    return;
+  }
+  QPair *spare = (QPair *)__atomic_exchange_n(&private_->spare_qpair_, NULL,
+                                              __ATOMIC_ACQ_REL);
+  if (spare != NULL) {
+    szd_destroy_qpair(spare);
+  }
+}
+
+// Seeds the zone state table of manager with a new qpair, which then learns
+// the capacity of the first zone from the table. The qpair is kept as the
+// first qpair of the device, there is no need for a temporary one.
+static int __szd_open_seed(DeviceManager *manager) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  QPair *qpair = NULL;
+  int rc = szd_create_qpair(manager, &qpair);
+  if (rc != SZD_SC_SUCCESS) {
+    return rc;
+  }
+  rc = szd_refresh_zone_table(qpair);
+  if (rc == SZD_SC_SUCCESS) {
+    rc = szd_get_zone_cap(qpair, manager->info.min_lba,
+                          &manager->info.zone_cap);
+  }
+  if (rc != SZD_SC_SUCCESS) {
+    szd_destroy_qpair(qpair);
+    return rc;
+  }
+  __atomic_store_n(&private_->spare_qpair_, (void *)qpair, __ATOMIC_RELEASE);
+  return rc;
+}
+
+// Describes the device that was just attached to manager and seeds its zone
+// state table.
+static int __szd_open_setup(DeviceManager *manager,
+                            DeviceOpenOptions *options,
+                            const QPairOptions *qpair_options) {
+  // Setup information immediately, the zone capacity comes with the table.
+  int rc = __szd_get_device_geometry(&manager->info, manager);
+  if (rc != 0) {
+    return rc;
+  }
+  rc = __szd_open_create_private(manager, options);
+  if (rc != 0) {
+    return rc;
+  }
+  // Create a container.
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  private_->qpair_options_ = *qpair_options;
+  manager->info.min_lba = private_->zone_min_ * manager->info.zone_size;
+  manager->info.max_lba = private_->zone_max_ * manager->info.zone_size;
+  if ((rc = __szd_open_seed(manager)) != SZD_SC_SUCCESS) {
+    return rc;
+  }
+  SZD_DTRACE_PROBE(szd_open);
+  return rc;
+}
+
+// Probes with SPDK's asynchronous probe and polls it until all controllers
+// that probe_cb accepts are attached. This blocks as long as spdk_nvme_probe,
+// the time is saved by keeping controllers attached from probe to open.
+static int __szd_probe_async(const struct spdk_nvme_transport_id *trid,
+                             void *cb_ctx, spdk_nvme_probe_cb probe_cb,
+                             spdk_nvme_attach_cb attach_cb,
+                             spdk_nvme_remove_cb remove_cb) {
+  struct spdk_nvme_probe_ctx *probe_ctx =
+      spdk_nvme_probe_async(trid, cb_ctx, probe_cb, attach_cb, remove_cb);
+  if (probe_ctx == NULL) {
+    return -1;
+  }
+  int rc;
+  while ((rc = spdk_nvme_probe_poll_async(probe_ctx)) == -EAGAIN) {
+  }
+  return rc;
+}
+
+// Connects to the controller of a transport ID, fabrics can not be probed by
+// traddr alone.
+static int __szd_open_connect(DeviceManager *manager,
+                              const struct spdk_nvme_transport_id *trid,
+                              const TransportOptions *transport_options) {
+  struct spdk_nvme_ctrlr_opts opts;
+  spdk_nvme_ctrlr_get_default_ctrlr_opts(&opts, sizeof(opts));
+  __szd_apply_transport_options(&opts, transport_options);
+  struct spdk_nvme_ctrlr *ctrlr = spdk_nvme_connect(trid, &opts, sizeof(opts));
+  if (ctrlr == NULL) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  DeviceTarget prober = {.manager = manager,
+                         .traddr = trid->traddr,
+                         .traddr_len = strlen(trid->traddr),
+                         .found = false,
+                         .transport = transport_options};
+  __szd_open_attach_cb(&prober, trid, ctrlr, &opts);
+  if (!prober.found) {
+    manager->ctrlr = NULL;
+    spdk_nvme_detach(ctrlr);
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  *manager->g_trid = *trid;
   return SZD_SC_SUCCESS;
 }
 
 int szd_open(DeviceManager *manager, const char *traddr,
              DeviceOpenOptions *options) {
+  return szd_open_transport(manager, traddr, &TransportOptions_default,
+                            options);
+}
+
+int szd_open_transport(DeviceManager *manager, const char *traddr,
+                       const TransportOptions *transport_options,
+                       DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(traddr);
+  RETURN_ERR_ON_NULL(transport_options);
+  // Transport IDs of fabrics are connected to directly, PCIe addresses are
+  // probed, also when given as a transport ID (keys are case-insensitive and
+  // may be followed by ':' or '=').
+  struct spdk_nvme_transport_id trid;
+  memset(&trid, 0, sizeof(trid));
+  if (strcasestr(traddr, "trtype") != NULL) {
+    if (spdk_nvme_transport_id_parse(&trid, traddr) != 0) {
+      SPDK_ERRLOG("SZD: Invalid transport ID %s\n", traddr);
+      return SZD_SC_SPDK_ERROR_OPEN;
+    }
+    if (trid.trtype != SPDK_NVME_TRANSPORT_PCIE) {
+      int rc = __szd_open_connect(manager, &trid, transport_options);
+      if (rc != SZD_SC_SUCCESS) {
+        return rc;
+      }
+      return __szd_open_setup(manager, options, &transport_options->qpair);
+    }
+    traddr = trid.traddr;
+  }
   DeviceTarget prober = {.manager = manager,
                          .traddr = traddr,
                          .traddr_len = strlen(traddr),
-                         .found = false};
+                         .found = false,
+                         .transport = transport_options};
   // This is needed because of DPDK not properly recognising reattached devices.
   // So force traddr.
   bool already_found_once = false;
@@ -253,10 +811,10 @@ int szd_open(DeviceManager *manager, const char *traddr,
   }
   // Find controller.
   int probe_ctx;
-  probe_ctx = spdk_nvme_probe(manager->g_trid, &prober,
-                              (spdk_nvme_probe_cb)__szd_open_probe_cb,
-                              (spdk_nvme_attach_cb)__szd_open_attach_cb,
-                              (spdk_nvme_remove_cb)__szd_open_remove_cb);
+  probe_ctx = __szd_probe_async(manager->g_trid, &prober,
+                                (spdk_nvme_probe_cb)__szd_open_probe_cb,
+                                (spdk_nvme_attach_cb)__szd_open_attach_cb,
+                                (spdk_nvme_remove_cb)__szd_open_remove_cb);
   // Dettach if broken.
   if (probe_ctx != 0) {
     if (manager->ctrlr != NULL) {
@@ -272,38 +830,216 @@ int szd_open(DeviceManager *manager, const char *traddr,
       return SZD_SC_SPDK_ERROR_OPEN;
     }
   }
-  // Setup information immediately.
-  int rc = szd_get_device_info(&manager->info, manager);
-  if (rc != 0) {
+  return __szd_open_setup(manager, options, &transport_options->qpair);
+}
+
+int szd_open_emu(DeviceManager *manager, const EmuOptions *emu_options,
+                 DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(emu_options);
+  RETURN_ERR_ON_NULL(options);
+  if (spdk_unlikely(__is_open(manager))) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  EmuNamespace *ns = NULL;
+  int rc = szd_emu_open(&ns, emu_options);
+  if (rc != SZD_SC_SUCCESS) {
     return rc;
   }
-  rc = __szd_open_create_private(manager, options);
-  if (rc != 0) {
+  manager->backend = SZD_BACKEND_EMU;
+  manager->backend_ = (void *)ns;
+  if ((rc = __szd_open_setup(manager, options, &QPairOptions_default)) !=
+      SZD_SC_SUCCESS) {
+    szd_close(manager);
+  }
+  return rc;
+}
+
+int szd_open_bdev(DeviceManager *manager, const char *bdev_name,
+                  DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(bdev_name);
+  RETURN_ERR_ON_NULL(options);
+  if (spdk_unlikely(__is_open(manager))) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  BdevNamespace *ns = NULL;
+  int rc = szd_bdev_open(&ns, bdev_name);
+  if (rc != SZD_SC_SUCCESS) {
+    return rc;
+  }
+  manager->backend = SZD_BACKEND_BDEV;
+  manager->backend_ = (void *)ns;
+  if ((rc = __szd_open_setup(manager, options, &QPairOptions_default)) !=
+      SZD_SC_SUCCESS) {
+    szd_close(manager);
+  }
+  return rc;
+}
+
+// Detaches the members of a group that failed to open from manager.
+static void __szd_open_group_undo(DeviceManager *manager, const char *name) {
+  manager->ctrlr = NULL;
+  manager->ns = NULL;
+  manager->backend = SZD_BACKEND_NVME;
+  manager->backend_ = NULL;
+  manager->info = DeviceInfo_default;
+  manager->info.name = name;
+}
+
+// Closes and frees the first n members of a device group.
+static int __szd_close_group_members(DeviceManager **members, uint32_t n) {
+  int rc = SZD_SC_SUCCESS;
+  for (uint32_t member = 0; member < n; member++) {
+    if (members[member] == NULL) {
+      continue;
+    }
+    if (__is_open(members[member])) {
+      rc = szd_close(members[member]) | rc;
+    }
+    free(members[member]->g_trid);
+    free(members[member]);
+  }
+  free(members);
+  return rc;
+}
+
+// Opens the members of a group with szd_open, or with szd_open_emu when
+// emu_options is not NULL.
+static int __szd_open_group(DeviceManager *manager, const char **traddrs,
+                            const EmuOptions *emu_options, uint32_t n,
+                            DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(options);
+  if (spdk_unlikely(n == 0 || n > MAX_GROUP_DEVICES)) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  DeviceManager **members =
+      (DeviceManager **)calloc(n, sizeof(DeviceManager *));
+  if (spdk_unlikely(members == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  // Members are opened entirely, the group decides what is available.
+  DeviceOpenOptions member_options = DeviceOpenOptions_default;
+  DeviceInfo info = DeviceInfo_default;
+  info.name = manager->info.name;
+  uint64_t member_zones = UINT64_MAX;
+  int rc = SZD_SC_SUCCESS;
+  for (uint32_t member = 0; member < n && rc == SZD_SC_SUCCESS; member++) {
+    members[member] = (DeviceManager *)calloc(1, sizeof(DeviceManager));
+    if (spdk_unlikely(members[member] == NULL)) {
+      rc = SZD_SC_NOT_ALLOCATED;
+      break;
+    }
+    members[member]->info = DeviceInfo_default;
+    members[member]->g_trid =
+        (t_spdk_nvme_transport_id *)calloc(1, sizeof(t_spdk_nvme_transport_id));
+    if (spdk_unlikely(members[member]->g_trid == NULL)) {
+      rc = SZD_SC_NOT_ALLOCATED;
+      break;
+    }
+    spdk_nvme_trid_populate_transport(members[member]->g_trid,
+                                      SPDK_NVME_TRANSPORT_PCIE);
+    rc = emu_options != NULL
+             ? szd_open_emu(members[member], &emu_options[member],
+                            &member_options)
+             : szd_open(members[member], traddrs[member], &member_options);
+    if (rc != SZD_SC_SUCCESS) {
+      break;
+    }
+    // Qpairs of the group have their own member qpairs.
+    __szd_release_spare_qpair(members[member]);
+    // Zones are interleaved, so they need to be interchangeable.
+    DeviceInfo *member_info = &members[member]->info;
+    if (member == 0) {
+      info = *member_info;
+      info.name = manager->info.name;
+    } else if (member_info->lba_size != info.lba_size ||
+               member_info->zone_size != info.zone_size) {
+      SPDK_ERRLOG("SZD: Group member %u has a different geometry\n", member);
+      rc = SZD_SC_SPDK_ERROR_OPEN;
+      break;
+    }
+    info.mdts = spdk_min(info.mdts, member_info->mdts);
+    info.zasl = spdk_min(info.zasl, member_info->zasl);
+    member_zones =
+        spdk_min(member_zones, member_info->lba_cap / member_info->zone_size);
+  }
+  if (rc != SZD_SC_SUCCESS) {
+    __szd_close_group_members(members, n);
+    return rc;
+  }
+  // Every member contributes as many zones as the smallest one.
+  info.lba_cap = member_zones * n * info.zone_size;
+  manager->ctrlr = members[0]->ctrlr;
+  manager->ns = members[0]->ns;
+  manager->backend = members[0]->backend;
+  manager->backend_ = members[0]->backend_;
+  manager->info = info;
+  if ((rc = __szd_open_create_private(manager, options)) != SZD_SC_SUCCESS) {
+    __szd_open_group_undo(manager, info.name);
+    __szd_close_group_members(members, n);
     return rc;
   }
-  // Create a container.
   DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  private_->group_size_ = n;
+  private_->group_ = members;
   manager->info.min_lba = private_->zone_min_ * manager->info.zone_size;
   manager->info.max_lba = private_->zone_max_ * manager->info.zone_size;
+  // The first zone decides the default capacity.
+  if ((rc = __szd_open_seed(manager)) != SZD_SC_SUCCESS) {
+    __szd_free_private(manager);
+    __szd_open_group_undo(manager, info.name);
+    __szd_close_group_members(members, n);
+    return rc;
+  }
   SZD_DTRACE_PROBE(szd_open);
   return rc;
 }
 
+int szd_open_group(DeviceManager *manager, const char **traddrs, uint32_t n,
+                   DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(traddrs);
+  return __szd_open_group(manager, traddrs, NULL, n, options);
+}
+
+int szd_open_group_emu(DeviceManager *manager, const EmuOptions *emu_options,
+                       uint32_t n, DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(emu_options);
+  return __szd_open_group(manager, NULL, emu_options, n, options);
+}
+
 int szd_close(DeviceManager *manager) {
   RETURN_ERR_ON_NULL(manager);
-  if (spdk_unlikely(manager->ctrlr == NULL)) {
+  if (spdk_unlikely(!__is_open(manager))) {
     return SZD_SC_NOT_ALLOCATED;
   }
-  int rc = spdk_nvme_detach(manager->ctrlr);
+  int rc = 0;
+  __szd_release_spare_qpair(manager);
+  // Members of a group are closed by the group, whatever their backend.
+  if (spdk_unlikely(__is_group(manager))) {
+    DeviceManagerInternal *private_ =
+        (DeviceManagerInternal *)manager->private_;
+    rc = __szd_close_group_members(private_->group_, private_->group_size_);
+    manager->backend_ = NULL;
+    manager->backend = SZD_BACKEND_NVME;
+  } else if (manager->backend == SZD_BACKEND_EMU) {
+    szd_emu_close((EmuNamespace *)manager->backend_);
+    manager->backend_ = NULL;
+    manager->backend = SZD_BACKEND_NVME;
+  } else if (manager->backend == SZD_BACKEND_BDEV) {
+    szd_bdev_close((BdevNamespace *)manager->backend_);
+    manager->backend_ = NULL;
+    manager->backend = SZD_BACKEND_NVME;
+  } else {
+    rc = spdk_nvme_detach(manager->ctrlr);
+  }
   manager->ctrlr = NULL;
   manager->ns = NULL;
   // Prevents wrongly assuming a device is attached.
   manager->info = DeviceInfo_default;
   manager->info.name = "\xef\xbe\xad\xde";
-  if (manager->private_ != NULL) {
-    free(manager->private_);
-    manager->private_ = NULL;
-  }
+  __szd_free_private(manager);
   if (manager->g_trid != NULL) {
     memset(manager->g_trid, 0, sizeof(*(manager->g_trid)));
   }
@@ -314,7 +1050,7 @@ int szd_close(DeviceManager *manager) {
 int szd_destroy(DeviceManager *manager) {
   RETURN_ERR_ON_NULL(manager);
   int rc = SZD_SC_SUCCESS;
-  if (manager->ctrlr != NULL) {
+  if (__is_open(manager)) {
     rc = szd_close(manager);
   }
   if (manager->g_trid != NULL) {
@@ -322,6 +1058,7 @@ int szd_destroy(DeviceManager *manager) {
     manager->g_trid = NULL;
   }
   free(manager);
+  szd_bdev_fini();
   spdk_env_fini();
   SZD_DTRACE_PROBE(szd_destroy);
   return rc;
@@ -331,12 +1068,23 @@ int szd_reinit(DeviceManager **manager) {
   RETURN_ERR_ON_NULL(manager);
   RETURN_ERR_ON_NULL(*manager);
   const char *name = (*manager)->info.name;
+  // The bdev layer is torn down as well, which frees its config, so set it up
+  // again with a copy.
+  char *bdev_config = NULL;
+  if (szd_bdev_config() != NULL &&
+      spdk_unlikely((bdev_config = strdup(szd_bdev_config())) == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
   int rc = szd_destroy(*manager);
   if (rc != 0) {
+    free(bdev_config);
     return SZD_SC_SPDK_ERROR_CLOSE;
   }
-  DeviceOptions options = {.name = name, .setup_spdk = false};
-  return szd_init(manager, &options);
+  DeviceOptions options = {
+      .name = name, .setup_spdk = false, .bdev_config = bdev_config};
+  rc = szd_init(manager, &options);
+  free(bdev_config);
+  return rc;
 }
 
 bool __szd_probe_probe_cb(void *cb_ctx,
@@ -391,7 +1139,8 @@ void __szd_probe_attach_cb(void *cb_ctx,
   (void)opts;
 }
 
-int szd_probe(DeviceManager *manager, ProbeInformation **probe) {
+static int __szd_probe(DeviceManager *manager, ProbeInformation **probe,
+                       bool keep_attached) {
   RETURN_ERR_ON_NULL(manager);
   RETURN_ERR_ON_NULL(probe);
   *probe = (ProbeInformation *)calloc(1, sizeof(ProbeInformation));
@@ -405,71 +1154,545 @@ int szd_probe(DeviceManager *manager, ProbeInformation **probe) {
     return SZD_SC_SPDK_ERROR_PROBE;
   }
   int rc;
-  rc = spdk_nvme_probe(manager->g_trid, *probe,
-                       (spdk_nvme_probe_cb)__szd_probe_probe_cb,
-                       (spdk_nvme_attach_cb)__szd_probe_attach_cb, NULL);
+  rc = __szd_probe_async(manager->g_trid, *probe,
+                         (spdk_nvme_probe_cb)__szd_probe_probe_cb,
+                         (spdk_nvme_attach_cb)__szd_probe_attach_cb, NULL);
+  (*probe)->attached_ = true;
   if (rc != 0) {
     return SZD_SC_SPDK_ERROR_PROBE;
   }
+  if (keep_attached) {
+    return SZD_SC_SUCCESS;
+  }
   // Thread safe removing of devices, they have already been probed.
   pthread_mutex_lock((*probe)->mut);
   for (size_t i = 0; i < (*probe)->devices; i++) {
     // keep error message.
     rc = spdk_nvme_detach((*probe)->ctrlr[i]) | rc;
   }
+  (*probe)->attached_ = false;
   pthread_mutex_unlock((*probe)->mut);
   return rc != 0 ? SZD_SC_SPDK_ERROR_PROBE : SZD_SC_SUCCESS;
 }
 
-void szd_free_probe_information(ProbeInformation *probe_info) {
-  free(probe_info->zns);
-  for (uint8_t i = 0; i < probe_info->devices; i++) {
-    free(probe_info->traddr[i]);
-  }
-  free(probe_info->traddr);
-  free(probe_info->ctrlr);
-  free(probe_info->mut);
-  free(probe_info);
+int szd_probe(DeviceManager *manager, ProbeInformation **probe) {
+  return __szd_probe(manager, probe, false);
 }
 
-int szd_create_qpair(DeviceManager *man, QPair **qpair) {
-  RETURN_ERR_ON_NULL(man);
-  RETURN_ERR_ON_NULL(man->ctrlr);
-  RETURN_ERR_ON_NULL(qpair);
-  *qpair = (QPair *)calloc(1, sizeof(QPair));
-  RETURN_ERR_ON_NULL(*qpair);
-  (*qpair)->qpair = spdk_nvme_ctrlr_alloc_io_qpair(man->ctrlr, NULL, 0);
-  (*qpair)->man = man;
-  RETURN_ERR_ON_NULL((*qpair)->qpair);
-  SZD_DTRACE_PROBE(szd_create_qpair);
-  return SZD_SC_SUCCESS;
+int szd_probe_attached(DeviceManager *manager, ProbeInformation **probe) {
+  return __szd_probe(manager, probe, true);
 }
 
-int szd_destroy_qpair(QPair *qpair) {
-  RETURN_ERR_ON_NULL(qpair);
-  RETURN_ERR_ON_NULL(qpair->qpair);
-  spdk_nvme_ctrlr_free_io_qpair(qpair->qpair);
-  qpair->man = NULL;
+int szd_open_probed(DeviceManager *manager, ProbeInformation *probe_info,
+                    const char *traddr, DeviceOpenOptions *options) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(probe_info);
+  RETURN_ERR_ON_NULL(traddr);
+  RETURN_ERR_ON_NULL(options);
+  if (spdk_unlikely(__is_open(manager) || !probe_info->attached_)) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  // Take the controller, it is no longer detached with the probe information.
+  struct spdk_nvme_ctrlr *ctrlr = NULL;
+  pthread_mutex_lock(probe_info->mut);
+  for (uint8_t i = 0; i < probe_info->devices; i++) {
+    if (probe_info->ctrlr[i] != NULL &&
+        strcmp(probe_info->traddr[i], traddr) == 0) {
+      ctrlr = probe_info->ctrlr[i];
+      probe_info->ctrlr[i] = NULL;
+      break;
+    }
+  }
+  pthread_mutex_unlock(probe_info->mut);
+  if (ctrlr == NULL) {
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  DeviceTarget prober = {.manager = manager,
+                         .traddr = traddr,
+                         .traddr_len = strlen(traddr),
+                         .found = false,
+                         .transport = NULL};
+  __szd_open_attach_cb(&prober, NULL, ctrlr, NULL);
+  if (!prober.found) {
+    manager->ctrlr = NULL;
+    spdk_nvme_detach(ctrlr);
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  *manager->g_trid = *spdk_nvme_ctrlr_get_transport_id(ctrlr);
+  return __szd_open_setup(manager, options, &QPairOptions_default);
+}
+
+void szd_free_probe_information(ProbeInformation *probe_info) {
+  // Controllers that are not opened by szd_open_probed.
+  if (probe_info->attached_) {
+    for (uint8_t i = 0; i < probe_info->devices; i++) {
+      if (probe_info->ctrlr[i] != NULL) {
+        spdk_nvme_detach(probe_info->ctrlr[i]);
+      }
+    }
+  }
+  free(probe_info->zns);
+  for (uint8_t i = 0; i < probe_info->devices; i++) {
+    free(probe_info->traddr[i]);
+  }
+  free(probe_info->traddr);
+  free(probe_info->ctrlr);
+  free(probe_info->mut);
+  free(probe_info);
+}
+
+// Frees the first n qpairs of the members of an emulated group.
+static void __szd_free_group_backend_qpairs(QPair *qpair, uint32_t n) {
+  for (uint32_t member = 0; member < n; member++) {
+    szd_emu_free_qpair((EmuQPair *)qpair->group_backend_qpairs_[member]);
+  }
+  free(qpair->group_backend_qpairs_);
+  qpair->group_backend_qpairs_ = NULL;
+}
+
+// One emulated qpair for each member of the group, the smallest one decides
+// how many requests the QPair can have. Returns that size, 0 on failure.
+static uint32_t __szd_alloc_group_backend_qpairs(DeviceManager *man,
+                                                 QPair *qpair,
+                                                 uint32_t requests) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  qpair->group_backend_qpairs_ =
+      (void **)calloc(private_->group_size_, sizeof(void *));
+  if (spdk_unlikely(qpair->group_backend_qpairs_ == NULL)) {
+    return 0;
+  }
+  uint32_t size = UINT32_MAX;
+  for (uint32_t member = 0; member < private_->group_size_; member++) {
+    EmuQPair *emu_qpair = szd_emu_alloc_qpair(
+        (EmuNamespace *)private_->group_[member]->backend_, requests);
+    if (spdk_unlikely(emu_qpair == NULL)) {
+      __szd_free_group_backend_qpairs(qpair, member);
+      return 0;
+    }
+    qpair->group_backend_qpairs_[member] = (void *)emu_qpair;
+    size = spdk_min(size, szd_emu_qpair_size(emu_qpair));
+  }
+  qpair->group_size_ = private_->group_size_;
+  return size;
+}
+
+// Emulated devices and bdevs have no submission queue, only a limited number
+// of requests.
+static int __szd_create_backend_qpair(DeviceManager *man, QPair **qpair,
+                                      const QPairOptions *options) {
+  RETURN_ERR_ON_NULL(man->backend_);
+  *qpair = (QPair *)calloc(1, sizeof(QPair));
+  if (spdk_unlikely(*qpair == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  (*qpair)->man = man;
+  uint32_t requests =
+      spdk_max(options->io_queue_size, options->io_queue_requests);
+  uint32_t size = 0;
+  if (spdk_unlikely(__is_group(man))) {
+    size = __szd_alloc_group_backend_qpairs(man, *qpair, requests);
+  } else if (man->backend == SZD_BACKEND_BDEV) {
+    BdevQPair *bdev_qpair =
+        szd_bdev_alloc_qpair((BdevNamespace *)man->backend_, requests);
+    size = bdev_qpair != NULL ? szd_bdev_qpair_size(bdev_qpair) : 0;
+    (*qpair)->backend_qpair_ = (void *)bdev_qpair;
+  } else {
+    EmuQPair *emu_qpair =
+        szd_emu_alloc_qpair((EmuNamespace *)man->backend_, requests);
+    size = emu_qpair != NULL ? szd_emu_qpair_size(emu_qpair) : 0;
+    (*qpair)->backend_qpair_ = (void *)emu_qpair;
+  }
+  if (spdk_unlikely((*qpair)->backend_qpair_ == NULL &&
+                    (*qpair)->group_backend_qpairs_ == NULL)) {
+    free(*qpair);
+    *qpair = NULL;
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  (*qpair)->options.io_queue_size = size;
+  (*qpair)->options.io_queue_requests = size;
+  (*qpair)->options.delay_cmd_submit = options->delay_cmd_submit;
+  SZD_DTRACE_PROBE(szd_create_qpair);
+  return SZD_SC_SUCCESS;
+}
+
+int szd_create_qpair(DeviceManager *man, QPair **qpair) {
+  RETURN_ERR_ON_NULL(man);
+  // Defaults of the transport the device is opened with, if any.
+  const DeviceManagerInternal *private_ =
+      (const DeviceManagerInternal *)man->private_;
+  return szd_create_qpair_with_options(
+      man, qpair,
+      private_ != NULL ? &private_->qpair_options_ : &QPairOptions_default);
+}
+
+int szd_create_qpair_with_options(DeviceManager *man, QPair **qpair,
+                                  const QPairOptions *options) {
+  RETURN_ERR_ON_NULL(man);
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(options);
+  // The qpair the device was opened with goes to the first qpair created,
+  // if it asks for the same options. Otherwise its I/O queue is given back.
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  QPair *spare = private_ == NULL
+                     ? NULL
+                     : (QPair *)__atomic_exchange_n(&private_->spare_qpair_,
+                                                    NULL, __ATOMIC_ACQ_REL);
+  if (spare != NULL) {
+    if (options->io_queue_size == private_->qpair_options_.io_queue_size &&
+        options->io_queue_requests ==
+            private_->qpair_options_.io_queue_requests &&
+        options->delay_cmd_submit ==
+            private_->qpair_options_.delay_cmd_submit) {
+      *qpair = spare;
+      SZD_DTRACE_PROBE(szd_create_qpair);
+      return SZD_SC_SUCCESS;
+    }
+    szd_destroy_qpair(spare);
+  }
+  if (spdk_unlikely(man->backend != SZD_BACKEND_NVME)) {
+    return __szd_create_backend_qpair(man, qpair, options);
+  }
+  RETURN_ERR_ON_NULL(man->ctrlr);
+  struct spdk_nvme_io_qpair_opts opts;
+  spdk_nvme_ctrlr_get_default_io_qpair_opts(man->ctrlr, &opts, sizeof(opts));
+  if (options->io_queue_size != 0) {
+    // The controller decides how large a queue can be (MQES is 0's based).
+    uint32_t max_queue_size =
+        (uint32_t)spdk_nvme_ctrlr_get_regs_cap(man->ctrlr).bits.mqes + 1;
+    opts.io_queue_size = options->io_queue_size > max_queue_size
+                             ? max_queue_size
+                             : options->io_queue_size;
+  }
+  if (options->io_queue_requests != 0) {
+    opts.io_queue_requests = options->io_queue_requests;
+  }
+  // Fewer requests than entries would leave entries unused.
+  if (opts.io_queue_requests < opts.io_queue_size) {
+    opts.io_queue_requests = opts.io_queue_size;
+  }
+  opts.delay_cmd_submit = options->delay_cmd_submit;
+
+  QPair *new_qpair = (QPair *)calloc(1, sizeof(QPair));
+  if (spdk_unlikely(new_qpair == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  new_qpair->man = man;
+  if (spdk_unlikely(__is_group(man))) {
+    // One qpair for each member, the first one doubles as the QPair's own.
+    new_qpair->group_qpairs_ = (t_spdk_nvme_qpair **)calloc(
+        private_->group_size_, sizeof(t_spdk_nvme_qpair *));
+    if (spdk_unlikely(new_qpair->group_qpairs_ == NULL)) {
+      free(new_qpair);
+      return SZD_SC_NOT_ALLOCATED;
+    }
+    new_qpair->group_size_ = private_->group_size_;
+    for (uint32_t member = 0; member < private_->group_size_; member++) {
+      new_qpair->group_qpairs_[member] = spdk_nvme_ctrlr_alloc_io_qpair(
+          private_->group_[member]->ctrlr, &opts, sizeof(opts));
+      if (spdk_unlikely(new_qpair->group_qpairs_[member] == NULL)) {
+        // Free the qpairs of the members before this one.
+        while (member-- > 0) {
+          spdk_nvme_ctrlr_free_io_qpair(new_qpair->group_qpairs_[member]);
+        }
+        free(new_qpair->group_qpairs_);
+        free(new_qpair);
+        return SZD_SC_NOT_ALLOCATED;
+      }
+    }
+    new_qpair->qpair = new_qpair->group_qpairs_[0];
+  } else {
+    new_qpair->qpair =
+        spdk_nvme_ctrlr_alloc_io_qpair(man->ctrlr, &opts, sizeof(opts));
+    if (spdk_unlikely(new_qpair->qpair == NULL)) {
+      free(new_qpair);
+      return SZD_SC_NOT_ALLOCATED;
+    }
+  }
+  new_qpair->options.io_queue_size = opts.io_queue_size;
+  new_qpair->options.io_queue_requests = opts.io_queue_requests;
+  new_qpair->options.delay_cmd_submit = opts.delay_cmd_submit;
+  *qpair = new_qpair;
+  SZD_DTRACE_PROBE(szd_create_qpair);
+  return SZD_SC_SUCCESS;
+}
+
+int szd_set_wait_policy(QPair *qpair, WaitPolicy policy) {
+  RETURN_ERR_ON_NULL(qpair);
+  if (spdk_unlikely(policy != SZD_WAIT_SPIN && policy != SZD_WAIT_SPIN_YIELD &&
+                    policy != SZD_WAIT_HYBRID)) {
+    return SZD_SC_SPDK_ERROR_QPAIR;
+  }
+  qpair->wait_policy_ = policy;
+  return SZD_SC_SUCCESS;
+}
+
+int szd_get_wait_stats(QPair *qpair, WaitStats *stats) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(stats);
+  *stats = qpair->wait_stats_;
+  return SZD_SC_SUCCESS;
+}
+
+int szd_destroy_qpair(QPair *qpair) {
+  RETURN_ERR_ON_NULL(qpair);
+  if (qpair->backend_qpair_ != NULL) {
+    if (qpair->man->backend == SZD_BACKEND_BDEV) {
+      szd_bdev_free_qpair((BdevQPair *)qpair->backend_qpair_);
+    } else {
+      szd_emu_free_qpair((EmuQPair *)qpair->backend_qpair_);
+    }
+  } else if (qpair->group_backend_qpairs_ != NULL) {
+    __szd_free_group_backend_qpairs(qpair, qpair->group_size_);
+  } else if (qpair->qpair == NULL) {
+    return SZD_SC_NOT_ALLOCATED;
+  } else if (qpair->group_qpairs_ != NULL) {
+    for (uint32_t member = 0; member < qpair->group_size_; member++) {
+      spdk_nvme_ctrlr_free_io_qpair(qpair->group_qpairs_[member]);
+    }
+    free(qpair->group_qpairs_);
+  } else {
+    spdk_nvme_ctrlr_free_io_qpair(qpair->qpair);
+  }
+  qpair->man = NULL;
+  free(qpair->cb_requests_);
   free(qpair);
   SZD_DTRACE_PROBE(szd_destroy_qpair);
   return SZD_SC_SUCCESS;
 }
 
 void *__reserve_dma(uint64_t size) {
-  return spdk_zmalloc(size, 0, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+  // There is no device to go by, the reserving thread is the one to use it.
+  int32_t socket_id = szd_current_socket_id();
+  void *buffer = spdk_zmalloc(size, 0, NULL, socket_id, SPDK_MALLOC_DMA);
+  if (spdk_unlikely(buffer == NULL && socket_id != SZD_SOCKET_ID_ANY)) {
+    buffer = spdk_zmalloc(size, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+                          SPDK_MALLOC_DMA);
+  }
+  return buffer;
 }
 
 void *szd_calloc(uint64_t __allign, size_t __nmemb, size_t __size) {
+  return szd_calloc_socket(__allign, __nmemb, __size, SZD_SOCKET_ID_ANY);
+}
+
+void *szd_calloc_socket(uint64_t __allign, size_t __nmemb, size_t __size,
+                        int32_t socket_id) {
   size_t expanded_size = __nmemb * __size;
-  if (spdk_unlikely(expanded_size % __allign != 0 || __allign == 0)) {
+  if (spdk_unlikely(__allign == 0 || expanded_size % __allign != 0)) {
     return NULL;
   }
-  return spdk_zmalloc(expanded_size, __allign, NULL, SPDK_ENV_SOCKET_ID_ANY,
-                      SPDK_MALLOC_DMA);
+  void *buffer = spdk_zmalloc(expanded_size, __allign, NULL, socket_id,
+                              SPDK_MALLOC_DMA);
+  // Remote memory is slower, but still better than no memory.
+  if (spdk_unlikely(buffer == NULL && socket_id != SZD_SOCKET_ID_ANY)) {
+    buffer = spdk_zmalloc(expanded_size, __allign, NULL,
+                          SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+  }
+  return buffer;
 }
 
 void szd_free(void *buffer) { spdk_free(buffer); }
 
+bool szd_dma_capable(const DeviceManager *manager, const void *buffer,
+                     uint64_t size) {
+  if (spdk_unlikely(manager == NULL || buffer == NULL)) {
+    return false;
+  }
+  // Also for emulated devices, so that what passes on the emulator also passes
+  // on an SSD. PRPs and SGLs need dword aligned addresses.
+  if (((uintptr_t)buffer & 0x3) != 0) {
+    return false;
+  }
+  // Each translation covers one physically contiguous part of the buffer.
+  const char *part = (const char *)buffer;
+  while (size > 0) {
+    uint64_t part_size = size;
+    if (spdk_vtophys(part, &part_size) == SPDK_VTOPHYS_ERROR ||
+        part_size == 0) {
+      return false;
+    }
+    part_size = spdk_min(part_size, size);
+    part += part_size;
+    size -= part_size;
+  }
+  return true;
+}
+
+// Smallest class that fits size, classes are powers of two lbas.
+static inline uint32_t __dma_class(const DMAPool *pool, uint64_t size) {
+  uint64_t lbas = (size + pool->lba_size - 1) / pool->lba_size;
+  return lbas <= 1 ? 0 : 64 - __builtin_clzll(lbas - 1);
+}
+
+static inline void __dma_list_push(DMAFreeList *list, void *buffer) {
+  *(void **)buffer = list->head_;
+  list->head_ = buffer;
+  list->count_++;
+}
+
+static inline void *__dma_list_pop(DMAFreeList *list) {
+  void *buffer = list->head_;
+  list->head_ = *(void **)buffer;
+  list->count_--;
+  return buffer;
+}
+
+static inline void __dma_pool_lock(DMAPool *pool) {
+  while (__atomic_test_and_set(&pool->lock_, __ATOMIC_ACQUIRE)) {
+    while (__atomic_load_n(&pool->lock_, __ATOMIC_RELAXED)) {
+    }
+  }
+}
+
+static inline void __dma_pool_unlock(DMAPool *pool) {
+  __atomic_clear(&pool->lock_, __ATOMIC_RELEASE);
+}
+
+static void __dma_pool_unref(DMAPool *pool) {
+  if (__atomic_sub_fetch(&pool->refs_, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
+  }
+  for (uint32_t c = 0; c < pool->classes; c++) {
+    while (pool->depot_[c].count_ > 0) {
+      spdk_free(__dma_list_pop(&pool->depot_[c]));
+    }
+  }
+  free(pool);
+}
+
+int szd_dma_pool_create(DMAPool **pool, uint64_t lba_size, uint64_t max_size,
+                        int32_t socket_id) {
+  RETURN_ERR_ON_NULL(pool);
+  // Free buffers hold the link to the next one.
+  if (spdk_unlikely(lba_size < sizeof(void *) || max_size < lba_size)) {
+    return SZD_SC_SPDK_ERROR_ZCALLOC;
+  }
+  *pool = (DMAPool *)calloc(1, sizeof(DMAPool));
+  if (spdk_unlikely(*pool == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  (*pool)->lba_size = lba_size;
+  (*pool)->classes = __dma_class(*pool, max_size) + 1;
+  if ((*pool)->classes > SZD_DMA_POOL_MAX_CLASSES) {
+    (*pool)->classes = SZD_DMA_POOL_MAX_CLASSES;
+  }
+  (*pool)->max_size = lba_size << ((*pool)->classes - 1);
+  (*pool)->socket_id = socket_id;
+  (*pool)->refs_ = 1;
+  return SZD_SC_SUCCESS;
+}
+
+int szd_dma_pool_destroy(DMAPool *pool) {
+  RETURN_ERR_ON_NULL(pool);
+  __dma_pool_unref(pool);
+  return SZD_SC_SUCCESS;
+}
+
+int szd_dma_cache_create(DMAPool *pool, DMACache **cache) {
+  RETURN_ERR_ON_NULL(pool);
+  RETURN_ERR_ON_NULL(cache);
+  *cache = (DMACache *)calloc(1, sizeof(DMACache));
+  if (spdk_unlikely(*cache == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  (*cache)->pool = pool;
+  __atomic_add_fetch(&pool->refs_, 1, __ATOMIC_RELAXED);
+  return SZD_SC_SUCCESS;
+}
+
+// Moves up to n buffers of class c from the cache to the pool, the pool frees
+// what it can not keep.
+static void __dma_cache_flush(DMACache *cache, uint32_t c, uint32_t n) {
+  DMAPool *pool = cache->pool;
+  DMAFreeList *list = &cache->free_[c];
+  void *overflow = NULL;
+  __dma_pool_lock(pool);
+  while (n-- > 0 && list->count_ > 0) {
+    void *buffer = __dma_list_pop(list);
+    if (pool->depot_[c].count_ < SZD_DMA_POOL_DEPOT) {
+      __dma_list_push(&pool->depot_[c], buffer);
+    } else {
+      *(void **)buffer = overflow;
+      overflow = buffer;
+    }
+  }
+  __dma_pool_unlock(pool);
+  // Do not hold the lock while calling into the heap.
+  while (overflow != NULL) {
+    void *next = *(void **)overflow;
+    spdk_free(overflow);
+    overflow = next;
+  }
+}
+
+int szd_dma_cache_destroy(DMACache *cache) {
+  RETURN_ERR_ON_NULL(cache);
+  for (uint32_t c = 0; c < cache->pool->classes; c++) {
+    __dma_cache_flush(cache, c, cache->free_[c].count_);
+  }
+  __dma_pool_unref(cache->pool);
+  free(cache);
+  return SZD_SC_SUCCESS;
+}
+
+void *szd_dma_get(DMACache *cache, uint64_t size, bool zero) {
+  if (spdk_unlikely(cache == NULL)) {
+    return NULL;
+  }
+  DMAPool *pool = cache->pool;
+  uint32_t c = __dma_class(pool, size);
+  // Not pooled, as large buffers are rare.
+  if (spdk_unlikely(c >= pool->classes)) {
+    uint64_t alligned_size =
+        (size + pool->lba_size - 1) / pool->lba_size * pool->lba_size;
+    return szd_calloc_socket(pool->lba_size, 1, alligned_size,
+                             pool->socket_id);
+  }
+  uint64_t class_size = pool->lba_size << c;
+  DMAFreeList *list = &cache->free_[c];
+  if (spdk_unlikely(list->count_ == 0)) {
+    __dma_pool_lock(pool);
+    for (uint32_t i = 0; i < SZD_DMA_CACHE_BATCH && pool->depot_[c].count_ > 0;
+         i++) {
+      __dma_list_push(list, __dma_list_pop(&pool->depot_[c]));
+    }
+    __dma_pool_unlock(pool);
+  }
+  void *buffer;
+  if (spdk_likely(list->count_ > 0)) {
+    buffer = __dma_list_pop(list);
+  } else {
+    buffer = spdk_malloc(class_size, pool->lba_size, NULL, pool->socket_id,
+                         SPDK_MALLOC_DMA);
+    if (spdk_unlikely(buffer == NULL && pool->socket_id != SZD_SOCKET_ID_ANY)) {
+      buffer = spdk_malloc(class_size, pool->lba_size, NULL,
+                           SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+    }
+    if (spdk_unlikely(buffer == NULL)) {
+      return NULL;
+    }
+  }
+  if (zero) {
+    memset(buffer, 0, class_size);
+  }
+  return buffer;
+}
+
+void szd_dma_put(DMACache *cache, void *buffer, uint64_t size) {
+  if (spdk_unlikely(cache == NULL || buffer == NULL)) {
+    return;
+  }
+  uint32_t c = __dma_class(cache->pool, size);
+  if (spdk_unlikely(c >= cache->pool->classes)) {
+    spdk_free(buffer);
+    return;
+  }
+  __dma_list_push(&cache->free_[c], buffer);
+  if (spdk_unlikely(cache->free_[c].count_ > SZD_DMA_CACHE_SIZE)) {
+    __dma_cache_flush(cache, c, SZD_DMA_CACHE_BATCH);
+  }
+}
+
 void __operation_complete(void *arg, const struct spdk_nvme_cpl *completion) {
   Completion *completed = (Completion *)arg;
   completed->done = true;
@@ -479,60 +1702,616 @@ void __operation_complete(void *arg, const struct spdk_nvme_cpl *completion) {
 }
 
 void __append_complete(void *arg, const struct spdk_nvme_cpl *completion) {
+  Completion *completed = (Completion *)arg;
+  if (completed->man_ != NULL && !spdk_nvme_cpl_is_error(completion)) {
+    uint64_t alba = __append_alba(completed, completion);
+    __zone_table_advance(completed->man_, alba + completed->nr_);
+  }
+  __operation_complete(arg, completion);
+}
+
+void __copy_complete(void *arg, const struct spdk_nvme_cpl *completion) {
+  Completion *completed = (Completion *)arg;
+  // Copies do not return an lba, they write at the head they are given.
+  if (completed->man_ != NULL && !spdk_nvme_cpl_is_error(completion)) {
+    __zone_table_advance(completed->man_, completed->slba_ + completed->nr_);
+  }
   __operation_complete(arg, completion);
 }
 
+void __append_pipelined_complete(void *arg,
+                                 const struct spdk_nvme_cpl *completion) {
+  PipelinedCompletion *completed = (PipelinedCompletion *)arg;
+  completed->alba = __append_alba(&completed->completion, completion);
+  __append_complete(&completed->completion, completion);
+}
+
+void __zone_table_track(Completion *completion, DeviceManager *man,
+                        uint64_t slba, uint64_t nr) {
+  completion->man_ = man;
+  completion->slba_ = slba;
+  completion->nr_ = nr;
+}
+
+// Returns the index of the zone in the zone state table, or -1 if untracked.
+static inline int64_t __zone_table_index(DeviceManager *man, uint64_t slba) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  if (spdk_unlikely(private_ == NULL || private_->zone_wp_ == NULL)) {
+    return -1;
+  }
+  uint64_t zone = slba / man->info.zone_size;
+  if (spdk_unlikely(zone < private_->zone_min_ ||
+                    zone >= private_->zone_max_)) {
+    return -1;
+  }
+  return (int64_t)(zone - private_->zone_min_);
+}
+
+// Capacity of the zone starting at slba, zones outside of the table (or
+// before it is seeded) are assumed to have the capacity of the first zone.
+static inline uint64_t __zone_cap_of(DeviceManager *man, uint64_t slba) {
+  int64_t idx = __zone_table_index(man, slba);
+  if (spdk_unlikely(idx < 0)) {
+    return man->info.zone_cap;
+  }
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  uint64_t cap = __atomic_load_n(&private_->zone_cap_[idx], __ATOMIC_RELAXED);
+  return spdk_unlikely(cap == 0) ? man->info.zone_cap : cap;
+}
+
+// Number of zone borders crossed when processing lbas from the start of the
+// zone at slba, respecting the capacity of each zone.
+static inline uint64_t __zones_traversed(DeviceManager *man, uint64_t slba,
+                                         uint64_t lbas) {
+  uint64_t zones = 0;
+  uint64_t cap = __zone_cap_of(man, slba);
+  while (lbas >= cap) {
+    lbas -= cap;
+    zones++;
+    slba += man->info.zone_size;
+    cap = __zone_cap_of(man, slba);
+  }
+  return zones;
+}
+
+void __zone_table_advance(DeviceManager *man, uint64_t wp) {
+  // wp can be the first lba of the next zone, when a zone is completely full.
+  int64_t idx = __zone_table_index(man, wp - 1);
+  if (spdk_unlikely(idx < 0)) {
+    return;
+  }
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  // Appends to one zone can complete out of order, only move forward.
+  uint64_t old_wp = __atomic_load_n(&private_->zone_wp_[idx], __ATOMIC_RELAXED);
+  while (old_wp < wp && !__atomic_compare_exchange_n(
+                            &private_->zone_wp_[idx], &old_wp, wp, true,
+                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  uint64_t zslba = ((wp - 1) / man->info.zone_size) * man->info.zone_size;
+  uint64_t cap = __atomic_load_n(&private_->zone_cap_[idx], __ATOMIC_RELAXED);
+  if (wp >= zslba + cap) {
+    __atomic_store_n(&private_->zone_state_[idx], SZD_ZONE_FULL,
+                     __ATOMIC_RELEASE);
+  } else if (__atomic_load_n(&private_->zone_state_[idx], __ATOMIC_RELAXED) !=
+             SZD_ZONE_EXPLICIT_OPEN) {
+    __atomic_store_n(&private_->zone_state_[idx], SZD_ZONE_IMPLICIT_OPEN,
+                     __ATOMIC_RELEASE);
+  }
+}
+
+void __zone_table_reset(DeviceManager *man, uint64_t slba, uint64_t nr_zones) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  for (uint64_t zone = 0; zone < nr_zones; zone++) {
+    uint64_t zslba = slba + zone * man->info.zone_size;
+    int64_t idx = __zone_table_index(man, zslba);
+    if (idx < 0) {
+      continue;
+    }
+    __atomic_store_n(&private_->zone_wp_[idx], zslba, __ATOMIC_RELEASE);
+    __atomic_store_n(&private_->zone_state_[idx], SZD_ZONE_EMPTY,
+                     __ATOMIC_RELEASE);
+  }
+}
+
+// Overwrites the state of one zone with what the device reported, returns
+// whether the capacity of the zone changed.
+static inline bool
+__zone_table_sync(DeviceManager *man,
+                  const struct spdk_nvme_zns_zone_desc *desc) {
+  int64_t idx = __zone_table_index(man, desc->zslba);
+  if (spdk_unlikely(idx < 0)) {
+    return false;
+  }
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  uint64_t cap = __atomic_exchange_n(&private_->zone_cap_[idx], desc->zcap,
+                                     __ATOMIC_ACQ_REL);
+  __atomic_store_n(&private_->zone_wp_[idx], desc->wp, __ATOMIC_RELEASE);
+  __atomic_store_n(&private_->zone_state_[idx], (uint8_t)desc->zs,
+                   __ATOMIC_RELEASE);
+  return cap != desc->zcap;
+}
+
+void __zone_table_build_prefix(DeviceManager *man) {
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  uint64_t zones = private_->zone_max_ - private_->zone_min_;
+  // Zones before the table are not accessible, give them the first capacity.
+  uint64_t lba = private_->zone_min_ * private_->zone_cap_[0];
+  for (uint64_t zone = 0; zone < zones; zone++) {
+    __atomic_store_n(&private_->zone_cap_prefix_[zone], lba, __ATOMIC_RELAXED);
+    lba += __atomic_load_n(&private_->zone_cap_[zone], __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&private_->zone_cap_prefix_[zones], lba, __ATOMIC_RELEASE);
+}
+
+void __zone_table_finish(DeviceManager *man, uint64_t slba) {
+  int64_t idx = __zone_table_index(man, slba);
+  if (spdk_unlikely(idx < 0)) {
+    return;
+  }
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)man->private_;
+  uint64_t cap = __atomic_load_n(&private_->zone_cap_[idx], __ATOMIC_RELAXED);
+  __atomic_store_n(&private_->zone_wp_[idx], slba + cap, __ATOMIC_RELEASE);
+  __atomic_store_n(&private_->zone_state_[idx], SZD_ZONE_FULL,
+                   __ATOMIC_RELEASE);
+}
+
 void __read_complete(void *arg, const struct spdk_nvme_cpl *completion) {
   __operation_complete(arg, completion);
 }
 
+void __sgl_reset(void *arg, uint32_t offset) {
+  VectoredCompletion *ctx = (VectoredCompletion *)arg;
+  uint64_t skip = ctx->base + offset;
+  ctx->iov_pos = 0;
+  while (ctx->iov_pos < ctx->iovcnt && skip >= ctx->iov[ctx->iov_pos].iov_len) {
+    skip -= ctx->iov[ctx->iov_pos].iov_len;
+    ctx->iov_pos++;
+  }
+  ctx->iov_offset = skip;
+}
+
+// SGE lengths are 32 bits, larger segments are handed out in (page aligned)
+// parts of this size.
+#define SZD_MAX_SGE_LENGTH 0x80000000ULL
+
+int __sgl_next_sge(void *arg, void **address, uint32_t *length) {
+  VectoredCompletion *ctx = (VectoredCompletion *)arg;
+  if (spdk_unlikely(ctx->iov_pos >= ctx->iovcnt)) {
+    return -1;
+  }
+  const struct iovec *seg = &ctx->iov[ctx->iov_pos];
+  uint64_t left = seg->iov_len - ctx->iov_offset;
+  *address = (char *)seg->iov_base + ctx->iov_offset;
+  if (spdk_unlikely(left > SZD_MAX_SGE_LENGTH)) {
+    *length = (uint32_t)SZD_MAX_SGE_LENGTH;
+    ctx->iov_offset += SZD_MAX_SGE_LENGTH;
+    return 0;
+  }
+  *length = (uint32_t)left;
+  ctx->iov_pos++;
+  ctx->iov_offset = 0;
+  return 0;
+}
+
 void __reset_zone_complete(void *arg, const struct spdk_nvme_cpl *completion) {
+  Completion *completed = (Completion *)arg;
+  if (completed->man_ != NULL && !spdk_nvme_cpl_is_error(completion)) {
+    __zone_table_reset(completed->man_, completed->slba_, completed->nr_);
+  }
   __operation_complete(arg, completion);
 }
 
 void __finish_zone_complete(void *arg, const struct spdk_nvme_cpl *completion) {
+  Completion *completed = (Completion *)arg;
+  if (completed->man_ != NULL && !spdk_nvme_cpl_is_error(completion)) {
+    __zone_table_finish(completed->man_, completed->slba_);
+  }
+  __operation_complete(arg, completion);
+}
+
+void __get_zone_head_complete(void *arg,
+                              const struct spdk_nvme_cpl *completion) {
   __operation_complete(arg, completion);
 }
 
-void __get_zone_head_complete(void *arg,
-                              const struct spdk_nvme_cpl *completion) {
-  __operation_complete(arg, completion);
+static inline CallbackRequest *__callback_request_get(QPair *qpair) {
+  CallbackPool *pool = (CallbackPool *)qpair->cb_requests_;
+  // Only QPairs that use callbacks pay for the pool.
+  if (spdk_unlikely(pool == NULL)) {
+    pool = (CallbackPool *)calloc(1, sizeof(CallbackPool));
+    if (spdk_unlikely(pool == NULL)) {
+      return NULL;
+    }
+    for (uint32_t i = 0; i < MAX_CALLBACK_REQUESTS; i++) {
+      pool->requests[i].pool = pool;
+      pool->requests[i].next =
+          i + 1 < MAX_CALLBACK_REQUESTS ? &pool->requests[i + 1] : NULL;
+    }
+    pool->free_requests = &pool->requests[0];
+    qpair->cb_requests_ = (void *)pool;
+  }
+  CallbackRequest *request = pool->free_requests;
+  if (spdk_likely(request != NULL)) {
+    pool->free_requests = request->next;
+  }
+  return request;
+}
+
+static inline void __callback_request_put(CallbackRequest *request) {
+  request->next = request->pool->free_requests;
+  request->pool->free_requests = request;
+}
+
+void __callback_complete(void *arg, const struct spdk_nvme_cpl *completion) {
+  CallbackRequest *request = (CallbackRequest *)arg;
+  // Keeps the zone state table up to date, same as the polled variants.
+  request->complete_fn(&request->completion, completion);
+  uint64_t lba = request->lba;
+  if (request->complete_fn == __append_complete &&
+      !spdk_nvme_cpl_is_error(completion)) {
+    lba = __append_alba(&request->completion, completion);
+  }
+  szd_completion_cb cb = request->cb;
+  void *cb_arg = request->cb_arg;
+  uint16_t err = request->completion.err;
+  if (request->complete_fn == __append_complete) {
+    SZD_DTRACE_PROBE4(szd_append_async_done, cb_arg,
+                      request->completion.slba_, request->completion.nr_,
+                      err);
+  }
+  // Release first, so that the callback can submit again.
+  __callback_request_put(request);
+  cb(cb_arg, err, lba);
+}
+
+static inline uint64_t __ticks_to_ns(uint64_t ticks, uint64_t hz) {
+  // Split to not overflow on long waits.
+  return (ticks / hz) * 1000000000ULL + (ticks % hz) * 1000000000ULL / hz;
+}
+
+// Sleeps or yields for at most ns (yield when ns is 0), returns time passed.
+static uint64_t __wait_idle(uint64_t ns, uint64_t hz) {
+  uint64_t start = spdk_get_ticks();
+  if (ns == 0) {
+    sched_yield();
+  } else {
+    struct timespec ts = {.tv_sec = (time_t)(ns / 1000000000ULL),
+                          .tv_nsec = (long)(ns % 1000000000ULL)};
+    nanosleep(&ts, NULL);
+  }
+  return __ticks_to_ns(spdk_get_ticks() - start, hz);
+}
+
+// Waits for done according to the wait policy of qpair.
+static void __wait_qpair(QPair *qpair, const bool *done, WaitOp op) {
+  WaitStats *stats = &qpair->wait_stats_;
+  const uint64_t hz = spdk_get_ticks_hz();
+  const uint64_t start = spdk_get_ticks();
+  uint64_t idle_ns = 0;
+  uint64_t elapsed_ns = 0;
+  bool may_sleep = qpair->wait_policy_ == SZD_WAIT_HYBRID;
+  stats->waits++;
+  for (;;) {
+    __qpair_process_completions(qpair, 0);
+    if (*done) {
+      break;
+    }
+    elapsed_ns = __ticks_to_ns(spdk_get_ticks() - start, hz);
+    if (may_sleep) {
+      // Sleep once for half of what this operation usually takes.
+      may_sleep = false;
+      uint64_t sleep_ns = stats->ewma_ns[op] / 2;
+      if (sleep_ns > elapsed_ns + SZD_WAIT_MIN_SLEEP_NS) {
+        idle_ns = __wait_idle(sleep_ns - elapsed_ns, hz);
+        stats->sleeps++;
+        stats->saved_ns += idle_ns;
+        continue;
+      }
+    }
+    if (elapsed_ns >= SZD_WAIT_SPIN_NS) {
+      idle_ns = __wait_idle(0, hz);
+      stats->yields++;
+      stats->saved_ns += idle_ns;
+    } else {
+      idle_ns = 0;
+    }
+  }
+  // The completion arrived somewhere during the last sleep or yield.
+  stats->added_latency_ns += idle_ns / 2;
+  elapsed_ns = __ticks_to_ns(spdk_get_ticks() - start, hz);
+  if (spdk_unlikely(stats->ewma_ns[op] == 0)) {
+    stats->ewma_ns[op] = elapsed_ns;
+  } else {
+    stats->ewma_ns[op] =
+        stats->ewma_ns[op] - (stats->ewma_ns[op] >> SZD_WAIT_EWMA_SHIFT) +
+        (elapsed_ns >> SZD_WAIT_EWMA_SHIFT);
+  }
+}
+
+// Spinning is the default, it is kept free of any bookkeeping.
+#define POLL_QPAIR(qpair, target, op)                                          \
+  do {                                                                         \
+    if (spdk_likely((qpair)->wait_policy_ == SZD_WAIT_SPIN)) {                 \
+      do {                                                                     \
+        __qpair_process_completions((qpair), 0);                               \
+      } while (!(target));                                                     \
+    } else {                                                                   \
+      __wait_qpair((qpair), &(target), (op));                                  \
+    }                                                                          \
+  } while (0)
+
+// Arguments of the data path probes (only evaluated with SZD_USDT).
+static inline uint64_t __probe_lbas(const QPair *qpair, uint64_t size) {
+  if (qpair == NULL || qpair->man == NULL || qpair->man->info.lba_size == 0) {
+    return 0;
+  }
+  return (size + qpair->man->info.lba_size - 1) / qpair->man->info.lba_size;
+}
+
+static inline uint64_t __probe_zone_size(const QPair *qpair) {
+  return qpair == NULL || qpair->man == NULL ? 0 : qpair->man->info.zone_size;
+}
+
+static int __szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer,
+                                uint64_t size, uint64_t *nr_reads) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  int rc = SZD_SC_SUCCESS;
+  DeviceInfo info = qpair->man->info;
+
+  // zone pointers
+  uint64_t slba = (lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(lba >= current_zone_end)) {
+    slba += info.zone_size;
+    lba = slba + lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  // Progress variables
+  uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
+  uint64_t lbas_processed = 0;
+  // Used to determine next IO call
+  uint64_t step_size =
+      (info.mdts / info.lba_size); // If lba_size > mdts, we have a big problem,
+                                   // but not because of the read.
+  uint64_t current_step_size = step_size;
+  Completion completion = Completion_default;
+
+  // Otherwise we have an out of range.
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (lba - slba));
+  if (spdk_unlikely(lba < info.min_lba ||
+                    slba + number_of_zones_traversed * info.zone_size >
+                        info.max_lba)) {
+    return SZD_SC_SPDK_ERROR_READ;
+  }
+
+  // Read in steps of max MDTS bytess and respect boundaries
+  while (lbas_processed < lbas_to_process) {
+    // Read accross a zone border.
+    if (lba + step_size >= current_zone_end) {
+      current_step_size = current_zone_end - lba;
+    } else {
+      current_step_size = step_size;
+    }
+    // Do not read too much (more than mdts or requested)
+    current_step_size = lbas_to_process - lbas_processed > current_step_size
+                            ? current_step_size
+                            : lbas_to_process - lbas_processed;
+
+    completion.done = false;
+    completion.err = 0x00;
+    SubmitTarget target = __submit_target(qpair, lba);
+    rc = __cmd_read(&target, (char *)buffer + lbas_processed * info.lba_size,
+                    current_step_size, /* number of LBAs */
+                    __read_complete, &completion);
+#ifdef SZD_PERF_COUNTERS
+    if (nr_reads != NULL) {
+      *nr_reads += 1;
+    }
+#else
+    (void)nr_reads;
+#endif
+    if (spdk_unlikely(rc != 0)) {
+      return SZD_SC_SPDK_ERROR_READ;
+    }
+    // Synchronous reads, busy wait.
+    POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_READ);
+    if (spdk_unlikely(completion.err != 0)) {
+      return SZD_SC_SPDK_ERROR_READ;
+    }
+    lbas_processed += current_step_size;
+    lba += current_step_size;
+    // To the next zone we go
+    if (lba >= current_zone_end) {
+      slba += info.zone_size;
+      lba = slba;
+      current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+    }
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                       uint64_t *nr_reads) {
+  SZD_DTRACE_PROBE3(szd_read_start, qpair, lba, __probe_lbas(qpair, size));
+  int rc = __szd_read_with_diag(qpair, lba, buffer, size, nr_reads);
+  SZD_DTRACE_PROBE4(szd_read_done, qpair, lba, __probe_lbas(qpair, size), rc);
+  return rc;
+}
+
+int szd_read(QPair *qpair, uint64_t lba, void *buffer, uint64_t size) {
+  return szd_read_with_diag(qpair, lba, buffer, size, NULL);
+}
+
+int szd_read_pipelined_with_diag(QPair *qpair, uint64_t lba, void *buffer,
+                                 uint64_t size, uint64_t *nr_reads,
+                                 uint32_t queue_depth) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  if (queue_depth <= 1) {
+    return szd_read_with_diag(qpair, lba, buffer, size, nr_reads);
+  }
+  queue_depth =
+      queue_depth > MAX_PIPELINE_DEPTH ? MAX_PIPELINE_DEPTH : queue_depth;
+  int rc = SZD_SC_SUCCESS;
+  DeviceInfo info = qpair->man->info;
+
+  // zone pointers
+  uint64_t slba = (lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(lba >= current_zone_end)) {
+    slba += info.zone_size;
+    lba = slba + lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  // Progress variables
+  uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
+  uint64_t lbas_processed = 0;
+  // Used to determine next IO call
+  uint64_t step_size = (info.mdts / info.lba_size);
+  uint64_t current_step_size = step_size;
+  Completion completions[MAX_PIPELINE_DEPTH];
+  bool in_flight[MAX_PIPELINE_DEPTH] = {false};
+  uint64_t seq[MAX_PIPELINE_DEPTH];
+  uint64_t issued = 0;
+  uint32_t outstanding = 0;
+
+  // Otherwise we have an out of range.
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (lba - slba));
+  if (spdk_unlikely(lba < info.min_lba ||
+                    slba + number_of_zones_traversed * info.zone_size >
+                        info.max_lba)) {
+    return SZD_SC_SPDK_ERROR_READ;
+  }
+
+  // Keep reading in steps of max MDTS bytes till all are issued and done.
+  // On an error we stop issuing, but still wait for the outstanding reads.
+  while ((rc == SZD_SC_SUCCESS && lbas_processed < lbas_to_process) ||
+         outstanding > 0) {
+    for (uint32_t slot = 0;
+         slot < queue_depth && rc == SZD_SC_SUCCESS &&
+         lbas_processed < lbas_to_process;
+         slot++) {
+      if (in_flight[slot]) {
+        continue;
+      }
+      // Read accross a zone border.
+      if (lba + step_size >= current_zone_end) {
+        current_step_size = current_zone_end - lba;
+      } else {
+        current_step_size = step_size;
+      }
+      // Do not read too much (more than mdts or requested)
+      current_step_size = lbas_to_process - lbas_processed > current_step_size
+                              ? current_step_size
+                              : lbas_to_process - lbas_processed;
+      completions[slot] = Completion_default;
+      SubmitTarget target = __submit_target(qpair, lba);
+      int src = __cmd_read(&target,
+                           (char *)buffer + lbas_processed * info.lba_size,
+                           current_step_size, /* number of LBAs */
+                           __read_complete, &completions[slot]);
+      // The queue is full, retry after reaping.
+      if (src == -ENOMEM && outstanding > 0) {
+        break;
+      }
+      if (spdk_unlikely(src != 0)) {
+        rc = SZD_SC_SPDK_ERROR_READ;
+        break;
+      }
+#ifdef SZD_PERF_COUNTERS
+      if (nr_reads != NULL) {
+        *nr_reads += 1;
+      }
+#else
+      (void)nr_reads;
+#endif
+      in_flight[slot] = true;
+      seq[slot] = issued++;
+      outstanding++;
+      lbas_processed += current_step_size;
+      lba += current_step_size;
+      // To the next zone we go
+      if (lba >= current_zone_end) {
+        slba += info.zone_size;
+        lba = slba;
+        current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+      }
+    }
+    // No slot can be issued, wait for the oldest read by the wait policy.
+    uint32_t oldest = queue_depth;
+    for (uint32_t slot = 0; slot < queue_depth; slot++) {
+      if (in_flight[slot] &&
+          (oldest == queue_depth || seq[slot] < seq[oldest])) {
+        oldest = slot;
+      }
+    }
+    if (oldest < queue_depth) {
+      POLL_QPAIR(qpair, completions[oldest].done, SZD_WAIT_OP_READ);
+    }
+    // Reap what is done
+    for (uint32_t slot = 0; slot < queue_depth; slot++) {
+      if (!in_flight[slot] || !completions[slot].done) {
+        continue;
+      }
+      in_flight[slot] = false;
+      outstanding--;
+      if (spdk_unlikely(completions[slot].err != 0)) {
+        rc = SZD_SC_SPDK_ERROR_READ;
+      }
+    }
+  }
+  return rc;
+}
+
+int szd_read_pipelined(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                       uint32_t queue_depth) {
+  return szd_read_pipelined_with_diag(qpair, lba, buffer, size, NULL,
+                                      queue_depth);
 }
 
-#define POLL_QPAIR(qpair, target)                                              \
-  do {                                                                         \
-    spdk_nvme_qpair_process_completions((qpair), 0);                           \
-  } while (!(target))
-
-int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
-                       uint64_t *nr_reads) {
+int szd_readv_with_diag(QPair *qpair, uint64_t lba, const struct iovec *iov,
+                        int iovcnt, uint64_t *nr_reads) {
   RETURN_ERR_ON_NULL(qpair);
-  RETURN_ERR_ON_NULL(buffer);
-  int rc = SZD_SC_SUCCESS;
+  RETURN_ERR_ON_NULL(iov);
   DeviceInfo info = qpair->man->info;
+  uint64_t size = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    size += iov[i].iov_len;
+  }
+  if (spdk_unlikely(size == 0 || size % info.lba_size != 0)) {
+    return SZD_SC_SPDK_ERROR_READ;
+  }
 
   // zone pointers
   uint64_t slba = (lba / info.zone_size) * info.zone_size;
-  uint64_t current_zone_end = slba + info.zone_cap;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
   // Oops, let me fix this for you
   if (spdk_unlikely(lba >= current_zone_end)) {
     slba += info.zone_size;
     lba = slba + lba - current_zone_end;
-    current_zone_end = slba + info.zone_cap;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
   }
   // Progress variables
-  uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
+  uint64_t lbas_to_process = size / info.lba_size;
   uint64_t lbas_processed = 0;
   // Used to determine next IO call
-  uint64_t step_size =
-      (info.mdts / info.lba_size); // If lba_size > mdts, we have a big problem,
-                                   // but not because of the read.
+  uint64_t step_size = (info.mdts / info.lba_size);
   uint64_t current_step_size = step_size;
-  Completion completion = Completion_default;
+  VectoredCompletion ctx = {.completion = Completion_default,
+                            .iov = iov,
+                            .iovcnt = iovcnt,
+                            .base = 0,
+                            .iov_pos = 0,
+                            .iov_offset = 0};
 
   // Otherwise we have an out of range.
-  uint64_t number_of_zones_traversed =
-      (lbas_to_process + (lba - slba)) / info.zone_cap;
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (lba - slba));
   if (spdk_unlikely(lba < info.min_lba ||
                     slba + number_of_zones_traversed * info.zone_size >
                         info.max_lba)) {
@@ -552,13 +2331,11 @@ int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
                             ? current_step_size
                             : lbas_to_process - lbas_processed;
 
-    completion.done = false;
-    completion.err = 0x00;
-    rc = spdk_nvme_ns_cmd_read(qpair->man->ns, qpair->qpair,
-                               (char *)buffer + lbas_processed * info.lba_size,
-                               lba,               /* LBA start */
-                               current_step_size, /* number of LBAs */
-                               __read_complete, &completion, 0);
+    ctx.completion = Completion_default;
+    ctx.base = lbas_processed * info.lba_size;
+    SubmitTarget target = __submit_target(qpair, lba);
+    int rc = __cmd_readv(&target, current_step_size, /* number of LBAs */
+                         __read_complete, &ctx);
 #ifdef SZD_PERF_COUNTERS
     if (nr_reads != NULL) {
       *nr_reads += 1;
@@ -570,8 +2347,8 @@ int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
       return SZD_SC_SPDK_ERROR_READ;
     }
     // Synchronous reads, busy wait.
-    POLL_QPAIR(qpair->qpair, completion.done);
-    if (spdk_unlikely(completion.err != 0)) {
+    POLL_QPAIR(qpair, ctx.completion.done, SZD_WAIT_OP_READ);
+    if (spdk_unlikely(ctx.completion.err != 0)) {
       return SZD_SC_SPDK_ERROR_READ;
     }
     lbas_processed += current_step_size;
@@ -580,18 +2357,85 @@ int szd_read_with_diag(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
     if (lba >= current_zone_end) {
       slba += info.zone_size;
       lba = slba;
-      current_zone_end = slba + info.zone_cap;
+      current_zone_end = slba + __zone_cap_of(qpair->man, slba);
     }
   }
   return SZD_SC_SUCCESS;
 }
 
-int szd_read(QPair *qpair, uint64_t lba, void *buffer, uint64_t size) {
-  return szd_read_with_diag(qpair, lba, buffer, size, NULL);
+int szd_readv(QPair *qpair, uint64_t lba, const struct iovec *iov, int iovcnt) {
+  return szd_readv_with_diag(qpair, lba, iov, iovcnt, NULL);
 }
 
-int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
-                         uint64_t size, uint64_t *nr_appends) {
+// Checks if an async read fits in one command and one zone.
+static int __read_async_check(QPair *qpair, uint64_t *lba, uint64_t size,
+                              uint64_t *lbas) {
+  DeviceInfo info = qpair->man->info;
+
+  // Zone pointers
+  uint64_t slba = (*lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(*lba >= current_zone_end)) {
+    slba += info.zone_size;
+    *lba = slba + *lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  // Progress variables
+  *lbas = (size + info.lba_size - 1) / info.lba_size;
+
+  // Error if we have an out of range, we cross a zone border or the request
+  // does not fit in one command.
+  if (spdk_unlikely(*lba < info.min_lba || slba >= info.max_lba ||
+                    *lba + *lbas > current_zone_end ||
+                    *lbas > info.mdts / info.lba_size)) {
+    SPDK_ERRLOG("SZD: Async read out of range\n");
+    return SZD_SC_SPDK_ERROR_READ;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_read_async_with_diag(QPair *qpair, uint64_t lba, void *buffer,
+                             uint64_t size, uint64_t *nr_reads,
+                             Completion *completion) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  RETURN_ERR_ON_NULL(completion);
+  int rc = SZD_SC_SUCCESS;
+  uint64_t lbas_to_process;
+  *completion = Completion_default;
+  if (spdk_unlikely((rc = __read_async_check(qpair, &lba, size,
+                                             &lbas_to_process)) !=
+                    SZD_SC_SUCCESS)) {
+    return rc;
+  }
+
+  completion->done = false;
+  completion->err = 0x00;
+  SubmitTarget target = __submit_target(qpair, lba);
+  rc = __cmd_read(&target, buffer, lbas_to_process, /* number of LBAs */
+                  __read_complete, completion);
+#ifdef SZD_PERF_COUNTERS
+  if (nr_reads != NULL) {
+    *nr_reads += 1;
+  }
+#else
+  (void)nr_reads;
+#endif
+  if (spdk_unlikely(rc != 0)) {
+    SPDK_ERRLOG("SZD: Error creating read request\n");
+    return SZD_SC_SPDK_ERROR_READ;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_read_async(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                   Completion *completion) {
+  return szd_read_async_with_diag(qpair, lba, buffer, size, NULL, completion);
+}
+
+static int __szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
+                                  uint64_t size, uint64_t *nr_appends) {
   RETURN_ERR_ON_NULL(qpair);
   RETURN_ERR_ON_NULL(buffer);
   int rc = SZD_SC_SUCCESS;
@@ -599,12 +2443,12 @@ int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
 
   // Zone pointers
   uint64_t slba = (*lba / info.zone_size) * info.zone_size;
-  uint64_t current_zone_end = slba + info.zone_cap;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
   // Oops, let me fix this for you
   if (spdk_unlikely(*lba >= current_zone_end)) {
     slba += info.zone_size;
     *lba = slba + *lba - current_zone_end;
-    current_zone_end = slba + info.zone_cap;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
   }
   // Progress variables
   uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
@@ -617,8 +2461,8 @@ int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
   Completion completion = Completion_default;
 
   // Error if we have an out of range.
-  uint64_t number_of_zones_traversed =
-      (lbas_to_process + (*lba - slba)) / info.zone_cap;
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (*lba - slba));
   if (spdk_unlikely(*lba < info.min_lba ||
                     slba + number_of_zones_traversed * info.zone_size >
                         info.max_lba)) {
@@ -641,12 +2485,13 @@ int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
 
     completion.done = false;
     completion.err = 0x00;
+    __zone_table_track(&completion, qpair->man, slba, current_step_size);
 
-    rc = spdk_nvme_zns_zone_append(
-        qpair->man->ns, qpair->qpair,
-        (char *)buffer + lbas_processed * info.lba_size, slba, /* LBA start */
-        current_step_size, /* number of LBAs */
-        __append_complete, &completion, 0);
+    SubmitTarget target = __submit_target(qpair, slba);
+    rc = __cmd_append(&target,
+                      (char *)buffer + lbas_processed * info.lba_size,
+                      current_step_size, /* number of LBAs */
+                      __append_complete, &completion);
 #ifdef SZD_PERF_COUNTERS
     if (nr_appends != NULL) {
       *nr_appends += 1;
@@ -659,9 +2504,11 @@ int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
       return SZD_SC_SPDK_ERROR_APPEND;
     }
     // Synchronous write, busy wait.
-    POLL_QPAIR(qpair->qpair, completion.done);
+    POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_APPEND);
     if (spdk_unlikely(completion.err != 0)) {
       SPDK_ERRLOG("SZD: Error during append %x\n", completion.err);
+      // One report to resync, then all heads are memory reads.
+      szd_refresh_zone_table(qpair);
       for (uint64_t slba = info.min_lba; slba != info.max_lba;
            slba += info.zone_size) {
         uint64_t zone_head;
@@ -673,59 +2520,558 @@ int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
       }
       return SZD_SC_SPDK_ERROR_APPEND;
     }
-    *lba = *lba + current_step_size;
-    lbas_processed += current_step_size;
+    *lba = *lba + current_step_size;
+    lbas_processed += current_step_size;
+    // To the next zone we go
+    if (*lba >= current_zone_end) {
+      slba += info.zone_size;
+      *lba = slba;
+      current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+    }
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_append_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
+                         uint64_t size, uint64_t *nr_appends) {
+  // lba is moved by the append, the probes carry where it started.
+#ifdef SZD_USDT
+  uint64_t slba = lba == NULL ? 0 : *lba;
+#endif
+  SZD_DTRACE_PROBE3(szd_append_start, qpair, slba, __probe_lbas(qpair, size));
+  int rc = __szd_append_with_diag(qpair, lba, buffer, size, nr_appends);
+  SZD_DTRACE_PROBE4(szd_append_done, qpair, slba, __probe_lbas(qpair, size),
+                    rc);
+  return rc;
+}
+
+int szd_append(QPair *qpair, uint64_t *lba, void *buffer, uint64_t size) {
+  return szd_append_with_diag(qpair, lba, buffer, size, NULL);
+}
+
+int szd_append_pipelined_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
+                                   uint64_t size, uint64_t *nr_appends,
+                                   uint32_t queue_depth) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  if (queue_depth <= 1) {
+    return szd_append_with_diag(qpair, lba, buffer, size, nr_appends);
+  }
+  queue_depth =
+      queue_depth > MAX_PIPELINE_DEPTH ? MAX_PIPELINE_DEPTH : queue_depth;
+  int rc = SZD_SC_SUCCESS;
+  DeviceInfo info = qpair->man->info;
+
+  // Zone pointers
+  uint64_t new_lba = *lba;
+  uint64_t slba = (new_lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(new_lba >= current_zone_end)) {
+    slba += info.zone_size;
+    new_lba = slba + new_lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  // Progress variables
+  uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
+  uint64_t lbas_processed = 0;
+  // Used to determine next IO call
+  uint64_t step_size = (info.zasl / info.lba_size);
+  uint64_t current_step_size = step_size;
+  PipelinedCompletion completions[MAX_PIPELINE_DEPTH];
+  for (uint32_t i = 0; i < queue_depth; i++) {
+    completions[i].in_flight = false;
+  }
+  uint32_t outstanding = 0;
+  // The first append (in issue order) that failed, all before it are on the
+  // device where we expect them.
+  uint64_t issued = 0;
+  uint64_t failed_seq = UINT64_MAX;
+  uint64_t failed_lba = new_lba;
+
+  // Error if we have an out of range.
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (new_lba - slba));
+  if (spdk_unlikely(new_lba < info.min_lba ||
+                    slba + number_of_zones_traversed * info.zone_size >
+                        info.max_lba)) {
+    SPDK_ERRLOG("SZD: Pipelined append is out of allowed range\n");
+    return SZD_SC_SPDK_ERROR_APPEND;
+  }
+
+  // Keep appending in steps of max ZASL bytes till all are issued and done.
+  // On an error we stop issuing, but still wait for the outstanding appends.
+  while ((rc == SZD_SC_SUCCESS && lbas_processed < lbas_to_process) ||
+         outstanding > 0) {
+    for (uint32_t slot = 0;
+         slot < queue_depth && rc == SZD_SC_SUCCESS &&
+         lbas_processed < lbas_to_process;
+         slot++) {
+      if (completions[slot].in_flight) {
+        continue;
+      }
+      // Append across a zone border.
+      if ((new_lba + step_size) >= current_zone_end) {
+        current_step_size = current_zone_end - new_lba;
+      } else {
+        current_step_size = step_size;
+      }
+      // Do not append too much (more than ZASL or what is requested)
+      current_step_size = lbas_to_process - lbas_processed > current_step_size
+                              ? current_step_size
+                              : lbas_to_process - lbas_processed;
+      completions[slot].completion = Completion_default;
+      __zone_table_track(&completions[slot].completion, qpair->man, slba,
+                         current_step_size);
+      completions[slot].elba = new_lba;
+      SubmitTarget target = __submit_target(qpair, slba);
+      int src = __cmd_append(&target,
+                             (char *)buffer + lbas_processed * info.lba_size,
+                             current_step_size, /* number of LBAs */
+                             __append_pipelined_complete, &completions[slot]);
+      // The queue is full, retry after reaping.
+      if (src == -ENOMEM && outstanding > 0) {
+        break;
+      }
+      if (spdk_unlikely(src != 0)) {
+        SPDK_ERRLOG("SZD: Error creating pipelined append request\n");
+        rc = SZD_SC_SPDK_ERROR_APPEND;
+        if (issued < failed_seq) {
+          failed_seq = issued;
+          failed_lba = new_lba;
+        }
+        break;
+      }
+#ifdef SZD_PERF_COUNTERS
+      if (nr_appends != NULL) {
+        *nr_appends += 1;
+      }
+#else
+      (void)nr_appends;
+#endif
+      completions[slot].in_flight = true;
+      completions[slot].seq = issued++;
+      outstanding++;
+      new_lba += current_step_size;
+      lbas_processed += current_step_size;
+      // To the next zone we go
+      if (new_lba >= current_zone_end) {
+        slba += info.zone_size;
+        new_lba = slba;
+        current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+      }
+    }
+    // No slot can be issued, wait for the oldest append by the wait policy.
+    uint32_t oldest = queue_depth;
+    for (uint32_t slot = 0; slot < queue_depth; slot++) {
+      if (completions[slot].in_flight &&
+          (oldest == queue_depth ||
+           completions[slot].seq < completions[oldest].seq)) {
+        oldest = slot;
+      }
+    }
+    if (oldest < queue_depth) {
+      POLL_QPAIR(qpair, completions[oldest].completion.done,
+                 SZD_WAIT_OP_APPEND);
+    }
+    // Reap what is done
+    for (uint32_t slot = 0; slot < queue_depth; slot++) {
+      if (!completions[slot].in_flight || !completions[slot].completion.done) {
+        continue;
+      }
+      completions[slot].in_flight = false;
+      outstanding--;
+      if (spdk_unlikely(completions[slot].completion.err != 0)) {
+        SPDK_ERRLOG("SZD: Error during pipelined append %x\n",
+                    completions[slot].completion.err);
+        rc = SZD_SC_SPDK_ERROR_APPEND;
+      } else if (spdk_unlikely(completions[slot].alba !=
+                               completions[slot].elba)) {
+        SPDK_ERRLOG("SZD: Pipelined append reordered, expected %lu got %lu\n",
+                    completions[slot].elba, completions[slot].alba);
+        rc = SZD_SC_SPDK_ERROR_APPEND;
+      } else {
+        continue;
+      }
+      if (completions[slot].seq < failed_seq) {
+        failed_seq = completions[slot].seq;
+        failed_lba = completions[slot].elba;
+      }
+    }
+  }
+  // On an error the head ends after the appends that did land, in order.
+  *lba = rc == SZD_SC_SUCCESS ? new_lba : failed_lba;
+  return rc;
+}
+
+int szd_append_pipelined(QPair *qpair, uint64_t *lba, void *buffer,
+                         uint64_t size, uint32_t queue_depth) {
+  return szd_append_pipelined_with_diag(qpair, lba, buffer, size, NULL,
+                                        queue_depth);
+}
+
+int szd_appendv_with_diag(QPair *qpair, uint64_t *lba, const struct iovec *iov,
+                          int iovcnt, uint64_t *nr_appends) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(iov);
+  DeviceInfo info = qpair->man->info;
+  uint64_t size = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    size += iov[i].iov_len;
+  }
+  if (spdk_unlikely(size == 0 || size % info.lba_size != 0)) {
+    SPDK_ERRLOG("SZD: Vectored append is not lba alligned\n");
+    return SZD_SC_SPDK_ERROR_APPEND;
+  }
+
+  // Zone pointers
+  uint64_t slba = (*lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(*lba >= current_zone_end)) {
+    slba += info.zone_size;
+    *lba = slba + *lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  // Progress variables
+  uint64_t lbas_to_process = size / info.lba_size;
+  uint64_t lbas_processed = 0;
+  // Used to determine next IO call
+  uint64_t step_size = (info.zasl / info.lba_size);
+  uint64_t current_step_size = step_size;
+  VectoredCompletion ctx = {.completion = Completion_default,
+                            .iov = iov,
+                            .iovcnt = iovcnt,
+                            .base = 0,
+                            .iov_pos = 0,
+                            .iov_offset = 0};
+
+  // Error if we have an out of range.
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (*lba - slba));
+  if (spdk_unlikely(*lba < info.min_lba ||
+                    slba + number_of_zones_traversed * info.zone_size >
+                        info.max_lba)) {
+    SPDK_ERRLOG("SZD: Vectored append is out of allowed range\n");
+    return SZD_SC_SPDK_ERROR_APPEND;
+  }
+
+  // Append in steps of max ZASL bytes and respect boundaries
+  while (lbas_processed < lbas_to_process) {
+    // Append across a zone border.
+    if ((*lba + step_size) >= current_zone_end) {
+      current_step_size = current_zone_end - *lba;
+    } else {
+      current_step_size = step_size;
+    }
+    // Do not append too much (more than ZASL or what is requested)
+    current_step_size = lbas_to_process - lbas_processed > current_step_size
+                            ? current_step_size
+                            : lbas_to_process - lbas_processed;
+
+    ctx.completion = Completion_default;
+    __zone_table_track(&ctx.completion, qpair->man, slba, current_step_size);
+    ctx.base = lbas_processed * info.lba_size;
+    SubmitTarget target = __submit_target(qpair, slba);
+    int rc = __cmd_appendv(&target, current_step_size, /* number of LBAs */
+                           __append_complete, &ctx);
+#ifdef SZD_PERF_COUNTERS
+    if (nr_appends != NULL) {
+      *nr_appends += 1;
+    }
+#else
+    (void)nr_appends;
+#endif
+    if (spdk_unlikely(rc != 0)) {
+      SPDK_ERRLOG("SZD: Error creating vectored append request\n");
+      return SZD_SC_SPDK_ERROR_APPEND;
+    }
+    // Synchronous write, busy wait.
+    POLL_QPAIR(qpair, ctx.completion.done, SZD_WAIT_OP_APPEND);
+    if (spdk_unlikely(ctx.completion.err != 0)) {
+      SPDK_ERRLOG("SZD: Error during vectored append %x\n",
+                  ctx.completion.err);
+      return SZD_SC_SPDK_ERROR_APPEND;
+    }
+    *lba = *lba + current_step_size;
+    lbas_processed += current_step_size;
+    // To the next zone we go
+    if (*lba >= current_zone_end) {
+      slba += info.zone_size;
+      *lba = slba;
+      current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+    }
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_appendv(QPair *qpair, uint64_t *lba, const struct iovec *iov,
+                int iovcnt) {
+  return szd_appendv_with_diag(qpair, lba, iov, iovcnt, NULL);
+}
+
+// lba that is n lbas after lba, skipping the end of zones (past their cap).
+static inline uint64_t __lba_skip(DeviceManager *man, uint64_t lba,
+                                  uint64_t n) {
+  uint64_t zone_size = man->info.zone_size;
+  uint64_t slba = (lba / zone_size) * zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(man, slba);
+  if (spdk_unlikely(lba >= current_zone_end)) {
+    slba += zone_size;
+    lba = slba + lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(man, slba);
+  }
+  while (lba + n >= current_zone_end) {
+    n -= current_zone_end - lba;
+    slba += zone_size;
+    lba = slba;
+    current_zone_end = slba + __zone_cap_of(man, slba);
+  }
+  return lba + n;
+}
+
+bool szd_copy_supported(DeviceManager *manager) {
+  if (spdk_unlikely(manager == NULL || !__is_open(manager) ||
+                    __is_group(manager))) {
+    return false;
+  }
+  // bdevs copy through host memory, their copy is not a zone append.
+  if (manager->backend != SZD_BACKEND_NVME) {
+    return manager->backend == SZD_BACKEND_EMU;
+  }
+  return (spdk_nvme_ctrlr_get_flags(manager->ctrlr) &
+          SPDK_NVME_CTRLR_COPY_SUPPORTED) != 0;
+}
+
+// Copy through host memory, for devices without NVMe Copy.
+static int __copy_fallback(QPair *qpair, const CopyRange *ranges, uint32_t n,
+                           uint64_t *lba, uint64_t *nr_copies) {
+  DeviceInfo info = qpair->man->info;
+  uint64_t buffer_lbas = (info.zasl / info.lba_size) * DEFAULT_PIPELINE_DEPTH;
+  void *buffer = szd_calloc(info.lba_size, buffer_lbas, info.lba_size);
+  if (spdk_unlikely(buffer == NULL)) {
+    return SZD_SC_SPDK_ERROR_ZCALLOC;
+  }
+  int rc = SZD_SC_SUCCESS;
+  for (uint32_t range = 0; range < n && rc == SZD_SC_SUCCESS; range++) {
+    uint64_t src = ranges[range].slba;
+    uint64_t left = ranges[range].nlb;
+    while (left > 0) {
+      uint64_t step = left > buffer_lbas ? buffer_lbas : left;
+      rc = szd_read_pipelined(qpair, src, buffer, step * info.lba_size,
+                              DEFAULT_PIPELINE_DEPTH);
+      if (spdk_unlikely(rc != SZD_SC_SUCCESS)) {
+        break;
+      }
+      rc = szd_append_pipelined_with_diag(qpair, lba, buffer,
+                                          step * info.lba_size, nr_copies,
+                                          DEFAULT_PIPELINE_DEPTH);
+      if (spdk_unlikely(rc != SZD_SC_SUCCESS)) {
+        break;
+      }
+      src = __lba_skip(qpair->man, src, step);
+      left -= step;
+    }
+  }
+  szd_free(buffer);
+  return rc;
+}
+
+int szd_copy_with_diag(QPair *qpair, const CopyRange *ranges, uint32_t n,
+                       uint64_t *lba, uint64_t *nr_copies) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(ranges);
+  RETURN_ERR_ON_NULL(lba);
+  DeviceInfo info = qpair->man->info;
+
+  // Error if any range is out of range.
+  uint64_t lbas_to_process = 0;
+  for (uint32_t range = 0; range < n; range++) {
+    uint64_t src_slba = (ranges[range].slba / info.zone_size) * info.zone_size;
+    uint64_t zones_traversed =
+        __zones_traversed(qpair->man, src_slba,
+                          ranges[range].nlb + (ranges[range].slba - src_slba));
+    if (spdk_unlikely(ranges[range].slba < info.min_lba ||
+                      src_slba + zones_traversed * info.zone_size >
+                          info.max_lba)) {
+      SPDK_ERRLOG("SZD: Copy source is out of allowed range\n");
+      return SZD_SC_SPDK_ERROR_READ;
+    }
+    lbas_to_process += ranges[range].nlb;
+  }
+  // Zone pointers
+  uint64_t slba = (*lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  // Oops, let me fix this for you
+  if (spdk_unlikely(*lba >= current_zone_end)) {
+    slba += info.zone_size;
+    *lba = slba + *lba - current_zone_end;
+    current_zone_end = slba + __zone_cap_of(qpair->man, slba);
+  }
+  uint64_t number_of_zones_traversed = __zones_traversed(
+      qpair->man, slba, lbas_to_process + (*lba - slba));
+  if (spdk_unlikely(*lba < info.min_lba ||
+                    slba + number_of_zones_traversed * info.zone_size >
+                        info.max_lba)) {
+    SPDK_ERRLOG("SZD: Copy is out of allowed range\n");
+    return SZD_SC_SPDK_ERROR_APPEND;
+  }
+  if (!szd_copy_supported(qpair->man)) {
+    return __copy_fallback(qpair, ranges, n, lba, nr_copies);
+  }
+
+  // Limits of one copy, a range holds at most 1 << 16 lbas (0's based).
+  // Emulated devices have no other limits.
+  uint64_t mssrl = 1 << 16;
+  uint64_t mcl = UINT64_MAX;
+  uint32_t msrc = 0x100;
+  if (spdk_likely(qpair->backend_qpair_ == NULL)) {
+    const struct spdk_nvme_ns_data *ns_data =
+        spdk_nvme_ns_get_data(qpair->man->ns);
+    mssrl = ns_data->mssrl == 0 ? mssrl : ns_data->mssrl;
+    mcl = ns_data->mcl == 0 ? mcl : ns_data->mcl;
+    msrc = (uint32_t)ns_data->msrc + 1;
+  }
+  struct spdk_nvme_scc_source_range *copy_ranges =
+      (struct spdk_nvme_scc_source_range *)calloc(msrc, sizeof(*copy_ranges));
+  if (spdk_unlikely(copy_ranges == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+
+  int rc = SZD_SC_SUCCESS;
+  Completion completion = Completion_default;
+  uint32_t range = 0;
+  uint64_t src = n > 0 ? ranges[0].slba : 0;
+  uint64_t left = n > 0 ? ranges[0].nlb : 0;
+  // Each copy fills at most the rest of the zone written to.
+  while (range < n) {
+    uint64_t room = current_zone_end - *lba;
+    room = room > mcl ? mcl : room;
+    uint64_t copy_lbas = 0;
+    uint16_t count = 0;
+    while (range < n && count < msrc && copy_lbas < room) {
+      if (left == 0) {
+        if (++range < n) {
+          src = ranges[range].slba;
+          left = ranges[range].nlb;
+        }
+        continue;
+      }
+      // Sources can not cross zones either.
+      src = __lba_skip(qpair->man, src, 0);
+      uint64_t src_slba = (src / info.zone_size) * info.zone_size;
+      uint64_t step = src_slba + __zone_cap_of(qpair->man, src_slba) - src;
+      step = step > left ? left : step;
+      step = step > mssrl ? mssrl : step;
+      step = step > room - copy_lbas ? room - copy_lbas : step;
+      copy_ranges[count].slba = src;
+      copy_ranges[count].nlb = (uint16_t)(step - 1);
+      count++;
+      copy_lbas += step;
+      src += step;
+      left -= step;
+    }
+    if (count == 0) {
+      break;
+    }
+
+    completion.done = false;
+    completion.err = 0x00;
+    __zone_table_track(&completion, qpair->man, *lba, copy_lbas);
+    SubmitTarget target = __submit_target(qpair, *lba);
+    rc = __cmd_copy(&target, copy_ranges, count, __copy_complete, &completion);
+#ifdef SZD_PERF_COUNTERS
+    if (nr_copies != NULL) {
+      *nr_copies += 1;
+    }
+#endif
+    if (spdk_unlikely(rc != 0)) {
+      SPDK_ERRLOG("SZD: Error creating copy request\n");
+      rc = SZD_SC_SPDK_ERROR_APPEND;
+      break;
+    }
+    // Synchronous write, busy wait.
+    POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_APPEND);
+    if (spdk_unlikely(completion.err != 0)) {
+      SPDK_ERRLOG("SZD: Error during copy %x\n", completion.err);
+      rc = SZD_SC_SPDK_ERROR_APPEND;
+      break;
+    }
+    *lba = *lba + copy_lbas;
     // To the next zone we go
     if (*lba >= current_zone_end) {
       slba += info.zone_size;
       *lba = slba;
-      current_zone_end = slba + info.zone_cap;
+      current_zone_end = slba + __zone_cap_of(qpair->man, slba);
     }
   }
-  return SZD_SC_SUCCESS;
+  free(copy_ranges);
+  return rc;
 }
 
-int szd_append(QPair *qpair, uint64_t *lba, void *buffer, uint64_t size) {
-  return szd_append_with_diag(qpair, lba, buffer, size, NULL);
+int szd_copy(QPair *qpair, const CopyRange *ranges, uint32_t n, uint64_t *lba) {
+  return szd_copy_with_diag(qpair, ranges, n, lba, NULL);
 }
 
-int szd_append_async_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
-                               uint64_t size, uint64_t *nr_appends,
-                               Completion *completion) {
-  RETURN_ERR_ON_NULL(qpair);
-  RETURN_ERR_ON_NULL(buffer);
-  int rc = SZD_SC_SUCCESS;
+// Checks if an async append fits in one command and one zone.
+static int __append_async_check(QPair *qpair, uint64_t *lba, uint64_t size,
+                                uint64_t *slba, uint64_t *lbas) {
   DeviceInfo info = qpair->man->info;
 
   // Zone pointers
-  uint64_t slba = (*lba / info.zone_size) * info.zone_size;
-  uint64_t current_zone_end = slba + info.zone_cap;
+  *slba = (*lba / info.zone_size) * info.zone_size;
+  uint64_t current_zone_end = *slba + __zone_cap_of(qpair->man, *slba);
   // Oops, let me fix this for you
   if (spdk_unlikely(*lba > current_zone_end)) {
-    slba += info.zone_size;
-    *lba = slba + *lba - current_zone_end;
-    current_zone_end = slba + info.zone_cap;
+    *slba += info.zone_size;
+    *lba = *slba + *lba - current_zone_end;
   }
   // Progress variables
-  uint64_t lbas_to_process = (size + info.lba_size - 1) / info.lba_size;
-  *completion = Completion_default;
+  *lbas = (size + info.lba_size - 1) / info.lba_size;
 
   // Error if we have an out of range or we cross a zone border.
   uint64_t number_of_zones_traversed =
-      (lbas_to_process + (*lba - slba)) / info.zone_cap;
+      __zones_traversed(qpair->man, *slba, *lbas + (*lba - *slba));
   if (spdk_unlikely(*lba < info.min_lba || *lba > info.max_lba ||
                     number_of_zones_traversed > 1 ||
-                    lbas_to_process > info.zasl / info.lba_size)) {
+                    *lbas > info.zasl / info.lba_size)) {
     SPDK_ERRLOG("SZD: Async append out of range\n");
     return SZD_SC_SPDK_ERROR_APPEND;
   }
+  return SZD_SC_SUCCESS;
+}
+
+// Async appends are traced on completion, by their completion.
+static void __append_async_complete(void *arg,
+                                    const struct spdk_nvme_cpl *completion) {
+  __append_complete(arg, completion);
+  Completion *completed = (Completion *)arg;
+  SZD_DTRACE_PROBE4(szd_append_async_done, completed, completed->slba_,
+                    completed->nr_, completed->err);
+  (void)completed;
+}
+
+static int __szd_append_async_with_diag(QPair *qpair, uint64_t *lba,
+                                        void *buffer, uint64_t size,
+                                        uint64_t *nr_appends,
+                                        Completion *completion) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  int rc = SZD_SC_SUCCESS;
+  uint64_t slba, lbas_to_process;
+  *completion = Completion_default;
+  if (spdk_unlikely((rc = __append_async_check(qpair, lba, size, &slba,
+                                               &lbas_to_process)) !=
+                    SZD_SC_SUCCESS)) {
+    return rc;
+  }
 
   completion->done = false;
   completion->err = 0x00;
-  rc = spdk_nvme_zns_zone_append(qpair->man->ns, qpair->qpair, (char *)buffer,
-                                 slba,            /* LBA start */
-                                 lbas_to_process, /* number of LBAs */
-                                 __append_complete, completion, 0);
+  __zone_table_track(completion, qpair->man, slba, lbas_to_process);
+  SubmitTarget target = __submit_target(qpair, slba);
+  rc = __cmd_append(&target, buffer, lbas_to_process, /* number of LBAs */
+                    __append_async_complete, completion);
 #ifdef SZD_PERF_COUNTERS
   if (nr_appends != NULL) {
     *nr_appends += 1;
@@ -741,13 +3087,109 @@ int szd_append_async_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
   return SZD_SC_SUCCESS;
 }
 
+int szd_append_async_with_diag(QPair *qpair, uint64_t *lba, void *buffer,
+                               uint64_t size, uint64_t *nr_appends,
+                               Completion *completion) {
+  SZD_DTRACE_PROBE4(szd_append_async_start, qpair, lba == NULL ? 0 : *lba,
+                    __probe_lbas(qpair, size), completion);
+  int rc = __szd_append_async_with_diag(qpair, lba, buffer, size, nr_appends,
+                                        completion);
+  // Appends that are never submitted also complete, with the SZD status.
+  if (spdk_unlikely(rc != SZD_SC_SUCCESS)) {
+    SZD_DTRACE_PROBE4(szd_append_async_done, completion, 0, 0, rc);
+  }
+  return rc;
+}
+
 int szd_append_async(QPair *qpair, uint64_t *lba, void *buffer, uint64_t size,
                      Completion *completion) {
   return szd_append_async_with_diag(qpair, lba, buffer, size, NULL, completion);
 }
 
+int szd_read_async_cb(QPair *qpair, uint64_t lba, void *buffer, uint64_t size,
+                      szd_completion_cb cb, void *cb_arg) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(buffer);
+  RETURN_ERR_ON_NULL(cb);
+  int rc = SZD_SC_SUCCESS;
+  uint64_t lbas_to_process;
+  if (spdk_unlikely((rc = __read_async_check(qpair, &lba, size,
+                                             &lbas_to_process)) !=
+                    SZD_SC_SUCCESS)) {
+    return rc;
+  }
+  CallbackRequest *request = __callback_request_get(qpair);
+  if (spdk_unlikely(request == NULL)) {
+    return SZD_SC_SPDK_ERROR_QPAIR;
+  }
+  request->completion = Completion_default;
+  request->complete_fn = __read_complete;
+  request->cb = cb;
+  request->cb_arg = cb_arg;
+  request->lba = lba;
+  SubmitTarget target = __submit_target(qpair, lba);
+  rc = __cmd_read(&target, buffer, lbas_to_process, /* number of LBAs */
+                  __callback_complete, request);
+  if (spdk_unlikely(rc != 0)) {
+    __callback_request_put(request);
+    return rc == -ENOMEM ? SZD_SC_SPDK_ERROR_QPAIR : SZD_SC_SPDK_ERROR_READ;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_append_async_cb(QPair *qpair, uint64_t *lba, void *buffer,
+                        uint64_t size, szd_completion_cb cb, void *cb_arg) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(lba);
+  RETURN_ERR_ON_NULL(buffer);
+  RETURN_ERR_ON_NULL(cb);
+  // Traced as szd_append_async, with cb_arg in place of the completion.
+  SZD_DTRACE_PROBE4(szd_append_async_start, qpair, *lba,
+                    __probe_lbas(qpair, size), cb_arg);
+  int rc = SZD_SC_SUCCESS;
+  uint64_t slba, lbas_to_process;
+  if (spdk_unlikely((rc = __append_async_check(qpair, lba, size, &slba,
+                                               &lbas_to_process)) !=
+                    SZD_SC_SUCCESS)) {
+    SZD_DTRACE_PROBE4(szd_append_async_done, cb_arg, 0, 0, rc);
+    return rc;
+  }
+  CallbackRequest *request = __callback_request_get(qpair);
+  if (spdk_unlikely(request == NULL)) {
+    SZD_DTRACE_PROBE4(szd_append_async_done, cb_arg, 0, 0,
+                      SZD_SC_SPDK_ERROR_QPAIR);
+    return SZD_SC_SPDK_ERROR_QPAIR;
+  }
+  request->completion = Completion_default;
+  __zone_table_track(&request->completion, qpair->man, slba, lbas_to_process);
+  request->complete_fn = __append_complete;
+  request->cb = cb;
+  request->cb_arg = cb_arg;
+  request->lba = *lba;
+  SubmitTarget target = __submit_target(qpair, slba);
+  rc = __cmd_append(&target, buffer, lbas_to_process, /* number of LBAs */
+                    __callback_complete, request);
+  if (spdk_unlikely(rc != 0)) {
+    __callback_request_put(request);
+    rc = rc == -ENOMEM ? SZD_SC_SPDK_ERROR_QPAIR : SZD_SC_SPDK_ERROR_APPEND;
+    SZD_DTRACE_PROBE4(szd_append_async_done, cb_arg, 0, 0, rc);
+    return rc;
+  }
+  *lba = *lba + lbas_to_process;
+  return SZD_SC_SUCCESS;
+}
+
+int32_t szd_process_completions(QPair *qpair, uint32_t max_completions) {
+  if (spdk_unlikely(qpair == NULL ||
+                    (qpair->qpair == NULL && qpair->backend_qpair_ == NULL &&
+                     qpair->group_backend_qpairs_ == NULL))) {
+    return -EINVAL;
+  }
+  return __qpair_process_completions(qpair, max_completions);
+}
+
 int szd_poll_async(QPair *qpair, Completion *completion) {
-  POLL_QPAIR(qpair->qpair, completion->done);
+  POLL_QPAIR(qpair, completion->done, SZD_WAIT_OP_ASYNC);
   if (spdk_unlikely(completion->err != 0)) {
     SPDK_ERRLOG("SZD: Error during polling - code:%x\n", completion->err);
     return SZD_SC_SPDK_ERROR_POLLING;
@@ -757,7 +3199,7 @@ int szd_poll_async(QPair *qpair, Completion *completion) {
 
 int szd_poll_once(QPair *qpair, Completion *completion) {
   if (!completion->done) {
-    spdk_nvme_qpair_process_completions(qpair->qpair, 0);
+    __qpair_process_completions(qpair, 0);
   }
   if (spdk_unlikely(completion->err != 0)) {
     SPDK_ERRLOG("SZD: Error during polling once - code:%x\n", completion->err);
@@ -767,10 +3209,10 @@ int szd_poll_once(QPair *qpair, Completion *completion) {
 }
 
 void szd_poll_once_raw(QPair *qpair) {
-  spdk_nvme_qpair_process_completions(qpair->qpair, 0);
+  __qpair_process_completions(qpair, 0);
 }
 
-int szd_reset(QPair *qpair, uint64_t slba) {
+static int __szd_reset(QPair *qpair, uint64_t slba) {
   RETURN_ERR_ON_NULL(qpair);
   // Otherwise we have an out of range.
   DeviceInfo info = qpair->man->info;
@@ -778,16 +3220,15 @@ int szd_reset(QPair *qpair, uint64_t slba) {
     return SZD_SC_SPDK_ERROR_READ;
   }
   Completion completion = Completion_default;
-  int rc =
-      spdk_nvme_zns_reset_zone(qpair->man->ns, qpair->qpair,
-                               slba,  /* starting LBA of the zone to reset */
-                               false, /* don't reset all zones */
-                               __reset_zone_complete, &completion);
+  __zone_table_track(&completion, qpair->man, slba, 1);
+  SubmitTarget target = __submit_target(qpair, slba);
+  int rc = __cmd_reset(&target, false, /* don't reset all zones */
+                       __reset_zone_complete, &completion);
   if (spdk_unlikely(rc != 0)) {
     return SZD_SC_SPDK_ERROR_RESET;
   }
   // Busy wait
-  POLL_QPAIR(qpair->qpair, completion.done);
+  POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_RESET);
   if (spdk_unlikely(completion.err != 0)) {
     SPDK_ERRLOG("SZD: Reset error - code:%x \n", completion.err);
     return SZD_SC_SPDK_ERROR_RESET;
@@ -795,34 +3236,85 @@ int szd_reset(QPair *qpair, uint64_t slba) {
   return rc;
 }
 
+int szd_reset(QPair *qpair, uint64_t slba) {
+  SZD_DTRACE_PROBE3(szd_reset_start, qpair, slba, __probe_zone_size(qpair));
+  int rc = __szd_reset(qpair, slba);
+  SZD_DTRACE_PROBE4(szd_reset_done, qpair, slba, __probe_zone_size(qpair), rc);
+  return rc;
+}
+
+// Each member of a device group resets all of its zones, in parallel.
+static int __group_reset_all(QPair *qpair) {
+  DeviceInfo info = qpair->man->info;
+  DeviceManagerInternal *private_ =
+      (DeviceManagerInternal *)qpair->man->private_;
+  Completion completions[MAX_GROUP_DEVICES];
+  uint32_t submitted = 0;
+  int rc = SZD_SC_SUCCESS;
+  for (; submitted < private_->group_size_; submitted++) {
+    completions[submitted] = Completion_default;
+    // Zone submitted of the group is the first zone of member submitted.
+    SubmitTarget target =
+        __submit_target(qpair, (uint64_t)submitted * info.zone_size);
+    if (spdk_unlikely(__cmd_reset(&target, true, /* reset all zones */
+                                  __reset_zone_complete,
+                                  &completions[submitted]) != 0)) {
+      rc = SZD_SC_SPDK_ERROR_RESET;
+      break;
+    }
+  }
+  for (uint32_t member = 0; member < submitted; member++) {
+    POLL_QPAIR(qpair, completions[member].done, SZD_WAIT_OP_RESET);
+    if (spdk_unlikely(completions[member].err != 0)) {
+      rc = SZD_SC_SPDK_ERROR_RESET;
+    }
+  }
+  if (spdk_likely(rc == SZD_SC_SUCCESS)) {
+    __zone_table_reset(qpair->man, 0, info.lba_cap / info.zone_size);
+  }
+  return rc;
+}
+
 int szd_reset_all(QPair *qpair) {
   RETURN_ERR_ON_NULL(qpair);
   // Otherwise we have an out of range.
   DeviceInfo info = qpair->man->info;
   int rc = SZD_SC_SUCCESS;
-  // We can not do full reset, if we only "own" a  part.
-  if (info.min_lba > 0 || info.max_lba < info.lba_cap) {
+  // We can not do full reset, if we only "own" a  part. bdevs can not reset
+  // all zones at once either.
+  if (info.min_lba > 0 || info.max_lba < info.lba_cap ||
+      qpair->man->backend == SZD_BACKEND_BDEV) {
     // What are you doing?
     if (spdk_unlikely(info.min_lba > info.max_lba)) {
       return SZD_SC_SPDK_ERROR_RESET;
     }
-    for (uint64_t slba = info.min_lba; slba < info.max_lba;
-         slba += info.zone_size) {
-      if ((rc = szd_reset(qpair, slba)) != 0) {
-        return rc;
-      }
+    uint64_t zones = (info.max_lba - info.min_lba) / info.zone_size;
+    if (zones == 0) {
+      return rc;
+    }
+    uint64_t *slbas = (uint64_t *)calloc(zones, sizeof(uint64_t));
+    if (spdk_unlikely(slbas == NULL)) {
+      return SZD_SC_SPDK_ERROR_RESET;
+    }
+    for (uint64_t zone = 0; zone < zones; zone++) {
+      slbas[zone] = info.min_lba + zone * info.zone_size;
     }
+    rc = szd_reset_many(qpair, slbas, zones, NULL);
+    free(slbas);
+  } else if (spdk_unlikely(qpair->group_size_ > 0)) {
+    rc = __group_reset_all(qpair);
   } else {
     Completion completion = Completion_default;
-    rc = spdk_nvme_zns_reset_zone(qpair->man->ns, qpair->qpair,
-                                  0,    /* starting LBA of the zone to reset */
-                                  true, /* reset all zones */
-                                  __reset_zone_complete, &completion);
+    __zone_table_track(&completion, qpair->man, 0,
+                       info.lba_cap / info.zone_size);
+    SubmitTarget target = __submit_target(qpair, 0);
+    rc = __cmd_reset(&target, true, /* reset all zones */
+                     __reset_zone_complete, &completion);
     if (spdk_unlikely(rc != 0)) {
       return SZD_SC_SPDK_ERROR_RESET;
     }
     // Busy wait
-    POLL_QPAIR(qpair->qpair, completion.done);
+    POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_RESET);
     if (spdk_unlikely(completion.err != 0)) {
       return SZD_SC_SPDK_ERROR_RESET;
     }
@@ -830,7 +3322,167 @@ int szd_reset_all(QPair *qpair) {
   return rc;
 }
 
-int szd_finish_zone(QPair *qpair, uint64_t slba) {
+// Submits a reset/finish that tracks the zone state table in completion, but
+// completes with cb_fn.
+static int __zone_management_submit_cb(QPair *qpair, uint64_t slba,
+                                       bool finish, Completion *completion,
+                                       spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  // Otherwise we have an out of range.
+  DeviceInfo info = qpair->man->info;
+  if (spdk_unlikely(slba < info.min_lba || slba >= info.lba_cap)) {
+    return -EINVAL;
+  }
+  *completion = Completion_default;
+  __zone_table_track(completion, qpair->man, slba, 1);
+  SubmitTarget target = __submit_target(qpair, slba);
+  if (finish) {
+    return __cmd_finish(&target, false, /* don't finish all zones */
+                        cb_fn, cb_arg);
+  }
+  return __cmd_reset(&target, false, /* don't reset all zones */
+                     cb_fn, cb_arg);
+}
+
+int __zone_management_submit(QPair *qpair, uint64_t slba, bool finish,
+                             Completion *completion) {
+  return __zone_management_submit_cb(
+      qpair, slba, finish, completion,
+      finish ? __finish_zone_complete : __reset_zone_complete, completion);
+}
+
+// Shared by the reset and finish callback variants.
+static int __zone_management_cb(QPair *qpair, uint64_t slba, bool finish,
+                                szd_completion_cb cb, void *cb_arg) {
+  CallbackRequest *request = __callback_request_get(qpair);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  request->complete_fn =
+      finish ? __finish_zone_complete : __reset_zone_complete;
+  request->cb = cb;
+  request->cb_arg = cb_arg;
+  request->lba = slba;
+  int rc = __zone_management_submit_cb(qpair, slba, finish,
+                                       &request->completion,
+                                       __callback_complete, request);
+  if (spdk_unlikely(rc != 0)) {
+    __callback_request_put(request);
+  }
+  return rc;
+}
+
+int szd_reset_async_cb(QPair *qpair, uint64_t slba, szd_completion_cb cb,
+                       void *cb_arg) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(cb);
+  int rc = __zone_management_cb(qpair, slba, false, cb, cb_arg);
+  return spdk_likely(rc == 0)
+             ? SZD_SC_SUCCESS
+             : (rc == -ENOMEM ? SZD_SC_SPDK_ERROR_QPAIR
+                              : SZD_SC_SPDK_ERROR_RESET);
+}
+
+int szd_finish_zone_async_cb(QPair *qpair, uint64_t slba, szd_completion_cb cb,
+                             void *cb_arg) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(cb);
+  int rc = __zone_management_cb(qpair, slba, true, cb, cb_arg);
+  return spdk_likely(rc == 0)
+             ? SZD_SC_SUCCESS
+             : (rc == -ENOMEM ? SZD_SC_SPDK_ERROR_QPAIR
+                              : SZD_SC_SPDK_ERROR_FINISH);
+}
+
+int __zone_management_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                           int *status, bool finish) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(slbas);
+  const int error_code =
+      finish ? SZD_SC_SPDK_ERROR_FINISH : SZD_SC_SPDK_ERROR_RESET;
+  int rc = SZD_SC_SUCCESS;
+  Completion completions[MAX_PIPELINE_DEPTH];
+  uint64_t zone_of_slot[MAX_PIPELINE_DEPTH];
+  bool in_flight[MAX_PIPELINE_DEPTH] = {false};
+  uint32_t outstanding = 0;
+  uint64_t issued = 0;
+
+  while (issued < n || outstanding > 0) {
+    for (uint32_t slot = 0; slot < MAX_PIPELINE_DEPTH && issued < n; slot++) {
+      if (in_flight[slot]) {
+        continue;
+      }
+      int src = __zone_management_submit(qpair, slbas[issued], finish,
+                                         &completions[slot]);
+      // The queue is full, retry after reaping.
+      if (src == -ENOMEM && outstanding > 0) {
+        break;
+      }
+      if (spdk_unlikely(src != 0)) {
+        SPDK_ERRLOG("SZD: Could not issue zone management for %lu\n",
+                    slbas[issued]);
+        if (status != NULL) {
+          status[issued] = error_code;
+        }
+        rc = error_code;
+        issued++;
+        continue;
+      }
+      zone_of_slot[slot] = issued;
+      in_flight[slot] = true;
+      outstanding++;
+      issued++;
+    }
+    // Reap what is done, zone management is slow so yield when allowed.
+    if (__qpair_process_completions(qpair, 0) == 0 &&
+        qpair->wait_policy_ != SZD_WAIT_SPIN) {
+      qpair->wait_stats_.yields++;
+      qpair->wait_stats_.saved_ns += __wait_idle(0, spdk_get_ticks_hz());
+    }
+    for (uint32_t slot = 0; slot < MAX_PIPELINE_DEPTH; slot++) {
+      if (!in_flight[slot] || !completions[slot].done) {
+        continue;
+      }
+      in_flight[slot] = false;
+      outstanding--;
+      int zone_rc = SZD_SC_SUCCESS;
+      if (spdk_unlikely(completions[slot].err != 0)) {
+        SPDK_ERRLOG("SZD: Zone management error for %lu - code:%x\n",
+                    slbas[zone_of_slot[slot]], completions[slot].err);
+        zone_rc = rc = error_code;
+      }
+      if (status != NULL) {
+        status[zone_of_slot[slot]] = zone_rc;
+      }
+    }
+  }
+  return rc;
+}
+
+int szd_reset_async(QPair *qpair, uint64_t slba, Completion *completion) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(completion);
+  int rc = __zone_management_submit(qpair, slba, false, completion);
+  return spdk_likely(rc == 0) ? SZD_SC_SUCCESS : SZD_SC_SPDK_ERROR_RESET;
+}
+
+int szd_reset_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                   int *status) {
+  return __zone_management_many(qpair, slbas, n, status, false);
+}
+
+int szd_finish_zone_async(QPair *qpair, uint64_t slba, Completion *completion) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(completion);
+  int rc = __zone_management_submit(qpair, slba, true, completion);
+  return spdk_likely(rc == 0) ? SZD_SC_SUCCESS : SZD_SC_SPDK_ERROR_FINISH;
+}
+
+int szd_finish_many(QPair *qpair, const uint64_t *slbas, uint64_t n,
+                    int *status) {
+  return __zone_management_many(qpair, slbas, n, status, true);
+}
+
+static int __szd_finish_zone(QPair *qpair, uint64_t slba) {
   RETURN_ERR_ON_NULL(qpair);
   // Otherwise we have an out of range.
   DeviceInfo info = qpair->man->info;
@@ -838,74 +3490,79 @@ int szd_finish_zone(QPair *qpair, uint64_t slba) {
     return SZD_SC_SPDK_ERROR_FINISH;
   }
   Completion completion = Completion_default;
-  int rc =
-      spdk_nvme_zns_finish_zone(qpair->man->ns, qpair->qpair,
-                                slba,  /* starting LBA of the zone to finish */
-                                false, /* don't finish all zones */
-                                __finish_zone_complete, &completion);
+  __zone_table_track(&completion, qpair->man, slba, 1);
+  SubmitTarget target = __submit_target(qpair, slba);
+  int rc = __cmd_finish(&target, false, /* don't finish all zones */
+                        __finish_zone_complete, &completion);
   if (spdk_unlikely(rc != 0)) {
     return SZD_SC_SPDK_ERROR_FINISH;
   }
   // Busy wait
-  POLL_QPAIR(qpair->qpair, completion.done);
+  POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_FINISH);
   if (spdk_unlikely(completion.err != 0)) {
     return SZD_SC_SPDK_ERROR_FINISH;
   }
   return rc;
 }
 
-int szd_get_zone_heads(QPair *qpair, uint64_t slba, uint64_t eslba,
-                       uint64_t *write_head) {
+int szd_finish_zone(QPair *qpair, uint64_t slba) {
+  SZD_DTRACE_PROBE3(szd_finish_start, qpair, slba, __probe_zone_size(qpair));
+  int rc = __szd_finish_zone(qpair, slba);
+  SZD_DTRACE_PROBE4(szd_finish_done, qpair, slba, __probe_zone_size(qpair),
+                    rc);
+  return rc;
+}
+
+// Reports nr_zones zones from target on, in lbas of the target.
+static int __szd_report_zones_on(QPair *qpair, SubmitTarget target,
+                                 uint64_t nr_zones,
+                                 struct spdk_nvme_zns_zone_desc *descs) {
   // Inspired by SPDK/nvme/identify.c
-  RETURN_ERR_ON_NULL(qpair);
-  RETURN_ERR_ON_NULL(qpair->man);
-  // Otherwise we have an out of range.
   DeviceInfo info = qpair->man->info;
-  if (spdk_unlikely(slba < info.min_lba || slba >= info.max_lba ||
-                    eslba < info.min_lba || eslba >= info.max_lba ||
-                    slba > eslba || slba % info.zone_size != 0 ||
-                    eslba % info.zone_size != 0)) {
-    return SZD_SC_SPDK_ERROR_REPORT_ZONES;
-  }
-
   int rc = SZD_SC_SUCCESS;
+  uint64_t slba = target.lba;
 
-  // Setup state variables
-  size_t report_bufsize = spdk_nvme_ns_get_max_io_xfer_size(qpair->man->ns);
+  // Setup state variables, only NVMe zones have a descriptor extension.
+  size_t report_bufsize = target.ns == NULL
+                              ? (size_t)info.mdts
+                              : spdk_nvme_ns_get_max_io_xfer_size(target.ns);
   uint8_t *report_buf = (uint8_t *)calloc(1, report_bufsize);
+  if (spdk_unlikely(report_buf == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
   uint64_t reported_zones = 0;
-  uint64_t zones_to_report = (eslba - slba) / info.zone_size;
   struct spdk_nvme_zns_zone_report *zns_report;
 
   // Setup logical variables
-  const struct spdk_nvme_ns_data *nsdata =
-      spdk_nvme_ns_get_data(qpair->man->ns);
-  const struct spdk_nvme_zns_ns_data *nsdata_zns =
-      spdk_nvme_zns_ns_get_data(qpair->man->ns);
   uint64_t zone_report_size = sizeof(struct spdk_nvme_zns_zone_report);
   uint64_t zone_descriptor_size = sizeof(struct spdk_nvme_zns_zone_desc);
-  uint64_t zns_descriptor_size =
-      nsdata_zns->lbafe[nsdata->flbas.format].zdes * 64;
+  uint64_t zns_descriptor_size = 0;
+  if (spdk_likely(target.ns != NULL)) {
+    const struct spdk_nvme_ns_data *nsdata = spdk_nvme_ns_get_data(target.ns);
+    const struct spdk_nvme_zns_ns_data *nsdata_zns =
+        spdk_nvme_zns_ns_get_data(target.ns);
+    zns_descriptor_size = nsdata_zns->lbafe[nsdata->flbas.format].zdes * 64;
+  }
   uint64_t max_zones_per_buf =
       zns_descriptor_size
           ? (report_bufsize - zone_report_size) /
                 (zone_descriptor_size + zns_descriptor_size)
           : (report_bufsize - zone_report_size) / zone_descriptor_size;
 
-  // Get zone heads iteratively
-  do {
+  // Get zone descriptors iteratively
+  while (reported_zones < nr_zones) {
     memset(report_buf, 0, report_bufsize);
     // Get as much as we can from SPDK
     Completion completion = Completion_default;
-    rc = spdk_nvme_zns_report_zones(
-        qpair->man->ns, qpair->qpair, report_buf, report_bufsize, slba,
-        SPDK_NVME_ZRA_LIST_ALL, true, __get_zone_head_complete, &completion);
+    target.lba = slba;
+    rc = __cmd_report_zones(&target, report_buf, report_bufsize,
+                            __get_zone_head_complete, &completion);
     if (spdk_unlikely(rc != 0)) {
       free(report_buf);
       return SZD_SC_SPDK_ERROR_REPORT_ZONES;
     }
-    // Busy wait for the head.
-    POLL_QPAIR(qpair->qpair, completion.done);
+    // Busy wait for the report.
+    POLL_QPAIR(qpair, completion.done, SZD_WAIT_OP_REPORT);
     if (spdk_unlikely(completion.err != 0)) {
       free(report_buf);
       return SZD_SC_SPDK_ERROR_REPORT_ZONES;
@@ -913,75 +3570,240 @@ int szd_get_zone_heads(QPair *qpair, uint64_t slba, uint64_t eslba,
 
     // retrieve nr_zones
     zns_report = (struct spdk_nvme_zns_zone_report *)report_buf;
-    uint64_t nr_zones = zns_report->nr_zones;
-    if (nr_zones > max_zones_per_buf || nr_zones == 0) {
+    uint64_t reported = zns_report->nr_zones;
+    if (reported > max_zones_per_buf || reported == 0) {
       free(report_buf);
       return SZD_SC_SPDK_ERROR_REPORT_ZONES;
     }
 
-    // Retrieve write heads from zone information.
-    for (uint64_t i = 0; i < nr_zones && reported_zones <= zones_to_report;
-         i++) {
-      struct spdk_nvme_zns_zone_desc *desc = &zns_report->descs[i];
-      write_head[reported_zones] = desc->wp;
-      if (spdk_unlikely(write_head[reported_zones] < slba)) {
-        free(report_buf);
-        return SZD_SC_SPDK_ERROR_REPORT_ZONES;
-      }
-      if (write_head[reported_zones] > slba + desc->zcap) {
-        write_head[reported_zones] = slba + info.zone_size;
-      }
+    // Copy zone information.
+    for (uint64_t i = 0; i < reported && reported_zones < nr_zones; i++) {
+      descs[reported_zones] = zns_report->descs[i];
       // progress
       slba += info.zone_size;
       reported_zones++;
     }
-  } while (reported_zones < zones_to_report);
+  }
   free(report_buf);
   return SZD_SC_SUCCESS;
 }
 
-int szd_get_zone_head(QPair *qpair, uint64_t slba, uint64_t *write_head) {
-  return szd_get_zone_heads(qpair, slba, slba, write_head);
+int __szd_report_zones(QPair *qpair, uint64_t slba, uint64_t nr_zones,
+                       struct spdk_nvme_zns_zone_desc *descs) {
+  if (spdk_likely(qpair->group_size_ == 0)) {
+    return __szd_report_zones_on(qpair, __submit_target(qpair, slba),
+                                 nr_zones, descs);
+  }
+  // Report the zones of each member at once and interleave them.
+  DeviceInfo info = qpair->man->info;
+  DeviceManagerInternal *private_ =
+      (DeviceManagerInternal *)qpair->man->private_;
+  uint32_t members = private_->group_size_;
+  uint64_t first_zone = slba / info.zone_size;
+  uint64_t end_zone = first_zone + nr_zones;
+  int rc = SZD_SC_SUCCESS;
+  for (uint32_t member = 0; member < members && rc == SZD_SC_SUCCESS;
+       member++) {
+    // First zone of the member in the range.
+    uint64_t zone =
+        first_zone + (member + members - first_zone % members) % members;
+    if (zone >= end_zone) {
+      continue;
+    }
+    uint64_t zones = (end_zone - zone + members - 1) / members;
+    struct spdk_nvme_zns_zone_desc *member_descs =
+        (struct spdk_nvme_zns_zone_desc *)calloc(
+            zones, sizeof(struct spdk_nvme_zns_zone_desc));
+    if (spdk_unlikely(member_descs == NULL)) {
+      return SZD_SC_NOT_ALLOCATED;
+    }
+    rc = __szd_report_zones_on(
+        qpair, __submit_target(qpair, zone * info.zone_size), zones,
+        member_descs);
+    for (uint64_t i = 0; i < zones && rc == SZD_SC_SUCCESS; i++) {
+      struct spdk_nvme_zns_zone_desc *desc =
+          &descs[zone + i * members - first_zone];
+      *desc = member_descs[i];
+      // Back to the lbas of the group.
+      desc->zslba = (zone + i * members) * info.zone_size;
+      desc->wp = desc->zslba + (member_descs[i].wp - member_descs[i].zslba);
+    }
+    free(member_descs);
+  }
+  return rc;
 }
 
-int szd_get_zone_cap(QPair *qpair, uint64_t slba, uint64_t *zone_cap) {
+int szd_refresh_zone_table(QPair *qpair) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(qpair->man);
+  DeviceManagerInternal *private_ =
+      (DeviceManagerInternal *)qpair->man->private_;
+  RETURN_ERR_ON_NULL(private_);
+  RETURN_ERR_ON_NULL(private_->zone_wp_);
+  DeviceInfo info = qpair->man->info;
+  uint64_t zones = private_->zone_max_ - private_->zone_min_;
+  if (zones == 0) {
+    return SZD_SC_SUCCESS;
+  }
+  struct spdk_nvme_zns_zone_desc *descs =
+      (struct spdk_nvme_zns_zone_desc *)calloc(
+          zones, sizeof(struct spdk_nvme_zns_zone_desc));
+  if (spdk_unlikely(descs == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  int rc = __szd_report_zones(qpair, private_->zone_min_ * info.zone_size,
+                              zones, descs);
+  if (spdk_likely(rc == SZD_SC_SUCCESS)) {
+    for (uint64_t zone = 0; zone < zones; zone++) {
+      __zone_table_sync(qpair->man, &descs[zone]);
+    }
+    __zone_table_build_prefix(qpair->man);
+  }
+  free(descs);
+  return rc;
+}
+
+int szd_get_zone_descriptors(QPair *qpair, uint64_t slba, uint64_t eslba,
+                             ZoneDescriptor *descs) {
   RETURN_ERR_ON_NULL(qpair);
   RETURN_ERR_ON_NULL(qpair->man);
+  RETURN_ERR_ON_NULL(descs);
   // Otherwise we have an out of range.
   DeviceInfo info = qpair->man->info;
-  if (spdk_unlikely(slba < info.min_lba || slba > info.max_lba)) {
-    return SZD_SC_SPDK_ERROR_READ;
+  if (spdk_unlikely(slba < info.min_lba || slba >= info.max_lba ||
+                    eslba < info.min_lba || eslba >= info.max_lba ||
+                    slba > eslba || slba % info.zone_size != 0 ||
+                    eslba % info.zone_size != 0)) {
+    return SZD_SC_SPDK_ERROR_REPORT_ZONES;
+  }
+  uint64_t zones = (eslba - slba) / info.zone_size + 1;
+  struct spdk_nvme_zns_zone_desc *raw_descs =
+      (struct spdk_nvme_zns_zone_desc *)calloc(
+          zones, sizeof(struct spdk_nvme_zns_zone_desc));
+  if (spdk_unlikely(raw_descs == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
   }
+  int rc = __szd_report_zones(qpair, slba, zones, raw_descs);
+  if (spdk_likely(rc == SZD_SC_SUCCESS)) {
+    bool caps_changed = false;
+    for (uint64_t zone = 0; zone < zones; zone++) {
+      descs[zone].zslba = raw_descs[zone].zslba;
+      descs[zone].zcap = raw_descs[zone].zcap;
+      descs[zone].wp = raw_descs[zone].wp;
+      descs[zone].state = (ZoneState)raw_descs[zone].zs;
+      caps_changed |= __zone_table_sync(qpair->man, &raw_descs[zone]);
+    }
+    if (spdk_unlikely(caps_changed)) {
+      __zone_table_build_prefix(qpair->man);
+    }
+  }
+  free(raw_descs);
+  return rc;
+}
 
-  int rc = SZD_SC_SUCCESS;
-  // Get information from a zone.
-  size_t report_bufsize = spdk_nvme_ns_get_max_io_xfer_size(qpair->man->ns);
-  uint8_t *report_buf = (uint8_t *)calloc(1, report_bufsize);
-  {
-    Completion completion = Completion_default;
-    rc = spdk_nvme_zns_report_zones(
-        qpair->man->ns, qpair->qpair, report_buf, report_bufsize, slba,
-        SPDK_NVME_ZRA_LIST_ALL, true, __get_zone_head_complete, &completion);
-    if (spdk_unlikely(rc != 0)) {
-      free(report_buf);
+static int __szd_get_zone_heads(QPair *qpair, uint64_t slba, uint64_t eslba,
+                                uint64_t *write_head) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(qpair->man);
+  // Otherwise we have an out of range.
+  DeviceInfo info = qpair->man->info;
+  if (spdk_unlikely(slba < info.min_lba || slba >= info.max_lba ||
+                    eslba < info.min_lba || eslba >= info.max_lba ||
+                    slba > eslba || slba % info.zone_size != 0 ||
+                    eslba % info.zone_size != 0)) {
+    return SZD_SC_SPDK_ERROR_REPORT_ZONES;
+  }
+  DeviceManagerInternal *private_ =
+      (DeviceManagerInternal *)qpair->man->private_;
+  RETURN_ERR_ON_NULL(private_);
+  RETURN_ERR_ON_NULL(private_->zone_wp_);
+
+  // Retrieve write heads from the zone state table.
+  uint64_t reported_zones = 0;
+  for (; slba <= eslba; slba += info.zone_size) {
+    int64_t idx = __zone_table_index(qpair->man, slba);
+    if (spdk_unlikely(idx < 0)) {
       return SZD_SC_SPDK_ERROR_REPORT_ZONES;
     }
-    // Busy wait for the head.
-    POLL_QPAIR(qpair->qpair, completion.done);
-    if (spdk_unlikely(completion.err != 0)) {
-      free(report_buf);
+    uint64_t wp = __atomic_load_n(&private_->zone_wp_[idx], __ATOMIC_ACQUIRE);
+    uint64_t cap = __atomic_load_n(&private_->zone_cap_[idx], __ATOMIC_RELAXED);
+    uint8_t state =
+        __atomic_load_n(&private_->zone_state_[idx], __ATOMIC_RELAXED);
+    // A full zone has no valid write pointer.
+    if (state == SZD_ZONE_FULL || wp > slba + cap) {
+      wp = slba + info.zone_size;
+    } else if (spdk_unlikely(wp < slba)) {
       return SZD_SC_SPDK_ERROR_REPORT_ZONES;
     }
+    write_head[reported_zones++] = wp;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+int szd_get_zone_heads(QPair *qpair, uint64_t slba, uint64_t eslba,
+                       uint64_t *write_head) {
+  // The lba count of a zone head probe spans all zones that are asked for.
+  SZD_DTRACE_PROBE3(szd_zone_heads_start, qpair, slba,
+                    eslba - slba + __probe_zone_size(qpair));
+  int rc = __szd_get_zone_heads(qpair, slba, eslba, write_head);
+  SZD_DTRACE_PROBE4(szd_zone_heads_done, qpair, slba,
+                    eslba - slba + __probe_zone_size(qpair), rc);
+  return rc;
+}
+
+int szd_get_zone_head(QPair *qpair, uint64_t slba, uint64_t *write_head) {
+  return szd_get_zone_heads(qpair, slba, slba, write_head);
+}
+
+int szd_get_zone_cap_prefix(DeviceManager *manager, uint64_t slba,
+                            uint64_t eslba, uint64_t *zone_cap_prefix) {
+  RETURN_ERR_ON_NULL(manager);
+  RETURN_ERR_ON_NULL(zone_cap_prefix);
+  // Otherwise we have an out of range.
+  DeviceInfo info = manager->info;
+  if (spdk_unlikely(slba < info.min_lba || slba >= info.max_lba ||
+                    eslba < info.min_lba || eslba >= info.max_lba ||
+                    slba > eslba || slba % info.zone_size != 0 ||
+                    eslba % info.zone_size != 0)) {
+    return SZD_SC_SPDK_ERROR_REPORT_ZONES;
+  }
+  int64_t sidx = __zone_table_index(manager, slba);
+  int64_t eidx = __zone_table_index(manager, eslba);
+  if (spdk_unlikely(sidx < 0 || eidx < 0)) {
+    return SZD_SC_SPDK_ERROR_REPORT_ZONES;
+  }
+  DeviceManagerInternal *private_ = (DeviceManagerInternal *)manager->private_;
+  for (int64_t idx = sidx; idx <= eidx + 1; idx++) {
+    zone_cap_prefix[idx - sidx] = __atomic_load_n(
+        &private_->zone_cap_prefix_[idx], __ATOMIC_ACQUIRE);
   }
-  // Retrieve write head from zone information.
-  uint32_t zd_index = sizeof(struct spdk_nvme_zns_zone_report);
-  struct spdk_nvme_zns_zone_desc *desc =
-      (struct spdk_nvme_zns_zone_desc *)(report_buf + zd_index);
-  *zone_cap = desc->zcap;
-  free(report_buf);
   return SZD_SC_SUCCESS;
 }
 
+int szd_get_zone_cap(QPair *qpair, uint64_t slba, uint64_t *zone_cap) {
+  RETURN_ERR_ON_NULL(qpair);
+  RETURN_ERR_ON_NULL(qpair->man);
+  // Otherwise we have an out of range.
+  DeviceInfo info = qpair->man->info;
+  if (spdk_unlikely(slba < info.min_lba || slba > info.max_lba)) {
+    return SZD_SC_SPDK_ERROR_READ;
+  }
+  // Prefer the zone state table, but it is not there yet during open.
+  int64_t idx = __zone_table_index(qpair->man, slba);
+  if (idx >= 0) {
+    DeviceManagerInternal *private_ =
+        (DeviceManagerInternal *)qpair->man->private_;
+    *zone_cap = __atomic_load_n(&private_->zone_cap_[idx], __ATOMIC_RELAXED);
+    return SZD_SC_SUCCESS;
+  }
+  struct spdk_nvme_zns_zone_desc desc;
+  int rc = __szd_report_zones(qpair, slba, 1, &desc);
+  if (spdk_likely(rc == SZD_SC_SUCCESS)) {
+    *zone_cap = desc.zcap;
+  }
+  return rc;
+}
+
 void szd_print_zns_status(int status) {
   fprintf(stdout, "SZD: status = %s\n", szd_status_code_msg(status));
 }
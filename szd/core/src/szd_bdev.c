@@ -0,0 +1,571 @@
+#include "szd/szd_bdev.h"
+#include "szd/szd_status_code.h"
+
+#include <spdk/bdev.h>
+#include <spdk/bdev_zone.h>
+#include <spdk/init.h>
+#include <spdk/likely.h>
+#include <spdk/log.h>
+#include <spdk/nvme.h>
+#include <spdk/nvme_spec.h>
+#include <spdk/nvme_zns.h>
+#include <spdk/rpc.h>
+#include <spdk/thread.h>
+#include <spdk/util.h>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef __cplusplus
+namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
+extern "C" {
+#endif
+
+// Thread that owns the bdev layer and the descriptors. SZD only polls it when
+// it sets up, opens, closes or tears down.
+static struct spdk_thread *g_bdev_thread = NULL;
+// Copy of the config of szd_bdev_init, freed when the layer is torn down.
+static char *g_bdev_config = NULL;
+
+struct BdevNamespace {
+  struct spdk_bdev_desc *desc;
+  struct spdk_bdev *bdev;
+  uint64_t lba_size;
+  uint64_t zone_size;
+  uint64_t nr_zones;
+};
+
+typedef struct BdevRequest {
+  struct BdevQPair *qpair;
+  spdk_nvme_cmd_cb cb_fn;
+  void *cb_arg;
+  void *payload;                     /**< Report to fill, reports only.*/
+  struct spdk_bdev_zone_info *zones; /**< Zones of a report.*/
+  uint32_t nr_zones;
+  int iovcnt;
+  struct iovec iov[SZD_BDEV_MAX_IOVS]; /**< Segments, vectored I/O only.*/
+  struct BdevRequest *next;            /**< Next free request.*/
+} BdevRequest;
+
+struct BdevQPair {
+  BdevNamespace *ns;
+  struct spdk_thread *thread; /**< Completions are delivered on this one.*/
+  struct spdk_io_channel *ch;
+  BdevRequest *requests;
+  BdevRequest *free_requests;
+  uint32_t size;
+  uint64_t completed; /**< Commands completed since creation.*/
+};
+
+typedef struct {
+  bool done;
+  int rc;
+} BdevSync;
+
+static void __bdev_init_done(int rc, void *arg) {
+  BdevSync *sync = (BdevSync *)arg;
+  sync->rc = rc;
+  sync->done = true;
+}
+
+static void __bdev_fini_done(void *arg) { ((BdevSync *)arg)->done = true; }
+
+static void __bdev_poll_until(struct spdk_thread *thread, const bool *done) {
+  while (!*done) {
+    spdk_thread_poll(thread, 0, 0);
+  }
+}
+
+// Exits thread, the messages it still has are processed first.
+static void __bdev_thread_destroy(struct spdk_thread *thread) {
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(thread);
+  spdk_thread_exit(thread);
+  while (!spdk_thread_is_exited(thread)) {
+    spdk_thread_poll(thread, 0, 0);
+  }
+  spdk_set_thread(prev == thread ? NULL : prev);
+  spdk_thread_destroy(thread);
+}
+
+static void __bdev_teardown(void) {
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(g_bdev_thread);
+  BdevSync sync = {false, 0};
+  spdk_subsystem_fini(__bdev_fini_done, &sync);
+  __bdev_poll_until(g_bdev_thread, &sync.done);
+  spdk_set_thread(prev);
+  __bdev_thread_destroy(g_bdev_thread);
+  spdk_thread_lib_fini();
+  g_bdev_thread = NULL;
+  free(g_bdev_config);
+  g_bdev_config = NULL;
+}
+
+int szd_bdev_init(const char *config) {
+  if (spdk_unlikely(config == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  if (spdk_unlikely(g_bdev_thread != NULL)) {
+    return SZD_SC_SPDK_ERROR_INIT;
+  }
+  if (spdk_thread_lib_init(NULL, 0) != 0) {
+    return SZD_SC_SPDK_ERROR_INIT;
+  }
+  g_bdev_thread = spdk_thread_create("szd_bdev", NULL);
+  if (spdk_unlikely(g_bdev_thread == NULL)) {
+    spdk_thread_lib_fini();
+    return SZD_SC_SPDK_ERROR_INIT;
+  }
+  // The subsystems are set up with messages to the current thread.
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(g_bdev_thread);
+  BdevSync sync = {false, 0};
+  spdk_subsystem_init_from_json_config(config, SPDK_DEFAULT_RPC_ADDR,
+                                       __bdev_init_done, &sync, true);
+  __bdev_poll_until(g_bdev_thread, &sync.done);
+  spdk_set_thread(prev);
+  if (sync.rc != 0) {
+    SPDK_ERRLOG("SZD: Can not set up the bdevs of %s\n", config);
+    __bdev_teardown();
+    return SZD_SC_SPDK_ERROR_INIT;
+  }
+  // The caller's config need not outlive init, reinit sets up with it again.
+  g_bdev_config = strdup(config);
+  if (spdk_unlikely(g_bdev_config == NULL)) {
+    __bdev_teardown();
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  return SZD_SC_SUCCESS;
+}
+
+void szd_bdev_fini(void) {
+  if (g_bdev_thread != NULL) {
+    __bdev_teardown();
+  }
+}
+
+const char *szd_bdev_config(void) { return g_bdev_config; }
+
+static void __bdev_event_cb(enum spdk_bdev_event_type type,
+                            struct spdk_bdev *bdev, void *event_ctx) {
+  if (type == SPDK_BDEV_EVENT_REMOVE) {
+    SPDK_ERRLOG("SZD: bdev %s was removed\n", spdk_bdev_get_name(bdev));
+  }
+  (void)event_ctx;
+}
+
+int szd_bdev_open(BdevNamespace **ns, const char *bdev_name) {
+  if (spdk_unlikely(ns == NULL || bdev_name == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  if (spdk_unlikely(g_bdev_thread == NULL)) {
+    SPDK_ERRLOG("SZD: No bdevs, init SZD with a bdev config\n");
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  BdevNamespace *bdev_ns = (BdevNamespace *)calloc(1, sizeof(BdevNamespace));
+  if (spdk_unlikely(bdev_ns == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  // Descriptors are opened and closed on the thread that owns the layer.
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(g_bdev_thread);
+  int rc = spdk_bdev_open_ext(bdev_name, true, __bdev_event_cb, NULL,
+                              &bdev_ns->desc);
+  if (rc == 0) {
+    bdev_ns->bdev = spdk_bdev_desc_get_bdev(bdev_ns->desc);
+    if (!spdk_bdev_is_zoned(bdev_ns->bdev)) {
+      SPDK_ERRLOG("SZD: bdev %s is not zoned\n", bdev_name);
+      spdk_bdev_close(bdev_ns->desc);
+      rc = -EINVAL;
+    }
+  }
+  spdk_set_thread(prev);
+  if (rc != 0) {
+    free(bdev_ns);
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  bdev_ns->lba_size = spdk_bdev_get_block_size(bdev_ns->bdev);
+  bdev_ns->zone_size = spdk_bdev_get_zone_size(bdev_ns->bdev);
+  bdev_ns->nr_zones = spdk_bdev_get_num_zones(bdev_ns->bdev);
+  *ns = bdev_ns;
+  return SZD_SC_SUCCESS;
+}
+
+void szd_bdev_close(BdevNamespace *ns) {
+  if (ns == NULL) {
+    return;
+  }
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(g_bdev_thread);
+  spdk_bdev_close(ns->desc);
+  spdk_thread_poll(g_bdev_thread, 0, 0);
+  spdk_set_thread(prev);
+  free(ns);
+}
+
+void szd_bdev_get_info(BdevNamespace *ns, DeviceInfo *info) {
+  info->lba_size = ns->lba_size;
+  info->zone_size = ns->zone_size;
+  info->mdts = SZD_BDEV_MAX_XFER_SIZE;
+  // 0 is no limit, other than the size of one command.
+  uint64_t zasl =
+      (uint64_t)spdk_bdev_get_max_zone_append_size(ns->bdev) * ns->lba_size;
+  info->zasl = zasl == 0 ? info->mdts : spdk_min(zasl, info->mdts);
+  info->lba_cap = ns->nr_zones * ns->zone_size;
+}
+
+BdevQPair *szd_bdev_alloc_qpair(BdevNamespace *ns,
+                                uint32_t io_queue_requests) {
+  BdevQPair *qpair = (BdevQPair *)calloc(1, sizeof(BdevQPair));
+  if (spdk_unlikely(qpair == NULL)) {
+    return NULL;
+  }
+  qpair->ns = ns;
+  qpair->size = io_queue_requests != 0 ? io_queue_requests
+                                       : SZD_BDEV_DEFAULT_QUEUE_REQUESTS;
+  qpair->requests = (BdevRequest *)calloc(qpair->size, sizeof(BdevRequest));
+  if (spdk_unlikely(qpair->requests == NULL)) {
+    free(qpair);
+    return NULL;
+  }
+  for (uint32_t i = 0; i < qpair->size; i++) {
+    qpair->requests[i].qpair = qpair;
+    qpair->requests[i].next =
+        i + 1 < qpair->size ? &qpair->requests[i + 1] : NULL;
+  }
+  qpair->free_requests = &qpair->requests[0];
+  // I/O channels are per thread, so each qpair gets its own.
+  qpair->thread = spdk_thread_create("szd_qpair", NULL);
+  if (spdk_unlikely(qpair->thread == NULL)) {
+    free(qpair->requests);
+    free(qpair);
+    return NULL;
+  }
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(qpair->thread);
+  qpair->ch = spdk_bdev_get_io_channel(ns->desc);
+  spdk_set_thread(prev);
+  if (spdk_unlikely(qpair->ch == NULL)) {
+    __bdev_thread_destroy(qpair->thread);
+    free(qpair->requests);
+    free(qpair);
+    return NULL;
+  }
+  return qpair;
+}
+
+void szd_bdev_free_qpair(BdevQPair *qpair) {
+  if (qpair == NULL) {
+    return;
+  }
+  struct spdk_thread *prev = spdk_get_thread();
+  spdk_set_thread(qpair->thread);
+  spdk_put_io_channel(qpair->ch);
+  spdk_set_thread(prev);
+  __bdev_thread_destroy(qpair->thread);
+  free(qpair->requests);
+  free(qpair);
+}
+
+uint32_t szd_bdev_qpair_size(BdevQPair *qpair) { return qpair->size; }
+
+int32_t szd_bdev_process_completions(BdevQPair *qpair,
+                                     uint32_t max_completions) {
+  uint64_t completed = qpair->completed;
+  spdk_thread_poll(qpair->thread, max_completions, 0);
+  return (int32_t)(qpair->completed - completed);
+}
+
+static inline BdevRequest *__bdev_request_get(BdevQPair *qpair,
+                                              spdk_nvme_cmd_cb cb_fn,
+                                              void *cb_arg) {
+  BdevRequest *request = qpair->free_requests;
+  if (spdk_unlikely(request == NULL)) {
+    return NULL;
+  }
+  qpair->free_requests = request->next;
+  request->cb_fn = cb_fn;
+  request->cb_arg = cb_arg;
+  request->payload = NULL;
+  request->zones = NULL;
+  request->nr_zones = 0;
+  request->iovcnt = 0;
+  return request;
+}
+
+static inline void __bdev_request_put(BdevRequest *request) {
+  free(request->zones);
+  request->zones = NULL;
+  request->next = request->qpair->free_requests;
+  request->qpair->free_requests = request;
+}
+
+// Commands are submitted on the thread of the qpair, which owns the channel.
+static inline struct spdk_thread *__bdev_enter(BdevQPair *qpair) {
+  struct spdk_thread *prev = spdk_get_thread();
+  if (spdk_unlikely(prev != qpair->thread)) {
+    spdk_set_thread(qpair->thread);
+  }
+  return prev;
+}
+
+static inline int __bdev_leave(struct spdk_thread *prev, BdevRequest *request,
+                               int rc) {
+  if (spdk_unlikely(prev != request->qpair->thread)) {
+    spdk_set_thread(prev);
+  }
+  if (spdk_unlikely(rc != 0)) {
+    __bdev_request_put(request);
+  }
+  return rc;
+}
+
+// bdevs that are not NVMe report success or failure only.
+static inline void __bdev_cpl(struct spdk_bdev_io *bdev_io, bool success,
+                              struct spdk_nvme_cpl *cpl) {
+  memset(cpl, 0, sizeof(*cpl));
+  uint32_t cdw0;
+  int sct;
+  int sc;
+  spdk_bdev_io_get_nvme_status(bdev_io, &cdw0, &sct, &sc);
+  cpl->status.sct = sct;
+  cpl->status.sc = sc;
+  if (spdk_unlikely(!success && sct == SPDK_NVME_SCT_GENERIC &&
+                    sc == SPDK_NVME_SC_SUCCESS)) {
+    cpl->status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+  }
+}
+
+// Frees the request before calling back, so the callback can submit again.
+static inline void __bdev_finish(BdevRequest *request,
+                                 const struct spdk_nvme_cpl *cpl) {
+  spdk_nvme_cmd_cb cb_fn = request->cb_fn;
+  void *cb_arg = request->cb_arg;
+  request->qpair->completed++;
+  __bdev_request_put(request);
+  if (cb_fn != NULL) {
+    cb_fn(cb_arg, cpl);
+  }
+}
+
+static void __bdev_complete(struct spdk_bdev_io *bdev_io, bool success,
+                            void *arg) {
+  struct spdk_nvme_cpl cpl;
+  __bdev_cpl(bdev_io, success, &cpl);
+  spdk_bdev_free_io(bdev_io);
+  __bdev_finish((BdevRequest *)arg, &cpl);
+}
+
+static void __bdev_append_complete(struct spdk_bdev_io *bdev_io,
+                                   bool success, void *arg) {
+  struct spdk_nvme_cpl cpl;
+  __bdev_cpl(bdev_io, success, &cpl);
+  // Zone append returns the assigned lba in dword 0 and 1.
+  if (spdk_likely(success)) {
+    uint64_t alba = spdk_bdev_io_get_append_location(bdev_io);
+    cpl.cdw0 = (uint32_t)alba;
+    cpl.cdw1 = (uint32_t)(alba >> 32);
+  }
+  spdk_bdev_free_io(bdev_io);
+  __bdev_finish((BdevRequest *)arg, &cpl);
+}
+
+static inline uint8_t __bdev_zone_state(enum spdk_bdev_zone_state state) {
+  switch (state) {
+  case SPDK_BDEV_ZONE_STATE_EMPTY:
+    return SZD_ZONE_EMPTY;
+  case SPDK_BDEV_ZONE_STATE_IMP_OPEN:
+    return SZD_ZONE_IMPLICIT_OPEN;
+  case SPDK_BDEV_ZONE_STATE_EXP_OPEN:
+    return SZD_ZONE_EXPLICIT_OPEN;
+  case SPDK_BDEV_ZONE_STATE_CLOSED:
+    return SZD_ZONE_CLOSED;
+  case SPDK_BDEV_ZONE_STATE_READ_ONLY:
+    return SZD_ZONE_READ_ONLY;
+  case SPDK_BDEV_ZONE_STATE_FULL:
+    return SZD_ZONE_FULL;
+  default:
+    return SZD_ZONE_OFFLINE;
+  }
+}
+
+// bdevs describe zones with their own struct, the report is built as an
+// NVMe zone report without descriptor extensions.
+static void __bdev_report_complete(struct spdk_bdev_io *bdev_io,
+                                   bool success, void *arg) {
+  BdevRequest *request = (BdevRequest *)arg;
+  struct spdk_nvme_cpl cpl;
+  __bdev_cpl(bdev_io, success, &cpl);
+  spdk_bdev_free_io(bdev_io);
+  if (spdk_likely(success)) {
+    struct spdk_nvme_zns_zone_report *report =
+        (struct spdk_nvme_zns_zone_report *)request->payload;
+    memset(report, 0, sizeof(*report));
+    for (uint32_t i = 0; i < request->nr_zones; i++) {
+      struct spdk_nvme_zns_zone_desc *desc = &report->descs[i];
+      memset(desc, 0, sizeof(*desc));
+      desc->zt = SPDK_NVME_ZONE_TYPE_SEQWR;
+      desc->zs = __bdev_zone_state(request->zones[i].state);
+      desc->zcap = request->zones[i].capacity;
+      desc->zslba = request->zones[i].zone_id;
+      desc->wp = request->zones[i].write_pointer;
+    }
+    report->nr_zones = request->nr_zones;
+  }
+  __bdev_finish(request, &cpl);
+}
+
+// Walks the SGL into the segments of request, as the NVMe driver would to
+// build its PRP list.
+static int __bdev_gather(BdevRequest *request, uint64_t size,
+                         spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                         spdk_nvme_req_next_sge_cb next_sge_fn) {
+  reset_sgl_fn(request->cb_arg, 0);
+  request->iovcnt = 0;
+  while (size > 0) {
+    void *address;
+    uint32_t length;
+    if (next_sge_fn(request->cb_arg, &address, &length) != 0) {
+      return -EINVAL;
+    }
+    if (length == 0) {
+      continue;
+    }
+    if (spdk_unlikely(request->iovcnt == SZD_BDEV_MAX_IOVS)) {
+      return -EINVAL;
+    }
+    length = (uint32_t)spdk_min((uint64_t)length, size);
+    request->iov[request->iovcnt].iov_base = address;
+    request->iov[request->iovcnt].iov_len = length;
+    request->iovcnt++;
+    size -= length;
+  }
+  return 0;
+}
+
+int szd_bdev_read(BdevQPair *qpair, void *buffer, uint64_t lba,
+                  uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = spdk_bdev_read_blocks(qpair->ns->desc, qpair->ch, buffer, lba,
+                                 lba_count, __bdev_complete, request);
+  return __bdev_leave(prev, request, rc);
+}
+
+int szd_bdev_readv(BdevQPair *qpair, uint64_t lba, uint32_t lba_count,
+                   spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                   spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                   spdk_nvme_req_next_sge_cb next_sge_fn) {
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = __bdev_gather(request, (uint64_t)lba_count * qpair->ns->lba_size,
+                         reset_sgl_fn, next_sge_fn);
+  if (spdk_likely(rc == 0)) {
+    rc = spdk_bdev_readv_blocks(qpair->ns->desc, qpair->ch, request->iov,
+                                request->iovcnt, lba, lba_count,
+                                __bdev_complete, request);
+  }
+  return __bdev_leave(prev, request, rc);
+}
+
+int szd_bdev_zone_append(BdevQPair *qpair, void *buffer, uint64_t zslba,
+                         uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                         void *cb_arg) {
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = spdk_bdev_zone_append(qpair->ns->desc, qpair->ch, buffer, zslba,
+                                 lba_count, __bdev_append_complete, request);
+  return __bdev_leave(prev, request, rc);
+}
+
+int szd_bdev_zone_appendv(BdevQPair *qpair, uint64_t zslba, uint32_t lba_count,
+                          spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                          spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                          spdk_nvme_req_next_sge_cb next_sge_fn) {
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = __bdev_gather(request, (uint64_t)lba_count * qpair->ns->lba_size,
+                         reset_sgl_fn, next_sge_fn);
+  if (spdk_likely(rc == 0)) {
+    rc = spdk_bdev_zone_appendv(qpair->ns->desc, qpair->ch, request->iov,
+                                request->iovcnt, zslba, lba_count,
+                                __bdev_append_complete, request);
+  }
+  return __bdev_leave(prev, request, rc);
+}
+
+static int __bdev_zone_management(BdevQPair *qpair, uint64_t slba,
+                                  enum spdk_bdev_zone_action action,
+                                  spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = spdk_bdev_zone_management(qpair->ns->desc, qpair->ch, slba, action,
+                                     __bdev_complete, request);
+  return __bdev_leave(prev, request, rc);
+}
+
+int szd_bdev_reset_zone(BdevQPair *qpair, uint64_t slba,
+                        spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  return __bdev_zone_management(qpair, slba, SPDK_BDEV_ZONE_RESET, cb_fn,
+                                cb_arg);
+}
+
+int szd_bdev_finish_zone(BdevQPair *qpair, uint64_t slba,
+                         spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  return __bdev_zone_management(qpair, slba, SPDK_BDEV_ZONE_FINISH, cb_fn,
+                                cb_arg);
+}
+
+int szd_bdev_report_zones(BdevQPair *qpair, void *payload,
+                          uint32_t payload_size, uint64_t slba,
+                          spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  BdevNamespace *ns = qpair->ns;
+  uint64_t zone = slba / ns->zone_size;
+  if (spdk_unlikely(zone >= ns->nr_zones ||
+                    payload_size <
+                        sizeof(struct spdk_nvme_zns_zone_report) +
+                            sizeof(struct spdk_nvme_zns_zone_desc))) {
+    return -EINVAL;
+  }
+  uint64_t max_zones =
+      (payload_size - sizeof(struct spdk_nvme_zns_zone_report)) /
+      sizeof(struct spdk_nvme_zns_zone_desc);
+  BdevRequest *request = __bdev_request_get(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(request == NULL)) {
+    return -ENOMEM;
+  }
+  request->nr_zones = (uint32_t)spdk_min(max_zones, ns->nr_zones - zone);
+  request->payload = payload;
+  request->zones = (struct spdk_bdev_zone_info *)calloc(
+      request->nr_zones, sizeof(struct spdk_bdev_zone_info));
+  if (spdk_unlikely(request->zones == NULL)) {
+    __bdev_request_put(request);
+    return -ENOMEM;
+  }
+  struct spdk_thread *prev = __bdev_enter(qpair);
+  int rc = spdk_bdev_get_zone_info(ns->desc, qpair->ch, zone * ns->zone_size,
+                                   request->nr_zones, request->zones,
+                                   __bdev_report_complete, request);
+  return __bdev_leave(prev, request, rc);
+}
+
+#ifdef __cplusplus
+}
+} // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
+#endif
@@ -0,0 +1,707 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // fallocate
+#endif
+
+#include "szd/szd_emu.h"
+#include "szd/szd_status_code.h"
+
+#include <spdk/likely.h>
+#include <spdk/log.h>
+#include <spdk/nvme.h>
+#include <spdk/nvme_spec.h>
+#include <spdk/nvme_zns.h>
+#include <spdk/util.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
+extern "C" {
+#endif
+
+const EmuOptions EmuOptions_default = {
+    4096, 0x800, 0x600, 0x40, 0x20000, 0x10000, 14, 14, NULL};
+
+#define SZD_EMU_MAGIC 0x535a44454d550001ULL // "SZDEMU" and version 1
+
+// Stored after the data of file backed namespaces, followed by the write
+// pointer and state of every zone.
+typedef struct {
+  uint64_t magic;
+  uint64_t lba_size;
+  uint64_t zone_size;
+  uint64_t zone_cap;
+  uint64_t nr_zones;
+} EmuHeader;
+
+struct EmuNamespace {
+  EmuOptions options;
+  uint64_t data_size; /**< Bytes of data, the header follows.*/
+  uint64_t map_size;  /**< Bytes mapped.*/
+  uint8_t *data;
+  EmuHeader *header;
+  uint64_t *wp;   /**< Write pointer of each zone.*/
+  uint8_t *state; /**< ZoneState of each zone.*/
+  uint32_t open_zones;
+  uint32_t active_zones;
+  int fd; /**< -1 for anonymous memory.*/
+  pthread_mutex_t lock;
+};
+
+typedef struct {
+  spdk_nvme_cmd_cb cb_fn;
+  void *cb_arg;
+  struct spdk_nvme_cpl cpl;
+} EmuCompletion;
+
+struct EmuQPair {
+  EmuNamespace *ns;
+  EmuCompletion *ring; /**< Completed commands, not yet polled.*/
+  uint32_t size;
+  uint32_t head;
+  uint32_t count;
+};
+
+static inline uint64_t __emu_zone_of(const EmuNamespace *ns, uint64_t lba) {
+  return lba / ns->options.zone_size;
+}
+
+static inline uint64_t __emu_zslba(const EmuNamespace *ns, uint64_t zone) {
+  return zone * ns->options.zone_size;
+}
+
+static inline bool __emu_is_open(uint8_t state) {
+  return state == SZD_ZONE_IMPLICIT_OPEN || state == SZD_ZONE_EXPLICIT_OPEN;
+}
+
+static inline bool __emu_is_active(uint8_t state) {
+  return __emu_is_open(state) || state == SZD_ZONE_CLOSED;
+}
+
+static void __emu_count_zones(EmuNamespace *ns) {
+  ns->open_zones = 0;
+  ns->active_zones = 0;
+  for (uint64_t zone = 0; zone < ns->options.nr_zones; zone++) {
+    ns->open_zones += __emu_is_open(ns->state[zone]);
+    ns->active_zones += __emu_is_active(ns->state[zone]);
+  }
+}
+
+static void __emu_format(EmuNamespace *ns) {
+  for (uint64_t zone = 0; zone < ns->options.nr_zones; zone++) {
+    ns->wp[zone] = __emu_zslba(ns, zone);
+    ns->state[zone] = SZD_ZONE_EMPTY;
+  }
+}
+
+static bool __emu_options_valid(const EmuOptions *options) {
+  return options->lba_size >= 512 &&
+         (options->lba_size & (options->lba_size - 1)) == 0 &&
+         options->zone_size > 0 && options->zone_cap > 0 &&
+         options->zone_cap <= options->zone_size && options->nr_zones > 0 &&
+         options->mdts >= options->lba_size &&
+         options->zasl >= options->lba_size && options->zasl <= options->mdts;
+}
+
+int szd_emu_open(EmuNamespace **ns, const EmuOptions *options) {
+  if (spdk_unlikely(ns == NULL || options == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  if (spdk_unlikely(!__emu_options_valid(options))) {
+    SPDK_ERRLOG("SZD: Invalid geometry for an emulated device\n");
+    return SZD_SC_SPDK_ERROR_OPEN;
+  }
+  EmuNamespace *emu = (EmuNamespace *)calloc(1, sizeof(EmuNamespace));
+  if (spdk_unlikely(emu == NULL)) {
+    return SZD_SC_NOT_ALLOCATED;
+  }
+  emu->options = *options;
+  emu->options.path = NULL;
+  uint64_t zones = options->nr_zones;
+  emu->data_size = zones * options->zone_size * options->lba_size;
+  uint64_t meta_size = sizeof(EmuHeader) + zones * sizeof(uint64_t) + zones;
+  emu->map_size = emu->data_size + meta_size;
+  emu->fd = -1;
+  bool formatted = false;
+  if (options->path != NULL) {
+    emu->fd = open(options->path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (emu->fd < 0 || fstat(emu->fd, &st) != 0) {
+      SPDK_ERRLOG("SZD: Can not open %s\n", options->path);
+      goto fail;
+    }
+    // Files of another geometry are formatted again.
+    formatted = (uint64_t)st.st_size == emu->map_size;
+    if (!formatted && ftruncate(emu->fd, 0) != 0) {
+      goto fail;
+    }
+    if (ftruncate(emu->fd, (off_t)emu->map_size) != 0) {
+      goto fail;
+    }
+    emu->data = (uint8_t *)mmap(NULL, emu->map_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, emu->fd, 0);
+  } else {
+    // Untouched pages cost nothing, only what is written is backed.
+    emu->data = (uint8_t *)mmap(NULL, emu->map_size, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                                -1, 0);
+  }
+  if (emu->data == MAP_FAILED) {
+    emu->data = NULL;
+    goto fail;
+  }
+  emu->header = (EmuHeader *)(emu->data + emu->data_size);
+  emu->wp = (uint64_t *)(emu->header + 1);
+  emu->state = (uint8_t *)(emu->wp + zones);
+  formatted = formatted && emu->header->magic == SZD_EMU_MAGIC &&
+              emu->header->lba_size == options->lba_size &&
+              emu->header->zone_size == options->zone_size &&
+              emu->header->zone_cap == options->zone_cap &&
+              emu->header->nr_zones == zones;
+  if (formatted) {
+    // Zones that were open are closed, as after a power cycle.
+    for (uint64_t zone = 0; zone < zones; zone++) {
+      if (__emu_is_open(emu->state[zone])) {
+        emu->state[zone] = SZD_ZONE_CLOSED;
+      }
+    }
+  } else {
+    EmuHeader header = {SZD_EMU_MAGIC, options->lba_size, options->zone_size,
+                        options->zone_cap, zones};
+    *emu->header = header;
+    __emu_format(emu);
+  }
+  __emu_count_zones(emu);
+  if (pthread_mutex_init(&emu->lock, NULL) != 0) {
+    goto fail;
+  }
+  *ns = emu;
+  return SZD_SC_SUCCESS;
+fail:
+  if (emu->data != NULL) {
+    munmap(emu->data, emu->map_size);
+  }
+  if (emu->fd >= 0) {
+    close(emu->fd);
+  }
+  free(emu);
+  return SZD_SC_SPDK_ERROR_OPEN;
+}
+
+void szd_emu_close(EmuNamespace *ns) {
+  if (ns == NULL) {
+    return;
+  }
+  if (ns->fd >= 0) {
+    msync(ns->data, ns->map_size, MS_SYNC);
+    close(ns->fd);
+  }
+  munmap(ns->data, ns->map_size);
+  pthread_mutex_destroy(&ns->lock);
+  free(ns);
+}
+
+void szd_emu_get_info(EmuNamespace *ns, DeviceInfo *info) {
+  info->lba_size = ns->options.lba_size;
+  info->zone_size = ns->options.zone_size;
+  info->zone_cap = ns->options.zone_cap;
+  info->mdts = ns->options.mdts;
+  info->zasl = ns->options.zasl;
+  info->lba_cap = ns->options.nr_zones * ns->options.zone_size;
+}
+
+EmuQPair *szd_emu_alloc_qpair(EmuNamespace *ns, uint32_t io_queue_requests) {
+  EmuQPair *qpair = (EmuQPair *)calloc(1, sizeof(EmuQPair));
+  if (spdk_unlikely(qpair == NULL)) {
+    return NULL;
+  }
+  qpair->ns = ns;
+  qpair->size = io_queue_requests != 0 ? io_queue_requests
+                                       : SZD_EMU_DEFAULT_QUEUE_REQUESTS;
+  qpair->ring = (EmuCompletion *)calloc(qpair->size, sizeof(EmuCompletion));
+  if (spdk_unlikely(qpair->ring == NULL)) {
+    free(qpair);
+    return NULL;
+  }
+  return qpair;
+}
+
+void szd_emu_free_qpair(EmuQPair *qpair) {
+  if (qpair == NULL) {
+    return;
+  }
+  free(qpair->ring);
+  free(qpair);
+}
+
+uint32_t szd_emu_qpair_size(EmuQPair *qpair) { return qpair->size; }
+
+int32_t szd_emu_process_completions(EmuQPair *qpair,
+                                    uint32_t max_completions) {
+  // Commands submitted from within a callback complete on the next poll.
+  uint32_t n = qpair->count;
+  if (max_completions != 0 && max_completions < n) {
+    n = max_completions;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    EmuCompletion done = qpair->ring[qpair->head];
+    qpair->head = (qpair->head + 1) % qpair->size;
+    qpair->count--;
+    if (done.cb_fn != NULL) {
+      done.cb_fn(done.cb_arg, &done.cpl);
+    }
+  }
+  return (int32_t)n;
+}
+
+// Reserves a completion, commands are executed before they are queued.
+static inline EmuCompletion *__emu_complete(EmuQPair *qpair,
+                                            spdk_nvme_cmd_cb cb_fn,
+                                            void *cb_arg) {
+  if (spdk_unlikely(qpair->count >= qpair->size)) {
+    return NULL;
+  }
+  EmuCompletion *done =
+      &qpair->ring[(qpair->head + qpair->count) % qpair->size];
+  qpair->count++;
+  memset(done, 0, sizeof(*done));
+  done->cb_fn = cb_fn;
+  done->cb_arg = cb_arg;
+  return done;
+}
+
+// Zoned namespace errors are command specific, all others are generic.
+static inline void __emu_set_status(EmuCompletion *done, uint16_t sc) {
+  done->cpl.status.sct = sc >= SPDK_NVME_SC_ZONE_BOUNDARY_ERROR
+                             ? SPDK_NVME_SCT_COMMAND_SPECIFIC
+                             : SPDK_NVME_SCT_GENERIC;
+  done->cpl.status.sc = sc;
+}
+
+// Whether lba_count lbas from lba can be transferred in one command.
+static inline uint16_t __emu_check_range(EmuNamespace *ns, uint64_t lba,
+                                         uint32_t lba_count, uint64_t max) {
+  uint64_t lba_cap = ns->options.nr_zones * ns->options.zone_size;
+  if (lba_count == 0 || lba >= lba_cap || lba_count > lba_cap - lba) {
+    return SPDK_NVME_SC_LBA_OUT_OF_RANGE;
+  }
+  if ((uint64_t)lba_count * ns->options.lba_size > max) {
+    return SPDK_NVME_SC_INVALID_FIELD;
+  }
+  return 0;
+}
+
+// Opens a zone for writing, closes an implicitly opened zone when the open
+// limit is reached. Returns a ZNS status code. Called with the lock held.
+static uint16_t __emu_open_zone(EmuNamespace *ns, uint64_t zone) {
+  uint8_t state = ns->state[zone];
+  if (__emu_is_open(state)) {
+    return 0;
+  }
+  if (state == SZD_ZONE_FULL) {
+    return SPDK_NVME_SC_ZONE_IS_FULL;
+  }
+  if (state == SZD_ZONE_READ_ONLY) {
+    return SPDK_NVME_SC_ZONE_IS_READONLY;
+  }
+  if (state == SZD_ZONE_OFFLINE) {
+    return SPDK_NVME_SC_ZONE_IS_OFFLINE;
+  }
+  if (state == SZD_ZONE_EMPTY && ns->options.max_active_zones != 0 &&
+      ns->active_zones >= ns->options.max_active_zones) {
+    return SPDK_NVME_SC_TOO_MANY_ACTIVE_ZONES;
+  }
+  if (ns->options.max_open_zones != 0 &&
+      ns->open_zones >= ns->options.max_open_zones) {
+    uint64_t victim = 0;
+    while (victim < ns->options.nr_zones &&
+           ns->state[victim] != SZD_ZONE_IMPLICIT_OPEN) {
+      victim++;
+    }
+    if (victim == ns->options.nr_zones) {
+      return SPDK_NVME_SC_TOO_MANY_OPEN_ZONES;
+    }
+    ns->state[victim] = SZD_ZONE_CLOSED;
+    ns->open_zones--;
+  }
+  if (state == SZD_ZONE_EMPTY) {
+    ns->active_zones++;
+  }
+  ns->open_zones++;
+  ns->state[zone] = SZD_ZONE_IMPLICIT_OPEN;
+  return 0;
+}
+
+// Moves a zone to full, called with the lock held.
+static void __emu_fill_zone(EmuNamespace *ns, uint64_t zone) {
+  uint8_t state = ns->state[zone];
+  ns->open_zones -= __emu_is_open(state);
+  ns->active_zones -= __emu_is_active(state);
+  ns->state[zone] = SZD_ZONE_FULL;
+  ns->wp[zone] = __emu_zslba(ns, zone) + ns->options.zone_cap;
+}
+
+// Zeroes length bytes of data at offset.
+static void __emu_zero(EmuNamespace *ns, uint64_t offset, uint64_t length) {
+  // Unbacked pages read as zeroes, which is what a reset zone holds.
+  if (ns->fd >= 0) {
+    // Holes are punched per block, partial blocks are zeroed by the fs.
+    if (fallocate(ns->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  (off_t)offset, (off_t)length) != 0) {
+      memset(ns->data + offset, 0, length);
+    }
+    return;
+  }
+  // madvise drops whole pages, pages shared with a neighbouring zone are
+  // only partially ours and are zeroed instead.
+  uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t begin = SPDK_ALIGN_CEIL(offset, page_size);
+  uint64_t end = SPDK_ALIGN_FLOOR(offset + length, page_size);
+  if (begin >= end) {
+    memset(ns->data + offset, 0, length);
+    return;
+  }
+  memset(ns->data + offset, 0, begin - offset);
+  if (madvise(ns->data + begin, end - begin, MADV_DONTNEED) != 0) {
+    memset(ns->data + begin, 0, end - begin);
+  }
+  memset(ns->data + end, 0, offset + length - end);
+}
+
+// Moves a zone to empty and drops its data, called with the lock held.
+static uint16_t __emu_empty_zone(EmuNamespace *ns, uint64_t zone) {
+  uint8_t state = ns->state[zone];
+  uint64_t zslba = __emu_zslba(ns, zone);
+  if (state == SZD_ZONE_READ_ONLY) {
+    return SPDK_NVME_SC_ZONE_IS_READONLY;
+  }
+  if (state == SZD_ZONE_OFFLINE) {
+    return SPDK_NVME_SC_ZONE_IS_OFFLINE;
+  }
+  if (state == SZD_ZONE_EMPTY) {
+    return 0;
+  }
+  ns->open_zones -= __emu_is_open(state);
+  ns->active_zones -= __emu_is_active(state);
+  __emu_zero(ns, zslba * ns->options.lba_size,
+             (ns->wp[zone] - zslba) * ns->options.lba_size);
+  ns->state[zone] = SZD_ZONE_EMPTY;
+  ns->wp[zone] = zslba;
+  return 0;
+}
+
+// Appends lba_count lbas to the zone at zslba, gathering them with fetch.
+// Returns the lba written to in alba.
+typedef void (*emu_fetch_fn)(void *ctx, uint8_t *dst, uint64_t size);
+
+static uint16_t __emu_append(EmuNamespace *ns, uint64_t zslba,
+                             uint32_t lba_count, emu_fetch_fn fetch,
+                             void *ctx, uint64_t *alba) {
+  uint16_t sc =
+      __emu_check_range(ns, zslba, lba_count, ns->options.zasl);
+  if (sc != 0) {
+    return sc;
+  }
+  uint64_t zone = __emu_zone_of(ns, zslba);
+  if (zslba != __emu_zslba(ns, zone)) {
+    return SPDK_NVME_SC_INVALID_FIELD;
+  }
+  pthread_mutex_lock(&ns->lock);
+  uint64_t wp = ns->wp[zone];
+  if (ns->state[zone] != SZD_ZONE_FULL &&
+      wp + lba_count > zslba + ns->options.zone_cap) {
+    pthread_mutex_unlock(&ns->lock);
+    return SPDK_NVME_SC_ZONE_BOUNDARY_ERROR;
+  }
+  if ((sc = __emu_open_zone(ns, zone)) != 0) {
+    pthread_mutex_unlock(&ns->lock);
+    return sc;
+  }
+  fetch(ctx, ns->data + wp * ns->options.lba_size,
+        (uint64_t)lba_count * ns->options.lba_size);
+  ns->wp[zone] = wp + lba_count;
+  if (ns->wp[zone] == zslba + ns->options.zone_cap) {
+    __emu_fill_zone(ns, zone);
+  }
+  pthread_mutex_unlock(&ns->lock);
+  *alba = wp;
+  return 0;
+}
+
+static uint16_t __emu_read(EmuNamespace *ns, uint64_t lba, uint32_t lba_count,
+                           emu_fetch_fn store, void *ctx) {
+  uint16_t sc = __emu_check_range(ns, lba, lba_count, ns->options.mdts);
+  if (sc != 0) {
+    return sc;
+  }
+  // Reads of data that is not written return zeroes, as the device does.
+  store(ctx, ns->data + lba * ns->options.lba_size,
+        (uint64_t)lba_count * ns->options.lba_size);
+  return 0;
+}
+
+static void __emu_copy_from(void *ctx, uint8_t *dst, uint64_t size) {
+  memcpy(dst, ctx, size);
+}
+
+static void __emu_copy_to(void *ctx, uint8_t *src, uint64_t size) {
+  memcpy(ctx, src, size);
+}
+
+// Walks the SGL of a vectored command, as the controller would.
+typedef struct {
+  void *cb_arg;
+  spdk_nvme_req_next_sge_cb next_sge_fn;
+  bool to_device;
+  bool failed;
+} EmuSgl;
+
+static void __emu_sgl_copy(void *ctx, uint8_t *data, uint64_t size) {
+  EmuSgl *sgl = (EmuSgl *)ctx;
+  while (size > 0) {
+    void *address;
+    uint32_t length;
+    if (sgl->next_sge_fn(sgl->cb_arg, &address, &length) != 0 ||
+        length == 0) {
+      sgl->failed = true;
+      return;
+    }
+    length = (uint32_t)spdk_min((uint64_t)length, size);
+    if (sgl->to_device) {
+      memcpy(data, address, length);
+    } else {
+      memcpy(address, data, length);
+    }
+    data += length;
+    size -= length;
+  }
+}
+
+int szd_emu_read(EmuQPair *qpair, void *buffer, uint64_t lba,
+                 uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  uint16_t sc = __emu_read(qpair->ns, lba, lba_count,
+                           __emu_copy_to, buffer);
+  __emu_set_status(done, sc);
+  return 0;
+}
+
+int szd_emu_readv(EmuQPair *qpair, uint64_t lba, uint32_t lba_count,
+                  spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                  spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                  spdk_nvme_req_next_sge_cb next_sge_fn) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  EmuSgl sgl = {cb_arg, next_sge_fn, false, false};
+  reset_sgl_fn(cb_arg, 0);
+  uint16_t sc = __emu_read(qpair->ns, lba, lba_count, __emu_sgl_copy, &sgl);
+  if (sc == 0 && sgl.failed) {
+    sc = SPDK_NVME_SC_INVALID_FIELD;
+  }
+  __emu_set_status(done, sc);
+  return 0;
+}
+
+int szd_emu_zone_append(EmuQPair *qpair, void *buffer, uint64_t zslba,
+                        uint32_t lba_count, spdk_nvme_cmd_cb cb_fn,
+                        void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  uint64_t alba = 0;
+  uint16_t sc = __emu_append(qpair->ns, zslba, lba_count, __emu_copy_from,
+                             buffer, &alba);
+  __emu_set_status(done, sc);
+  done->cpl.cdw0 = (uint32_t)alba;
+  done->cpl.cdw1 = (uint32_t)(alba >> 32);
+  return 0;
+}
+
+int szd_emu_zone_appendv(EmuQPair *qpair, uint64_t zslba, uint32_t lba_count,
+                         spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+                         spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+                         spdk_nvme_req_next_sge_cb next_sge_fn) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  EmuSgl sgl = {cb_arg, next_sge_fn, true, false};
+  reset_sgl_fn(cb_arg, 0);
+  uint64_t alba = 0;
+  uint16_t sc =
+      __emu_append(qpair->ns, zslba, lba_count, __emu_sgl_copy, &sgl, &alba);
+  // The data is already in the zone, a short SGL leaves garbage behind.
+  if (sc == 0 && sgl.failed) {
+    sc = SPDK_NVME_SC_INVALID_FIELD;
+  }
+  __emu_set_status(done, sc);
+  done->cpl.cdw0 = (uint32_t)alba;
+  done->cpl.cdw1 = (uint32_t)(alba >> 32);
+  return 0;
+}
+
+// Returns a status code when the zone can not take the action.
+typedef uint16_t (*emu_zone_fn)(EmuNamespace *ns, uint64_t zone);
+
+static uint16_t __emu_zone_action(EmuNamespace *ns, uint64_t slba,
+                                  bool select_all, emu_zone_fn action) {
+  uint64_t zone = __emu_zone_of(ns, slba);
+  if (!select_all && (zone >= ns->options.nr_zones ||
+                      slba != __emu_zslba(ns, zone))) {
+    return SPDK_NVME_SC_INVALID_FIELD;
+  }
+  uint16_t sc = 0;
+  pthread_mutex_lock(&ns->lock);
+  if (select_all) {
+    // As on a device, select all skips the zones it does not apply to.
+    for (zone = 0; zone < ns->options.nr_zones; zone++) {
+      (void)action(ns, zone);
+    }
+  } else {
+    sc = action(ns, zone);
+  }
+  pthread_mutex_unlock(&ns->lock);
+  return sc;
+}
+
+static uint16_t __emu_finish_zone(EmuNamespace *ns, uint64_t zone) {
+  uint8_t state = ns->state[zone];
+  if (state == SZD_ZONE_READ_ONLY) {
+    return SPDK_NVME_SC_ZONE_IS_READONLY;
+  }
+  if (state == SZD_ZONE_OFFLINE) {
+    return SPDK_NVME_SC_ZONE_IS_OFFLINE;
+  }
+  if (state != SZD_ZONE_FULL) {
+    __emu_fill_zone(ns, zone);
+  }
+  return 0;
+}
+
+int szd_emu_reset_zone(EmuQPair *qpair, uint64_t slba, bool select_all,
+                       spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  uint16_t sc =
+      __emu_zone_action(qpair->ns, slba, select_all, __emu_empty_zone);
+  __emu_set_status(done, sc);
+  return 0;
+}
+
+int szd_emu_finish_zone(EmuQPair *qpair, uint64_t slba, bool select_all,
+                        spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  uint16_t sc =
+      __emu_zone_action(qpair->ns, slba, select_all, __emu_finish_zone);
+  __emu_set_status(done, sc);
+  return 0;
+}
+
+int szd_emu_report_zones(EmuQPair *qpair, void *payload, uint32_t payload_size,
+                         uint64_t slba, spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  EmuNamespace *ns = qpair->ns;
+  uint64_t zone = __emu_zone_of(ns, slba);
+  if (zone >= ns->options.nr_zones ||
+      payload_size < sizeof(struct spdk_nvme_zns_zone_report)) {
+    __emu_set_status(done, SPDK_NVME_SC_INVALID_FIELD);
+    return 0;
+  }
+  // Emulated zones have no descriptor extension.
+  struct spdk_nvme_zns_zone_report *report =
+      (struct spdk_nvme_zns_zone_report *)payload;
+  uint64_t max_zones =
+      (payload_size - sizeof(struct spdk_nvme_zns_zone_report)) /
+      sizeof(struct spdk_nvme_zns_zone_desc);
+  uint64_t nr_zones = spdk_min(max_zones, ns->options.nr_zones - zone);
+  memset(report, 0, sizeof(*report));
+  pthread_mutex_lock(&ns->lock);
+  for (uint64_t i = 0; i < nr_zones; i++) {
+    struct spdk_nvme_zns_zone_desc *desc = &report->descs[i];
+    memset(desc, 0, sizeof(*desc));
+    desc->zt = SPDK_NVME_ZONE_TYPE_SEQWR;
+    desc->zs = ns->state[zone + i];
+    desc->zcap = ns->options.zone_cap;
+    desc->zslba = __emu_zslba(ns, zone + i);
+    desc->wp = ns->wp[zone + i];
+  }
+  pthread_mutex_unlock(&ns->lock);
+  report->nr_zones = nr_zones;
+  return 0;
+}
+
+int szd_emu_copy(EmuQPair *qpair,
+                 const struct spdk_nvme_scc_source_range *ranges,
+                 uint16_t num_ranges, uint64_t dest_lba,
+                 spdk_nvme_cmd_cb cb_fn, void *cb_arg) {
+  EmuCompletion *done = __emu_complete(qpair, cb_fn, cb_arg);
+  if (spdk_unlikely(done == NULL)) {
+    return -ENOMEM;
+  }
+  EmuNamespace *ns = qpair->ns;
+  uint64_t zone = __emu_zone_of(ns, dest_lba);
+  uint64_t lbas = 0;
+  uint16_t sc = 0;
+  for (uint16_t i = 0; i < num_ranges && sc == 0; i++) {
+    // nlb is 0's based.
+    sc = __emu_check_range(ns, ranges[i].slba, ranges[i].nlb + 1u, UINT64_MAX);
+    lbas += ranges[i].nlb + 1u;
+  }
+  if (sc == 0) {
+    sc = __emu_check_range(ns, dest_lba, (uint32_t)lbas, UINT64_MAX);
+  }
+  if (sc != 0) {
+    __emu_set_status(done, sc);
+    return 0;
+  }
+  // Copy is a regular write, it has to start at the write pointer.
+  pthread_mutex_lock(&ns->lock);
+  uint64_t zslba = __emu_zslba(ns, zone);
+  if (dest_lba != ns->wp[zone] || ns->state[zone] == SZD_ZONE_FULL) {
+    sc = ns->state[zone] == SZD_ZONE_FULL ? SPDK_NVME_SC_ZONE_IS_FULL
+                                          : SPDK_NVME_SC_ZONE_INVALID_WRITE;
+  } else if (dest_lba + lbas > zslba + ns->options.zone_cap) {
+    sc = SPDK_NVME_SC_ZONE_BOUNDARY_ERROR;
+  } else {
+    sc = __emu_open_zone(ns, zone);
+  }
+  if (sc == 0) {
+    uint8_t *dst = ns->data + dest_lba * ns->options.lba_size;
+    for (uint16_t i = 0; i < num_ranges; i++) {
+      uint64_t size = (ranges[i].nlb + 1u) * ns->options.lba_size;
+      memmove(dst, ns->data + ranges[i].slba * ns->options.lba_size, size);
+      dst += size;
+    }
+    ns->wp[zone] = dest_lba + lbas;
+    if (ns->wp[zone] == zslba + ns->options.zone_cap) {
+      __emu_fill_zone(ns, zone);
+    }
+  }
+  pthread_mutex_unlock(&ns->lock);
+  __emu_set_status(done, sc);
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+} // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
+#endif
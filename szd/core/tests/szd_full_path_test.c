@@ -64,6 +64,15 @@ typedef struct {
   int rc;
 } thread_data;
 
+static uint32_t callbacks_done;
+static uint16_t callbacks_err;
+static void count_callback(void *arg, uint16_t err, uint64_t lba) {
+  (void)arg;
+  (void)lba;
+  callbacks_done++;
+  callbacks_err |= err;
+}
+
 static pthread_mutex_t mut;
 static uint8_t thread_barrier;
 #define PLUS_THREAD_BARRIER(mut, bar)                                          \
@@ -163,19 +172,21 @@ void *worker_thread(void *arg) {
   pthread_exit(NULL);
 }
 
-int main(void) {
-  int rc;
-  printf("----------------------INIT----------------------\n");
-  uint64_t min_zone = 2, max_zone = 10;
-  DeviceOpenOptions open_opts = {min_zone, max_zone};
-  DeviceManager **manager = (DeviceManager **)calloc(1, sizeof(DeviceManager));
-  DeviceOptions opts = DeviceOptions_default;
-  rc = szd_init(manager, &opts);
-  DEBUG_TEST_PRINT("SPDK init ", rc);
-  VALID(rc);
+// The test runs on the last ZNS device that is found, or on an emulated
+// device when built with SZD_TEST_EMU (TESTING_EMULATED) or when the
+// environment variable SZD_TEST_EMU is set.
+static bool use_emulated_device(void) {
+#ifdef SZD_TEST_EMU
+  return true;
+#else
+  const char *emu = getenv("SZD_TEST_EMU");
+  return emu != NULL && strcmp(emu, "0") != 0;
+#endif
+}
 
-  // find devices
-  printf("----------------------PROBE----------------------\n");
+// Finds the last ZNS device, returns NULL if there is none.
+static char *probe_device(DeviceManager **manager) {
+  int rc;
   char *device_to_use = NULL;
   ProbeInformation **prober =
       (ProbeInformation **)calloc(1, sizeof(ProbeInformation *));
@@ -199,35 +210,65 @@ int main(void) {
   // anymore.
   szd_free_probe_information(*prober);
   free(prober);
-  if (!device_to_use) {
-    printf("No ZNS Device found.\n Are you sure you have a ZNS device "
-           "connected?\n");
-    assert(false);
-  }
-  printf("ZNS device %s found. This device will be used for the rest of the "
-         "test.\n",
-         device_to_use);
+  return device_to_use;
+}
 
-  rc = szd_reinit(manager);
-  DEBUG_TEST_PRINT("reinit return code ", rc);
+int main(void) {
+  int rc;
+  printf("----------------------INIT----------------------\n");
+  uint64_t min_zone = 2, max_zone = 10;
+  DeviceOpenOptions open_opts = {min_zone, max_zone};
+  DeviceManager **manager = (DeviceManager **)calloc(1, sizeof(DeviceManager));
+  bool emulated = use_emulated_device();
+  DeviceOptions opts = {.name = DeviceOptions_default.name,
+                        .setup_spdk = DeviceOptions_default.setup_spdk,
+                        .emulated = emulated,
+                        .bdev_config = DeviceOptions_default.bdev_config};
+  rc = szd_init(manager, &opts);
+  DEBUG_TEST_PRINT("SPDK init ", rc);
   VALID(rc);
 
-  // init spdk
-  printf("----------------------OPENING DEVICE----------------------\n");
-  // try non-existent device
-  rc = szd_open(*manager, "non-existent traddr", &open_opts);
-  DEBUG_TEST_PRINT("non-existent return code ", rc);
-  INVALID(rc);
+  if (emulated) {
+    printf("------------------OPENING EMULATED DEVICE------------------\n");
+    EmuOptions main_emu_opts = EmuOptions_default;
+    rc = szd_open_emu(*manager, &main_emu_opts, &open_opts);
+    DEBUG_TEST_PRINT("emulated open code ", rc);
+    VALID(rc);
+    assert((*manager)->backend == SZD_BACKEND_EMU);
+  } else {
+    // find devices
+    printf("----------------------PROBE----------------------\n");
+    char *device_to_use = probe_device(manager);
+    if (!device_to_use) {
+      printf("No ZNS Device found.\n Are you sure you have a ZNS device "
+             "connected? Set SZD_TEST_EMU to use an emulated device.\n");
+      assert(false);
+    }
+    printf("ZNS device %s found. This device will be used for the rest of "
+           "the test.\n",
+           device_to_use);
 
-  // try existing device
-  rc = szd_open(*manager, device_to_use, &open_opts);
-  DEBUG_TEST_PRINT("existing return code ", rc);
-  VALID(rc);
-  free(device_to_use);
+    rc = szd_reinit(manager);
+    DEBUG_TEST_PRINT("reinit return code ", rc);
+    VALID(rc);
+
+    // init spdk
+    printf("----------------------OPENING DEVICE----------------------\n");
+    // try non-existent device
+    rc = szd_open(*manager, "non-existent traddr", &open_opts);
+    DEBUG_TEST_PRINT("non-existent return code ", rc);
+    INVALID(rc);
+
+    // try existing device
+    rc = szd_open(*manager, device_to_use, &open_opts);
+    DEBUG_TEST_PRINT("existing return code ", rc);
+    VALID(rc);
+    free(device_to_use);
+    assert((*manager)->ctrlr != NULL);
+    assert((*manager)->ns != NULL);
+  }
 
   // ensure that everything from this device is OK
-  assert((*manager)->ctrlr != NULL);
-  assert((*manager)->ns != NULL);
   assert((*manager)->info.lba_size > 0);
   assert((*manager)->info.mdts > 0);
   assert((*manager)->info.zasl > 0);
@@ -256,6 +297,24 @@ int main(void) {
   printf("min lba is %ld\n", info.min_lba);
   printf("max lba is %ld\n", info.max_lba);
 
+  // zones are placed back to back in the cap prefix, each with its own cap
+  uint64_t zone_cap_prefix[5];
+  rc = szd_get_zone_cap_prefix(*manager, info.min_lba,
+                               info.min_lba + 3 * info.zone_size,
+                               zone_cap_prefix);
+  VALID(rc);
+  assert(zone_cap_prefix[0] == (info.min_lba / info.zone_size) * info.zone_cap);
+  for (uint64_t zone = 0; zone < 4; zone++) {
+    uint64_t zone_cap;
+    rc = szd_get_zone_cap(*qpair, info.min_lba + zone * info.zone_size,
+                          &zone_cap);
+    VALID(rc);
+    assert(zone_cap_prefix[zone + 1] - zone_cap_prefix[zone] == zone_cap);
+  }
+  rc = szd_get_zone_cap_prefix(*manager, info.min_lba + 1, info.min_lba + 1,
+                               zone_cap_prefix);
+  INVALID(rc);
+
   uint64_t write_head;
   uint64_t append_head;
   printf("----------------------WORKLOAD SMALL----------------------\n");
@@ -296,7 +355,6 @@ int main(void) {
   for (uint64_t i = 0; i < info.lba_size; i++) {
     assert((char)(pattern_read_1)[i] == (char)(*pattern_1)[i]);
   }
-  szd_free(*pattern_1);
   szd_free(pattern_read_1);
   char *pattern_read_2 = (char *)szd_calloc((*qpair)->man->info.lba_size,
                                             info.zasl, sizeof(char *));
@@ -307,6 +365,61 @@ int main(void) {
   for (uint64_t i = 0; i < info.zasl; i++) {
     assert((char)(pattern_read_2)[i] == (char)(*pattern_2)[i]);
   }
+  // Issue two reads at once and poll for both afterwards
+  char *pattern_read_async = (char *)szd_calloc(
+      (*qpair)->man->info.lba_size, info.lba_size * 2, sizeof(char));
+  Completion read_completions[2] = {Completion_default, Completion_default};
+  rc = szd_read_async(*qpair, min_zone * info.zone_size, pattern_read_async,
+                      info.lba_size, &read_completions[0]);
+  rc = szd_read_async(*qpair, min_zone * info.zone_size + 1,
+                      pattern_read_async + info.lba_size, info.lba_size,
+                      &read_completions[1]) |
+       rc;
+  DEBUG_TEST_PRINT("read async ", rc);
+  VALID(rc);
+  rc = szd_poll_async(*qpair, &read_completions[0]);
+  rc = szd_poll_async(*qpair, &read_completions[1]) | rc;
+  DEBUG_TEST_PRINT("poll async reads ", rc);
+  VALID(rc);
+  for (uint64_t i = 0; i < info.lba_size; i++) {
+    assert((char)(pattern_read_async)[i] == (char)(*pattern_1)[i]);
+    assert((char)(pattern_read_async)[info.lba_size + i] ==
+           (char)(*pattern_2)[i]);
+  }
+  // Same reads, but completed with callbacks
+  memset(pattern_read_async, 0, info.lba_size * 2);
+  rc = szd_read_async_cb(*qpair, min_zone * info.zone_size, pattern_read_async,
+                         info.lba_size, count_callback, NULL);
+  rc = szd_read_async_cb(*qpair, min_zone * info.zone_size + 1,
+                         pattern_read_async + info.lba_size, info.lba_size,
+                         count_callback, NULL) |
+       rc;
+  DEBUG_TEST_PRINT("read async callbacks ", rc);
+  VALID(rc);
+  while (callbacks_done < 2) {
+    int32_t completions = szd_process_completions(*qpair, 0);
+    assert(completions >= 0);
+    (void)completions;
+  }
+  DEBUG_TEST_PRINT("process completions ", callbacks_err);
+  VALID(callbacks_err);
+  for (uint64_t i = 0; i < info.lba_size; i++) {
+    assert((char)(pattern_read_async)[i] == (char)(*pattern_1)[i]);
+    assert((char)(pattern_read_async)[info.lba_size + i] ==
+           (char)(*pattern_2)[i]);
+  }
+  szd_free(pattern_read_async);
+  // Async reads can not cross MDTS
+  Completion read_completion = Completion_default;
+  pattern_read_async = (char *)szd_calloc((*qpair)->man->info.lba_size,
+                                          info.mdts + info.lba_size,
+                                          sizeof(char));
+  rc = szd_read_async(*qpair, min_zone * info.zone_size, pattern_read_async,
+                      info.mdts + info.lba_size, &read_completion);
+  DEBUG_TEST_PRINT("read async larger than mdts ", rc);
+  INVALID(rc);
+  szd_free(pattern_read_async);
+  szd_free(*pattern_1);
   szd_free(*pattern_2);
   rc = szd_reset_all(*qpair);
   DEBUG_TEST_PRINT("reset all ", rc);
@@ -464,6 +577,126 @@ int main(void) {
   DEBUG_TEST_PRINT("reset all ", rc);
   VALID(rc);
 
+  printf("----------------------WORKLOAD PIPELINED----------------------\n");
+  append_head = min_zone * info.zone_size;
+  rc = write_pattern(pattern_3, *qpair, info.lba_size * (info.zone_cap + 7),
+                     23);
+  VALID(rc);
+  rc = szd_append_pipelined(*qpair, &append_head, *pattern_3,
+                            info.lba_size * (info.zone_cap + 7), 4);
+  DEBUG_TEST_PRINT("pipelined append 1 zoneborder + 7 ", rc);
+  VALID(rc);
+  assert(append_head == min_zone * info.zone_size + info.zone_size + 7);
+  rc = szd_get_zone_head(*qpair, min_zone * info.zone_size + info.zone_size,
+                         &write_head);
+  VALID(rc);
+  assert(write_head == min_zone * info.zone_size + info.zone_size + 7);
+  // The zone state table should equal the device
+  rc = szd_refresh_zone_table(*qpair);
+  DEBUG_TEST_PRINT("refresh zone table ", rc);
+  VALID(rc);
+  rc = szd_get_zone_head(*qpair, min_zone * info.zone_size, &write_head);
+  VALID(rc);
+  assert(write_head == min_zone * info.zone_size + info.zone_size);
+  rc = szd_get_zone_head(*qpair, min_zone * info.zone_size + info.zone_size,
+                         &write_head);
+  VALID(rc);
+  assert(write_head == min_zone * info.zone_size + info.zone_size + 7);
+  ZoneDescriptor descs[3];
+  rc = szd_get_zone_descriptors(*qpair, min_zone * info.zone_size,
+                                min_zone * info.zone_size + 2 * info.zone_size,
+                                descs);
+  DEBUG_TEST_PRINT("zone descriptors ", rc);
+  VALID(rc);
+  assert(descs[0].zslba == min_zone * info.zone_size);
+  assert(descs[0].zcap == info.zone_cap);
+  assert(descs[0].state == SZD_ZONE_FULL);
+  assert(descs[1].wp == min_zone * info.zone_size + info.zone_size + 7);
+  assert(descs[1].state == SZD_ZONE_IMPLICIT_OPEN);
+  assert(descs[2].wp == descs[2].zslba);
+  assert(descs[2].state == SZD_ZONE_EMPTY);
+  pattern_read_4 = (char *)szd_calloc((*qpair)->man->info.lba_size,
+                                      info.lba_size * (info.zone_cap + 7),
+                                      sizeof(char *));
+  rc = szd_read_pipelined(*qpair, min_zone * info.zone_size, pattern_read_4,
+                          info.lba_size * (info.zone_cap + 7), 4);
+  DEBUG_TEST_PRINT("pipelined read 1 zoneborder + 7 ", rc);
+  VALID(rc);
+  for (uint64_t i = 0; i < info.lba_size * (info.zone_cap + 7); i++) {
+    assert((char)(pattern_read_4)[i] == (char)(*pattern_3)[i]);
+  }
+  szd_free(*pattern_3);
+  szd_free(pattern_read_4);
+  // Batched resets report per zone
+  uint64_t reset_slbas[3] = {min_zone * info.zone_size,
+                             min_zone * info.zone_size + info.zone_size,
+                             info.lba_cap};
+  int reset_status[3] = {-1, -1, -1};
+  rc = szd_reset_many(*qpair, reset_slbas, 3, reset_status);
+  DEBUG_TEST_PRINT("reset many with one invalid zone ", rc);
+  INVALID(rc);
+  VALID(reset_status[0]);
+  VALID(reset_status[1]);
+  INVALID(reset_status[2]);
+  rc = szd_get_zone_head(*qpair, min_zone * info.zone_size + info.zone_size,
+                         &write_head);
+  VALID(rc);
+  assert(write_head == min_zone * info.zone_size + info.zone_size);
+  Completion reset_completion = Completion_default;
+  rc = szd_reset_async(*qpair, min_zone * info.zone_size, &reset_completion);
+  VALID(rc);
+  rc = szd_poll_async(*qpair, &reset_completion);
+  DEBUG_TEST_PRINT("reset async ", rc);
+  VALID(rc);
+  rc = szd_reset_all(*qpair);
+  DEBUG_TEST_PRINT("reset all ", rc);
+  VALID(rc);
+
+  printf("----------------------WORKLOAD VECTORED----------------------\n");
+  append_head = min_zone * info.zone_size;
+  rc = write_pattern(pattern_3, *qpair, info.lba_size * (info.zone_cap + 3),
+                     29);
+  VALID(rc);
+  // Header, payload and trailer as separate segments, crossing a zone border.
+  struct iovec iov[3] = {
+      {.iov_base = *pattern_3, .iov_len = info.lba_size},
+      {.iov_base = *pattern_3 + info.lba_size,
+       .iov_len = info.lba_size * info.zone_cap},
+      {.iov_base = *pattern_3 + info.lba_size * (info.zone_cap + 1),
+       .iov_len = info.lba_size * 2}};
+  rc = szd_appendv(*qpair, &append_head, iov, 3);
+  DEBUG_TEST_PRINT("vectored append 1 zoneborder + 3 ", rc);
+  VALID(rc);
+  assert(append_head == min_zone * info.zone_size + info.zone_size + 3);
+  pattern_read_4 = (char *)szd_calloc((*qpair)->man->info.lba_size,
+                                      info.lba_size * (info.zone_cap + 3),
+                                      sizeof(char *));
+  struct iovec riov[2] = {
+      {.iov_base = pattern_read_4 + info.lba_size * 2,
+       .iov_len = info.lba_size * (info.zone_cap + 1)},
+      {.iov_base = pattern_read_4, .iov_len = info.lba_size * 2}};
+  rc = szd_readv(*qpair, min_zone * info.zone_size, riov, 2);
+  DEBUG_TEST_PRINT("vectored read 1 zoneborder + 3 ", rc);
+  VALID(rc);
+  for (uint64_t i = 0; i < info.lba_size * (info.zone_cap + 1); i++) {
+    assert((char)(pattern_read_4)[info.lba_size * 2 + i] ==
+           (char)(*pattern_3)[i]);
+  }
+  for (uint64_t i = 0; i < info.lba_size * 2; i++) {
+    assert((char)(pattern_read_4)[i] ==
+           (char)(*pattern_3)[info.lba_size * (info.zone_cap + 1) + i]);
+  }
+  // Unalligned vectors are not allowed
+  iov[0].iov_len = info.lba_size - 1;
+  rc = szd_appendv(*qpair, &append_head, iov, 1);
+  DEBUG_TEST_PRINT("vectored append unalligned ", rc);
+  INVALID(rc);
+  szd_free(*pattern_3);
+  szd_free(pattern_read_4);
+  rc = szd_reset_all(*qpair);
+  DEBUG_TEST_PRINT("reset all ", rc);
+  VALID(rc);
+
   printf(
       "----------------------WORKLOAD MULTITHREADING----------------------\n");
   printf("This might take a time...\n");
@@ -503,6 +736,38 @@ int main(void) {
   DEBUG_TEST_PRINT("thread 3 writes and reads ", rc);
   VALID(rc);
 
+  printf("----------------------DMA POOL----------------------\n");
+  DMAPool *dma_pool;
+  rc = szd_dma_pool_create(&dma_pool, info.lba_size, 4 * info.lba_size,
+                           SZD_SOCKET_ID_ANY);
+  DEBUG_TEST_PRINT("valid dma pool create ", rc);
+  VALID(rc);
+  assert(dma_pool->classes == 3 && dma_pool->max_size == 4 * info.lba_size);
+  DMACache *dma_cache;
+  rc = szd_dma_cache_create(dma_pool, &dma_cache);
+  VALID(rc);
+  // a returned buffer is handed out again for the same size class
+  char *dma_buffer = (char *)szd_dma_get(dma_cache, 3 * info.lba_size, false);
+  assert(dma_buffer != NULL);
+  memset(dma_buffer, 0xFF, 4 * info.lba_size);
+  szd_dma_put(dma_cache, dma_buffer, 3 * info.lba_size);
+  char *dma_reused = (char *)szd_dma_get(dma_cache, 4 * info.lba_size, true);
+  assert(dma_reused == dma_buffer);
+  for (uint64_t i = 0; i < 4 * info.lba_size; i++) {
+    assert(dma_reused[i] == 0);
+  }
+  // larger buffers are not pooled, but still work
+  char *dma_large = (char *)szd_dma_get(dma_cache, 5 * info.lba_size, true);
+  assert(dma_large != NULL);
+  szd_dma_put(dma_cache, dma_large, 5 * info.lba_size);
+  szd_dma_put(dma_cache, dma_reused, 4 * info.lba_size);
+  // the pool outlives its last cache
+  rc = szd_dma_pool_destroy(dma_pool);
+  VALID(rc);
+  rc = szd_dma_cache_destroy(dma_cache);
+  DEBUG_TEST_PRINT("valid dma cache destroy ", rc);
+  VALID(rc);
+
   printf("----------------------CLOSE----------------------\n");
   // destroy qpair
   rc = szd_destroy_qpair(*qpair);
@@ -519,6 +784,63 @@ int main(void) {
   DEBUG_TEST_PRINT("invalid close code ", rc);
   INVALID(rc);
 
+  printf("----------------------EMULATED DEVICE----------------------\n");
+  EmuOptions emu_opts = EmuOptions_default;
+  emu_opts.zone_size = 0x20;
+  emu_opts.zone_cap = 0x18;
+  emu_opts.nr_zones = 0x8;
+  emu_opts.max_active_zones = 2;
+  DeviceOpenOptions emu_open_opts = {0, 0};
+  rc = szd_open_emu(*manager, &emu_opts, &emu_open_opts);
+  DEBUG_TEST_PRINT("emulated open code ", rc);
+  VALID(rc);
+  assert((*manager)->backend == SZD_BACKEND_EMU);
+  assert((*manager)->info.zone_cap == emu_opts.zone_cap);
+  assert((*manager)->info.lba_cap == emu_opts.nr_zones * emu_opts.zone_size);
+  rc = szd_create_qpair(*manager, qpair);
+  VALID(rc);
+  // appends skip the lbas between zone capacity and zone size
+  uint64_t emu_bytes = emu_opts.zone_size * emu_opts.lba_size;
+  char *emu_write = (char *)szd_calloc(emu_opts.lba_size, emu_bytes, 1);
+  char *emu_read = (char *)szd_calloc(emu_opts.lba_size, emu_bytes, 1);
+  for (uint64_t i = 0; i < emu_bytes; i++) {
+    emu_write[i] = (char)(i % 251);
+  }
+  uint64_t emu_head = 0;
+  rc = szd_append(*qpair, &emu_head, emu_write, emu_bytes);
+  DEBUG_TEST_PRINT("emulated append code ", rc);
+  VALID(rc);
+  assert(emu_head == emu_opts.zone_size + 0x8);
+  rc = szd_read(*qpair, 0, emu_read, emu_bytes);
+  VALID(rc);
+  assert(memcmp(emu_write, emu_read, emu_bytes) == 0);
+  rc = szd_get_zone_head(*qpair, 0, &write_head);
+  VALID(rc);
+  assert(write_head == emu_opts.zone_cap);
+  // the first zone is full, so only one more zone can become active
+  emu_head = 2 * emu_opts.zone_size;
+  rc = szd_append(*qpair, &emu_head, emu_write, emu_opts.lba_size);
+  VALID(rc);
+  emu_head = 3 * emu_opts.zone_size;
+  rc = szd_append(*qpair, &emu_head, emu_write, emu_opts.lba_size);
+  DEBUG_TEST_PRINT("emulated too many active zones code ", rc);
+  INVALID(rc);
+  // resets drop the data of the zones
+  rc = szd_reset_all(*qpair);
+  VALID(rc);
+  rc = szd_read(*qpair, 0, emu_read, emu_opts.lba_size);
+  VALID(rc);
+  for (uint64_t i = 0; i < emu_opts.lba_size; i++) {
+    assert(emu_read[i] == 0);
+  }
+  szd_free(emu_write);
+  szd_free(emu_read);
+  rc = szd_destroy_qpair(*qpair);
+  VALID(rc);
+  rc = szd_close(*manager);
+  DEBUG_TEST_PRINT("emulated close code ", rc);
+  VALID(rc);
+
   rc = szd_destroy(*manager);
   DEBUG_TEST_PRINT("valid shutdown code ", rc);
   VALID(rc);
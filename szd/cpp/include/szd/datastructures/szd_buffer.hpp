@@ -13,13 +13,17 @@
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 class SZDBuffer {
 public:
-  SZDBuffer(size_t size, uint64_t lba_size);
+  // Memory is allocated on NUMA node socket_id, use the node of the channel
+  // that does I/O with the buffer (SZDChannel::GetSocketId).
+  SZDBuffer(size_t size, uint64_t lba_size,
+            int32_t socket_id = SZD_SOCKET_ID_ANY);
   // No copying or implicits
   SZDBuffer(const SZDBuffer &) = delete;
   SZDBuffer &operator=(const SZDBuffer &) = delete;
   ~SZDBuffer();
 
   inline size_t GetBufferSize() const { return backed_memory_size_; }
+  inline int32_t GetSocketId() const { return socket_id_; }
   inline std::string DebugBufferString() const {
     return std::string((const char *)backed_memory_, backed_memory_size_);
   }
@@ -49,6 +53,7 @@ private:
   uint64_t lba_size_;
   void *backed_memory_;
   size_t backed_memory_size_;
+  int32_t socket_id_;
 };
 } // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
 
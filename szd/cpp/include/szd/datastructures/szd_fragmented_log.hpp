@@ -115,14 +115,22 @@ private:
                         std::vector<std::pair<uint64_t, uint64_t>> &regions,
                         bool alligned = true);
 #endif
+  // Frees the zones of the region at begin_zone that did reset in a partially
+  // failed reset.
+  void FreeResetZones(uint64_t begin_zone,
+                      const std::vector<SZDStatus> &zone_status);
   // const after initialisation
+  const uint64_t min_zone_nr_;
+  const uint64_t max_zone_nr_;
   const uint64_t min_zone_head_;
   const uint64_t max_zone_head_;
   const uint64_t zone_size_;
-  const uint64_t zone_cap_;
   const uint64_t lba_size_;
   const uint64_t zasl_;
-  const uint64_t zone_bytes_;
+  // Smallest capacity of the zones in the log, so that estimates of the zones
+  // needed never fall short when capacities differ.
+  uint64_t zone_cap_;
+  uint64_t zone_bytes_;
   const uint8_t number_of_readers_;
   const uint8_t number_of_writers_;
   std::mutex mut_;
@@ -34,6 +34,9 @@ SZDFreeList *FirstZoneRegion(SZDFreeList *target);
 SZDFreeList *lastZoneRegion(SZDFreeList *target);
 
 void FreeZones(SZDFreeList *target, SZDFreeList **orig);
+// Splits off everything after the first zones zones into a new next region in
+// the same state, so that part of a region can be freed.
+void SplitRegion(SZDFreeList *target, uint64_t zones);
 void AllocZonesFromRegion(SZDFreeList *target, uint64_t zones);
 SZDStatus AllocZones(std::vector<std::pair<uint64_t, u_int64_t>> &zone_regions,
                      SZDFreeList **from, uint64_t requested_zones);
@@ -99,7 +99,6 @@ private:
   uint32_t max_write_depth_;
   uint64_t space_left_;
   uint64_t write_head_;
-  uint64_t zasl_;
   // channels used
   SZDChannel *write_channel_;
   SZDChannel *read_reset_channel_;
@@ -9,6 +9,7 @@
 #include "szd/szd.h"
 #include "szd/szd_status.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
@@ -21,11 +22,21 @@ namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
  */
 class SZDChannel {
 public:
+  // Buffers of the channel are allocated on NUMA node socket_id. Temporary
+  // DMA buffers come from dma_pool, the channel creates its own if none given.
+  // I/O bounces through a ring of queue_depth + 1 DMA buffers, allocated by
+  // the first I/O that bounces (see SetBounceRingSize), so channels that only
+  // use DMA memory pin none. With keep_async_buffer, writers without a slot in
+  // the ring keep the buffer they bounced through (grown as needed) until the
+  // channel is destroyed, instead of returning it to the DMA cache.
   SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
              uint64_t min_lba, uint64_t max_lba, bool keep_async_buffer = false,
-             uint32_t queue_depth = 1);
+             uint32_t queue_depth = 1, int32_t socket_id = SZD_SOCKET_ID_ANY,
+             DMAPool *dma_pool = nullptr);
   SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
-             bool keep_async_buffer = false, uint32_t queue_depth = 1);
+             bool keep_async_buffer = false, uint32_t queue_depth = 1,
+             int32_t socket_id = SZD_SOCKET_ID_ANY,
+             DMAPool *dma_pool = nullptr);
   // No copying or implicits
   SZDChannel(const SZDChannel &) = delete;
   SZDChannel &operator=(const SZDChannel &) = delete;
@@ -59,38 +70,101 @@ public:
   SZDStatus ReadIntoBuffer(uint64_t lba, SZDBuffer *buffer, size_t section_addr,
                            size_t section_size, bool alligned = true);
 
-  // Direct I/O Operations
+  // Direct I/O Operations. Memory from szd_calloc (or SZDBuffer) is submitted
+  // as is, other memory is copied through bounce buffers.
   SZDStatus DirectAppend(uint64_t *lba, void *buffer, const uint64_t size,
                          bool alligned = true);
   SZDStatus DirectRead(uint64_t lba, void *buffer, uint64_t size,
                        bool alligned = true);
+  // Appends the data of ranges (in lbas of this channel) to the zone at lba,
+  // in order. The data stays on the device if it supports NVMe Copy.
+  SZDStatus CopyRanges(const std::vector<CopyRange> &ranges, uint64_t *lba);
 
-  // Async I/O operations. Currently only supports Direct
-  // writes < ZASL to ONE zone at a time. WARNINGS:
-  //  1. next write operation should be a sync, as we can not write again till
-  //  synced.
-  //  2. writing more than 1 ZASL is undefined behaviour.
-  //  3. CHECK that the write does not cross zones, this will break.
+  // Async I/O operations. Currently only supports Direct I/O. WARNING: next
+  // write operation should be a sync, as we can not write again till synced.
+  // Each writer has a preallocated slot, a writer can only be used again after
+  // its request completed. No memory is allocated for requests, but the QPair
+  // can only have MAX_CALLBACK_REQUESTS in flight.
+  // Appends larger than ZASL or across zones are split in parts of at most
+  // ZASL in one zone. The first part uses writer, the others take free writers
+  // (waiting till enough are free), writer completes when all parts did. Can
+  // not be split in more parts than the queue depth. Parts in different zones
+  // are in flight together, parts in one zone one after the other: each is
+  // submitted by the completion of the previous one, so they land in order.
   SZDStatus AsyncAppend(uint64_t *lba, void *buffer, const uint64_t size,
                         uint32_t writer);
+  // Number of writers an AsyncAppend of size bytes at lba needs.
+  uint64_t AsyncAppendParts(uint64_t lba, uint64_t size);
+  // Reads at most MDTS from ONE zone into buffer, which must remain valid till
+  // the read completed. Readers share the slots (and numbers) of the writers.
+  // Memory from szd_calloc (or SZDBuffer) is read into as is, other memory is
+  // copied out of a bounce buffer when the read completes. A failed read is
+  // not copied and fails the next Sync, as failed appends do.
+  SZDStatus AsyncRead(uint64_t lba, void *buffer, uint64_t size,
+                      uint32_t reader, bool alligned = true);
   bool PollOnce(uint32_t writer);
-  // Pick any writer, if available
+  // Pick any writer, if available. O(1), only polls when all writers are busy.
   bool FindFreeWriter(uint32_t *any_writer);
+  // Waits for all requests. Fails if any request failed since the last Sync,
+  // also when its writer was already freed by PollOnce or FindFreeWriter.
   SZDStatus Sync();
   inline uint32_t GetQueueDepth() { return queue_depth_; }
   inline uint32_t GetOutstandingRequests() { return outstanding_requests_; }
+  // NUMA node the buffers of this channel live on, or SZD_SOCKET_ID_ANY.
+  inline int32_t GetSocketId() const { return socket_id_; }
+
+  // Number of appends/reads that are kept in flight by synchronous I/O (Flush,
+  // ReadIntoBuffer and Direct). 1 (default) means stop-and-wait for each
+  // ZASL/MDTS.
+  inline void SetPipelineDepth(uint32_t pipeline_depth) {
+    pipeline_depth_ = pipeline_depth == 0 ? 1
+                      : pipeline_depth > MAX_PIPELINE_DEPTH
+                          ? MAX_PIPELINE_DEPTH
+                          : pipeline_depth;
+  }
+  inline uint32_t GetPipelineDepth() const { return pipeline_depth_; }
+
+  // Number of bounce buffers in the ring, each holds one ZASL/MDTS. Slot i is
+  // used by writer i of the async I/O, synchronous I/O (Direct) uses the slots
+  // that are left over if they hold the whole pipeline depth. I/O that does
+  // not fit uses buffers of the DMA cache. The ring is allocated by the first
+  // I/O that bounces. Can only be changed without outstanding requests, which
+  // frees the ring, 0 bounces all I/O through the DMA cache.
+  SZDStatus SetBounceRingSize(uint32_t slots);
+  inline uint32_t GetBounceRingSize() const { return bounce_ring_size_; }
+
+  // How synchronous I/O waits on the device, spinning (default) has the lowest
+  // latency, but burns a core. See WaitPolicy.
+  inline void SetWaitPolicy(WaitPolicy policy) {
+    szd_set_wait_policy(qpair_, policy);
+  }
+  inline WaitPolicy GetWaitPolicy() const { return qpair_->wait_policy_; }
+  // CPU time saved and latency added by the wait policy.
+  inline WaitStats GetWaitStats() const { return qpair_->wait_stats_; }
 
   // Management of zones
   SZDStatus ResetZone(uint64_t slba);
+  // Resets all zones in [slba, eslba) with multiple resets in flight. On a
+  // partial failure, zone_status (one entry per zone) tells which zones reset.
+  SZDStatus ResetZones(uint64_t slba, uint64_t eslba,
+                       std::vector<SZDStatus> *zone_status = nullptr);
   SZDStatus ResetAllZones();
   SZDStatus ZoneHead(uint64_t slba, uint64_t *zone_head);
   SZDStatus ZoneHeads(uint64_t slba, uint64_t eslba,
                       std::vector<uint64_t> *zone_heads);
+  // Zone descriptors in lbas, wp of full zones is set to the end of the zone.
+  SZDStatus ZoneDescriptors(uint64_t slba, uint64_t eslba,
+                            std::vector<ZoneDescriptor> *descs);
   SZDStatus FinishZone(uint64_t slba);
 
-  // Used to aid with the fact that zonecap != zonesize
+  // Used to aid with the fact that zonecap != zonesize. Zones are placed back
+  // to back, each with its own capacity. O(1) if all zones have the same
+  // capacity, otherwise lba to pba is a binary search over zone_lbas_.
   uint64_t TranslateLbaToPba(uint64_t lba);
   uint64_t TranslatePbaToLba(uint64_t lba);
+  // Start and end (exclusive) of the zone that holds lba, both in lbas.
+  uint64_t ZoneStartLba(uint64_t lba);
+  uint64_t ZoneEndLba(uint64_t lba);
 
   // diagnostics counters (will return empty values when disabled)
   uint64_t GetBytesWritten() const;
@@ -104,6 +178,73 @@ public:
   std::vector<uint64_t> GetAppendOperations() const;
 
 private:
+  // Capacity of the zone that holds pba.
+  inline uint64_t ZoneCapAt(uint64_t pba) const {
+    if (szd_likely(zone_lbas_.empty()) || pba < min_lba_ || pba >= max_lba_) {
+      return zone_cap_;
+    }
+    uint64_t zone = (pba - min_lba_) / zone_size_;
+    return zone_lbas_[zone + 1] - zone_lbas_[zone];
+  }
+  // Number of zone borders crossed when processing lbas from zone slba.
+  uint64_t ZonesTraversed(uint64_t slba, uint64_t lbas) const;
+  // Bounce buffers, writers use the first slots of the ring.
+  inline uint32_t AsyncBounceSlots() const {
+    return bounce_ring_ == nullptr ? 0
+                                   : std::min(queue_depth_, bounce_ring_size_);
+  }
+  inline bool InBounceRing(const void *buffer) const {
+    return bounce_ring_ != nullptr && buffer >= bounce_ring_ &&
+           buffer < bounce_ring_ + bounce_ring_size_ * bounce_slot_size_;
+  }
+  // Allocates the ring if it is not yet, false if there is none.
+  bool AllocBounceRing();
+  // Bounce buffer for synchronous I/O of at most *size bytes, *size is set to
+  // the size that can be used.
+  void *GetSyncBounce(uint64_t *size);
+  void PutSyncBounce(void *buffer, uint64_t size);
+  // Bounce buffer of writer for a request of size bytes.
+  void *GetAsyncBounce(uint32_t writer, uint64_t size);
+  // Returns the buffer of writer after its request completed.
+  void PutAsyncBounce(uint32_t writer);
+  // Direct I/O of memory the device can DMA to, only the tail that is not a
+  // whole lba bounces (through backed_memory_spill_).
+  SZDStatus DirectAppendZeroCopy(uint64_t *pba, void *buffer, uint64_t size);
+  SZDStatus DirectReadZeroCopy(uint64_t pba, void *buffer, uint64_t size);
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+  // Each zone touched by appending lbas from pba costs one append for each
+  // (partial) ZASL.
+  void CountZoneAppends(uint64_t pba, uint64_t lbas);
+#endif
+  // Request of one writer, each on its own cache line as the device completes
+  // them independently.
+  struct alignas(64) AsyncSlot {
+    Completion completion;
+    SZDChannel *channel;
+    // Where a bounced read is copied to, nullptr for appends.
+    void *read_buffer;
+    uint64_t read_size;
+    // Where the request should land, a part placed elsewhere was reordered.
+    uint64_t lba;
+    // Bytes of a part of a split append.
+    uint64_t size;
+    uint32_t writer;
+    // Writer of the first part of a split append, completes after all parts.
+    uint32_t owner;
+    // Writer of the next part in the same zone, submitted when this part
+    // completes. UINT32_MAX if there is none.
+    uint32_t next;
+    uint32_t parts_left;
+    bool busy;
+    bool bounced;
+  };
+  // Called by a poll of the QPair when the request of a slot is done.
+  static void AsyncComplete(void *cb_arg, uint16_t err, uint64_t lba);
+  // Free writers are kept on a stack, a writer that is picked by the user is
+  // swapped with the top, so claiming and releasing are both O(1).
+  void ClaimWriter(uint32_t writer);
+  void ReleaseWriter(uint32_t writer);
+
   QPair *qpair_;
   uint64_t lba_size_;
   uint64_t zasl_;
@@ -113,15 +254,29 @@ private:
   uint64_t min_lba_;
   uint64_t max_lba_;
   bool can_access_all_;
+  // Start in lbas of each zone in [min_lba_, max_lba_) and the end of the last
+  // one. Only used when zone capacities differ, empty otherwise.
+  std::vector<uint64_t> zone_lbas_;
   void *backed_memory_spill_;
   uint64_t lba_msb_;
   // async IO
   uint32_t queue_depth_;
   uint32_t outstanding_requests_;
-  Completion **completion_;
+  AsyncSlot *async_slots_;
+  uint32_t *free_writers_;
+  uint32_t *free_writer_pos_;
+  uint32_t free_writers_count_;
+  // Error of a failed request since the last Sync, 0 if none failed.
+  uint16_t async_err_;
   void **async_buffer_;
   bool keep_async_buffer_;
   size_t *async_buffer_size_;
+  uint32_t pipeline_depth_;
+  int32_t socket_id_;
+  DMACache *dma_cache_;
+  char *bounce_ring_;
+  uint64_t bounce_slot_size_;
+  uint32_t bounce_ring_size_;
   // diagnostics counters
 #ifdef SZD_PERF_COUNTERS
   std::atomic<uint64_t> bytes_written_;
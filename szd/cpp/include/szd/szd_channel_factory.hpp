@@ -9,7 +9,18 @@
 #include "szd/szd_channel.hpp"
 #include "szd/szd_status.hpp"
 
+#include <map>
+
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
+/**
+ * @brief NUMA node the buffers of new channels are allocated on.
+ */
+enum class SZDPlacement {
+  Any,    /**< Leave it to SPDK.*/
+  Device, /**< Node of the controller, DMA does not cross nodes.*/
+  Caller  /**< Node of the thread that registers the channel.*/
+};
+
 /**
  * @brief Simple class meant to ensure that SZD channels are created at one
  * point. Allowing limiting the amount of channels and abstracting away
@@ -17,7 +28,8 @@ namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
  */
 class SZDChannelFactory {
 public:
-  SZDChannelFactory(DeviceManager *device_manager, size_t max_channel_count);
+  SZDChannelFactory(DeviceManager *device_manager, size_t max_channel_count,
+                    SZDPlacement placement = SZDPlacement::Any);
   ~SZDChannelFactory();
   // No copying or implicits
   SZDChannelFactory(const SZDChannelFactory &) = delete;
@@ -31,21 +43,39 @@ public:
   }
   inline size_t Getref() { return refs_; }
 
-  SZDStatus register_raw_qpair(QPair **qpair);
+  SZDStatus
+  register_raw_qpair(QPair **qpair,
+                     const QPairOptions &qpair_options = QPairOptions_default);
   SZDStatus unregister_raw_qpair(QPair *qpair);
-  SZDStatus register_channel(SZDChannel **channel,
-                             bool preserve_async_buffer = false,
-                             uint32_t channel_depth = 1);
-  SZDStatus register_channel(SZDChannel **channel, uint64_t min_zone_nr,
-                             uint64_t max_zone_nr,
-                             bool preserve_async_buffer = false,
-                             uint32_t channel_depth = 1);
+  // channel_depth can not exceed the io_queue_requests of the QPair.
+  SZDStatus
+  register_channel(SZDChannel **channel, bool preserve_async_buffer = false,
+                   uint32_t channel_depth = 1,
+                   const QPairOptions &qpair_options = QPairOptions_default);
+  SZDStatus
+  register_channel(SZDChannel **channel, uint64_t min_zone_nr,
+                   uint64_t max_zone_nr, bool preserve_async_buffer = false,
+                   uint32_t channel_depth = 1,
+                   const QPairOptions &qpair_options = QPairOptions_default);
   SZDStatus unregister_channel(SZDChannel *channel);
 
+  // Start of zone zone_nr in the lbas used by channels (zones back to back,
+  // each with its own capacity).
+  uint64_t TranslateZoneToLba(uint64_t zone_nr) const;
+
+  inline SZDPlacement GetPlacement() const { return placement_; }
+
 private:
+  // NUMA node for the next channel according to placement_.
+  int32_t PlacementSocketId() const;
+  // DMA pool shared by all channels on NUMA node socket_id, nullptr on OOM.
+  DMAPool *DMAPoolOf(int32_t socket_id);
+
   size_t max_channel_count_;
   size_t channel_count_;
   DeviceManager *device_manager_;
+  SZDPlacement placement_;
+  std::map<int32_t, DMAPool *> dma_pools_;
   size_t refs_;
 };
 } // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
@@ -26,12 +26,41 @@ public:
   SZDDevice(const SZDDevice &) = delete;
   SZDDevice &operator=(const SZDDevice &) = delete;
   ~SZDDevice();
-  SZDStatus Init();
+  // emulated sets SPDK up for emulated devices only (see OpenEmulated).
+  SZDStatus Init(bool emulated = false);
+  // Also sets up the bdevs of the SPDK JSON config bdev_config (see OpenBdev).
+  SZDStatus Init(bool emulated, const std::string &bdev_config);
   SZDStatus Reinit();
+  // Devices stay attached until the next Probe or Open of a device that was not
+  // probed, which detach them and Reinit. Open of a probed device does not
+  // probe again. Not allowed while a device is open.
   SZDStatus Probe(std::vector<DeviceOpenInfo> &info);
   SZDStatus Open(const std::string &device_name, uint64_t min_zone,
                  uint64_t max_zone);
   SZDStatus Open(const std::string &device_name);
+  // device_name can also be a transport ID, such as one of NVMe-oF (see
+  // szd_open_transport).
+  SZDStatus Open(const std::string &device_name, uint64_t min_zone,
+                 uint64_t max_zone, const TransportOptions &transport_options);
+  // Opens all devices as one device group, zones are interleaved across the
+  // devices (see szd_open_group). min_zone and max_zone are zones of the group.
+  SZDStatus OpenGroup(const std::vector<std::string> &device_names,
+                      uint64_t min_zone, uint64_t max_zone);
+  SZDStatus OpenGroup(const std::vector<std::string> &device_names);
+  // Opens a zoned namespace that is emulated in memory or in a file instead of
+  // an SSD (see szd_open_emu).
+  SZDStatus OpenEmulated(const EmuOptions &emu_options, uint64_t min_zone,
+                         uint64_t max_zone);
+  SZDStatus OpenEmulated(const EmuOptions &emu_options);
+  // Opens a device group of emulated devices, one for each options (see
+  // szd_open_group_emu).
+  SZDStatus OpenGroupEmulated(const std::vector<EmuOptions> &emu_options,
+                              uint64_t min_zone, uint64_t max_zone);
+  // Opens a zoned SPDK bdev created by the bdev_config of Init (see
+  // szd_open_bdev).
+  SZDStatus OpenBdev(const std::string &bdev_name, uint64_t min_zone,
+                     uint64_t max_zone);
+  SZDStatus OpenBdev(const std::string &bdev_name);
   SZDStatus Close();
   SZDStatus GetInfo(DeviceInfo *info) const;
   SZDStatus Destroy();
@@ -41,12 +70,19 @@ public:
   }
 
 private:
+  // Detaches the devices Probe left attached.
+  void ReleaseProbed();
+  SZDStatus ReleaseProbedAndReinit();
+
   const std::string application_name_;
   // state
   bool initialised_device_;
   bool device_opened_;
   SZD::DeviceManager **manager_;
   std::string opened_device_;
+  std::vector<std::string> opened_group_;
+  std::string bdev_config_;
+  ProbeInformation *probed_;
 };
 
 } // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
@@ -8,12 +8,14 @@
 
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 
-SZDBuffer::SZDBuffer(size_t size, uint64_t lba_size)
-    : lba_size_(lba_size), backed_memory_(nullptr), backed_memory_size_(size) {
+SZDBuffer::SZDBuffer(size_t size, uint64_t lba_size, int32_t socket_id)
+    : lba_size_(lba_size), backed_memory_(nullptr), backed_memory_size_(size),
+      socket_id_(socket_id) {
   backed_memory_size_ =
       ((backed_memory_size_ + lba_size_ - 1) / lba_size_) * lba_size_;
   if (backed_memory_size_ != 0) {
-    backed_memory_ = szd_calloc(lba_size_, 1, backed_memory_size_);
+    backed_memory_ =
+        szd_calloc_socket(lba_size_, 1, backed_memory_size_, socket_id_);
   }
   // idle state (can also be because of bad malloc!)
   if (backed_memory_ == nullptr) {
@@ -81,7 +83,8 @@ SZDStatus SZDBuffer::ReallocBuffer(uint64_t size) {
       return s;
     }
   }
-  backed_memory_ = szd_calloc(lba_size_, alligned_size, sizeof(char));
+  backed_memory_ =
+      szd_calloc_socket(lba_size_, alligned_size, sizeof(char), socket_id_);
   if (szd_unlikely(backed_memory_ == nullptr)) {
     backed_memory_size_ = 0;
     SZD_LOG_ERROR("SZD: Buffer: ReallocBuffer: Failed allocating memory\n");
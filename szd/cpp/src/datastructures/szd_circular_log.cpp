@@ -12,13 +12,16 @@ SZDCircularLog::SZDCircularLog(SZDChannelFactory *channel_factory,
                                const uint8_t number_of_readers)
     : SZDLog(channel_factory, info, min_zone_nr, max_zone_nr),
       number_of_readers_(number_of_readers), write_head_(min_zone_head_),
-      write_tail_(min_zone_head_), zone_tail_(min_zone_nr * info.zone_cap),
-      space_left_((max_zone_nr - min_zone_nr) * info.zone_cap * info.lba_size) {
+      write_tail_(min_zone_head_), zone_tail_(min_zone_head_),
+      space_left_((max_zone_head_ - min_zone_head_) * info.lba_size) {
   channel_factory_->Ref();
   read_channel_ = new SZD::SZDChannel *[number_of_readers_];
   for (uint8_t i = 0; i < number_of_readers_; i++) {
     channel_factory_->register_channel(&read_channel_[i], min_zone_nr,
                                        max_zone_nr);
+    if (read_channel_[i] != nullptr) {
+      read_channel_[i]->SetPipelineDepth(DEFAULT_PIPELINE_DEPTH);
+    }
   }
   channel_factory_->register_channel(&write_channel_, min_zone_nr, max_zone_nr);
   channel_factory_->register_channel(&reset_channel_, min_zone_nr, max_zone_nr);
@@ -342,15 +345,28 @@ SZDStatus SZDCircularLog::ConsumeTail(uint64_t begin_lba, uint64_t end_lba) {
 
   // Reset zones.
   write_tail_snapshot = end_lba;
-  uint64_t cur_zone = (write_tail_snapshot / zone_cap_) * zone_cap_;
+  uint64_t cur_zone = reset_channel_->ZoneStartLba(write_tail_snapshot);
   SZDStatus s;
-  for (uint64_t slba = zone_tail_; slba != cur_zone; slba += zone_cap_) {
-    if ((s = reset_channel_->ResetZone(slba)) != SZDStatus::Success) {
-      SZD_LOG_ERROR("SZD: Circular log: Consume tail: Failed resetting zone\n");
-      return s;
+  std::vector<SZDStatus> zone_status;
+  if ((s = reset_channel_->ResetZones(zone_tail_, cur_zone, &zone_status)) !=
+      SZDStatus::Success) {
+    SZD_LOG_ERROR("SZD: Circular log: Consume tail: Failed resetting zone\n");
+    // The tail can only move over the zones before the first failed reset,
+    // the zones after it are reset again by the next consume.
+    uint64_t zones_reset = 0;
+    while (zones_reset < zone_status.size() &&
+           zone_status[zones_reset] == SZDStatus::Success) {
+      zones_reset++;
     }
-    space_left_ += zone_cap_ * lba_size_;
+    if (zones_reset > 0) {
+      uint64_t reset_end = zone_tail_ + zones_reset * zone_size_;
+      space_left_ += (reset_end - zone_tail_) * lba_size_;
+      zone_tail_ = reset_end;
+      write_tail_ = reset_end; // atomic write
+    }
+    return s;
   }
+  space_left_ += (cur_zone - zone_tail_) * lba_size_;
   zone_tail_ = cur_zone;
 
   // Wraparound of the actual tail.
@@ -364,16 +380,12 @@ SZDStatus SZDCircularLog::ConsumeTail(uint64_t begin_lba, uint64_t end_lba) {
 SZDStatus SZDCircularLog::ResetAll() {
   SZDStatus s;
   // We never own all zones for a circular log (I hope), therefore we need
-  // individual resetting.
-  for (uint64_t slba = min_zone_head_; slba < max_zone_head_;
-       slba += zone_cap_) {
-    s = reset_channel_->ResetZone(slba);
-    if (s != SZDStatus::Success) {
-      SZD_LOG_ERROR("SZD: Circular log: Reset all failed\n");
-      return s;
-    }
+  // individual (batched) resetting.
+  s = reset_channel_->ResetZones(min_zone_head_, max_zone_head_);
+  if (s != SZDStatus::Success) {
+    SZD_LOG_ERROR("SZD: Circular log: Reset all failed\n");
+    return s;
   }
-  s = SZDStatus::Success;
   // Clean state
   write_head_ = zone_tail_ = write_tail_ = min_zone_head_;
   space_left_ = (max_zone_head_ - min_zone_head_) * lba_size_;
@@ -398,58 +410,67 @@ void SZDCircularLog::RecalculateSpaceLeft() {
 SZDStatus SZDCircularLog::RecoverPointers() {
   SZDStatus s;
 
-  // Retrieve zone heads from the device
-  std::vector<uint64_t> zone_heads;
-  s = reset_channel_->ZoneHeads(min_zone_head_, max_zone_head_ - zone_cap_, &zone_heads);
+  // Retrieve zone descriptors from the device
+  std::vector<ZoneDescriptor> descs;
+  s = reset_channel_->ZoneDescriptors(
+      min_zone_head_, reset_channel_->ZoneStartLba(max_zone_head_ - 1), &descs);
   if (szd_unlikely(s != SZDStatus::Success)) {
-    SZD_LOG_ERROR("SZD: Once log: Recover pointers\n");
+    SZD_LOG_ERROR("SZD: Circular log: Recover pointers\n");
     return s;
   }
-  if (zone_heads.size() !=
-      ((max_zone_head_ - min_zone_head_ - zone_cap_) / zone_cap_) + 1) {
-    SZD_LOG_ERROR("SZD: Once log: ZoneHeads did not return all heads\n");
+  if (descs.size() != (reset_channel_->TranslateLbaToPba(max_zone_head_) -
+                       reset_channel_->TranslateLbaToPba(min_zone_head_)) /
+                          zone_size_) {
+    SZD_LOG_ERROR(
+        "SZD: Circular log: ZoneDescriptors did not return all zones\n");
     return SZDStatus::Unknown;
   }
+  auto is_empty = [](const ZoneDescriptor &desc) {
+    return desc.state == SZD_ZONE_EMPTY;
+  };
+  auto is_partial = [](const ZoneDescriptor &desc) {
+    return desc.state == SZD_ZONE_IMPLICIT_OPEN ||
+           desc.state == SZD_ZONE_EXPLICIT_OPEN ||
+           desc.state == SZD_ZONE_CLOSED;
+  };
 
   uint64_t log_tail = min_zone_head_, log_head = min_zone_head_;
-  // Scan for tail
-  uint64_t slba;
-  uint64_t zone_head = min_zone_head_, old_zone_head = min_zone_head_;
-  for (slba = min_zone_head_; slba < max_zone_head_; slba += zone_cap_) {
-    zone_head = zone_heads[(slba - min_zone_head_) / zone_cap_];
-    old_zone_head = zone_head;
+  // Scan for tail (zones can differ in capacity, so walk the descriptors)
+  size_t zone;
+  const ZoneDescriptor *prev_desc = &descs[0];
+  for (zone = 0; zone < descs.size(); zone++) {
+    const ZoneDescriptor &desc = descs[zone];
+    prev_desc = &desc;
     // tail is at first zone that is not empty
-    if (zone_head > slba) {
-      log_tail = slba;
+    if (!is_empty(desc)) {
+      log_tail = desc.zslba;
       // Head might be here if exactly 1 zone is filled...
-      log_head = zone_head;
+      log_head = desc.wp;
       break;
     }
   }
   // Scan for head
-  for (; slba < max_zone_head_; slba += zone_cap_) {
-    zone_head = zone_heads[(slba - min_zone_head_) / zone_cap_];
-    // The first zone with a head more than 0 and less than max_zone, holds the
-    // head of the manifest.
-    if (zone_head > slba && zone_head < slba + zone_cap_) {
-      log_head = zone_head;
+  for (; zone < descs.size(); zone++) {
+    const ZoneDescriptor &desc = descs[zone];
+    // The first zone that is partially filled, holds the head of the log.
+    if (is_partial(desc)) {
+      log_head = desc.wp;
       break;
     }
-    // Or the last zone that is completely filled.
-    if (zone_head < slba + zone_cap_ && slba > zone_cap_ &&
-        old_zone_head > slba - zone_cap_) {
-      log_head = slba;
+    // Or the zone after the last zone that is completely filled.
+    if (desc.state != SZD_ZONE_FULL && desc.zslba > zone_cap_ &&
+        !is_empty(*prev_desc)) {
+      log_head = desc.zslba;
       break;
     }
-    old_zone_head = zone_head;
+    prev_desc = &desc;
   }
   // if head < end and tail == 0, we need to be sure that the tail does not
   // start AFTER head.
   if (log_head > min_zone_head_ && log_tail == min_zone_head_) {
-    for (slba += zone_cap_; slba < max_zone_head_; slba += zone_cap_) {
-      zone_head = zone_heads[(slba - min_zone_head_) / zone_cap_];
-      if (zone_head > slba) {
-        log_tail = slba;
+    for (zone++; zone < descs.size(); zone++) {
+      if (!is_empty(descs[zone])) {
+        log_tail = descs[zone].zslba;
         break;
       }
     }
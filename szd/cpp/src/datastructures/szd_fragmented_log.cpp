@@ -2,6 +2,7 @@
 #include "szd/szd.h"
 #include "szd/szd_channel_factory.hpp"
 
+#include <algorithm>
 #include <mutex>
 
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
@@ -11,10 +12,11 @@ SZDFragmentedLog::SZDFragmentedLog(SZDChannelFactory *channel_factory,
                                    const uint64_t max_zone_nr,
                                    const uint8_t number_of_readers,
                                    const uint8_t number_of_writers)
-    : min_zone_head_(min_zone_nr * info.zone_cap),
-      max_zone_head_(max_zone_nr * info.zone_cap), zone_size_(info.zone_size),
-      zone_cap_(info.zone_cap), lba_size_(info.lba_size), zasl_(info.zasl),
-      zone_bytes_(info.zone_cap * info.lba_size),
+    : min_zone_nr_(min_zone_nr), max_zone_nr_(max_zone_nr),
+      min_zone_head_(channel_factory->TranslateZoneToLba(min_zone_nr)),
+      max_zone_head_(channel_factory->TranslateZoneToLba(max_zone_nr)),
+      zone_size_(info.zone_size), lba_size_(info.lba_size), zasl_(info.zasl),
+      zone_cap_(info.zone_cap), zone_bytes_(info.zone_cap * info.lba_size),
       number_of_readers_(number_of_readers),
       number_of_writers_(number_of_writers), freelist_(nullptr),
       seeker_(nullptr), zones_left_(max_zone_nr - min_zone_nr),
@@ -23,10 +25,19 @@ SZDFragmentedLog::SZDFragmentedLog(SZDChannelFactory *channel_factory,
   SZDFreeListFunctions::Init(&freelist_, min_zone_nr, max_zone_nr);
   seeker_ = freelist_;
   channel_factory_->Ref();
+  for (uint64_t zone = min_zone_nr; zone < max_zone_nr; zone++) {
+    zone_cap_ = std::min(zone_cap_,
+                         channel_factory_->TranslateZoneToLba(zone + 1) -
+                             channel_factory_->TranslateZoneToLba(zone));
+  }
+  zone_bytes_ = zone_cap_ * lba_size_;
   read_channel_ = new SZD::SZDChannel *[number_of_readers_];
   for (uint8_t i = 0; i < number_of_readers_; i++) {
     channel_factory_->register_channel(&read_channel_[i], min_zone_nr,
                                        max_zone_nr);
+    if (read_channel_[i] != nullptr) {
+      read_channel_[i]->SetPipelineDepth(DEFAULT_PIPELINE_DEPTH);
+    }
   }
   write_channel_ = new SZD::SZDChannel *[number_of_writers_];
   for (uint8_t i = 0; i < number_of_writers_; i++) {
@@ -111,8 +122,11 @@ SZDFragmentedLog::Append(const char *buffer, size_t size,
   bool write_alligned = true;
 
   for (auto region : regions) {
-    slba = region.first * zone_cap_;
-    bytes_to_write = region.second * zone_cap_ * lba_size_;
+    slba = channel_factory_->TranslateZoneToLba(region.first);
+    bytes_to_write =
+        (channel_factory_->TranslateZoneToLba(region.first + region.second) -
+         slba) *
+        lba_size_;
     if (bytes_to_write > size - offset) {
       bytes_to_write = size - offset;
       write_alligned = alligned;
@@ -127,8 +141,9 @@ SZDFragmentedLog::Append(const char *buffer, size_t size,
   }
 
   // Ensure that resources are released
-  if ((slba / zone_cap_) * zone_cap_ != slba) {
-    s = write_channel_[writer]->FinishZone((slba / zone_cap_) * zone_cap_);
+  uint64_t zone_start = write_channel_[writer]->ZoneStartLba(slba);
+  if (zone_start != slba) {
+    s = write_channel_[writer]->FinishZone(zone_start);
     if (s != SZDStatus::Success) {
       SZD_LOG_ERROR("SZD: Fragmented log: Append: Failed to finish zone\n");
     }
@@ -186,8 +201,11 @@ SZDFragmentedLog::Append(const SZDBuffer &buffer, size_t addr, size_t size,
   uint64_t slba;
   bool write_alligned = true;
   for (auto region : regions) {
-    slba = region.first * zone_cap_;
-    bytes_to_write = region.second * zone_cap_;
+    slba = channel_factory_->TranslateZoneToLba(region.first);
+    bytes_to_write =
+        (channel_factory_->TranslateZoneToLba(region.first + region.second) -
+         slba) *
+        lba_size_;
     if (bytes_to_write > size - offset) {
       bytes_to_write = size - offset;
       write_alligned = alligned;
@@ -203,8 +221,9 @@ SZDFragmentedLog::Append(const SZDBuffer &buffer, size_t addr, size_t size,
   }
 
   // Ensure that resources are released
-  if ((slba / zone_size_) * zone_size_ != slba) {
-    s = write_channel_[writer]->FinishZone((slba / zone_size_) * zone_size_);
+  uint64_t zone_start = write_channel_[writer]->ZoneStartLba(slba);
+  if (zone_start != slba) {
+    s = write_channel_[writer]->FinishZone(zone_start);
   }
   return s;
 }
@@ -221,14 +240,19 @@ SZDStatus SZDFragmentedLog::Read(
   bool alligned_read = true;
   uint64_t size_to_read = 0;
   for (auto region : regions) {
-    if (size - read < region.second * zone_cap_ * lba_size_) {
+    uint64_t slba = channel_factory_->TranslateZoneToLba(region.first);
+    uint64_t region_size =
+        (channel_factory_->TranslateZoneToLba(region.first + region.second) -
+         slba) *
+        lba_size_;
+    if (size - read < region_size) {
       size_to_read = size - read;
       alligned_read = alligned;
     } else {
-      size_to_read = region.second * zone_cap_ * lba_size_;
+      size_to_read = region_size;
     }
-    s = read_channel_[reader]->DirectRead(region.first * zone_cap_, data + read,
-                                          size_to_read, alligned_read);
+    s = read_channel_[reader]->DirectRead(slba, data + read, size_to_read,
+                                          alligned_read);
     if (szd_unlikely(s != SZDStatus::Success)) {
       SZD_LOG_ERROR("SZD: Fragmented log: Read: Failed reading from storage\n");
       return s;
@@ -248,17 +272,18 @@ SZDFragmentedLog::Reset(std::vector<std::pair<uint64_t, uint64_t>> &regions,
   SZDStatus s = SZDStatus::Success;
   // Erase data
   for (auto region : regions) {
-    uint64_t begin = region.first * zone_cap_;
-    uint64_t end = begin + region.second * zone_cap_;
-    for (uint64_t slba = begin; slba < end; slba += zone_cap_) {
-      s = write_channel_[writer]->ResetZone(slba);
-      if (szd_unlikely(s != SZDStatus::Success)) {
-        SZD_LOG_ERROR(
-            "SZD: Fragmented log: Reset: Could not reset zone at %lu\n", slba);
-        return s;
-      }
-      zones_left_++;
+    uint64_t begin = channel_factory_->TranslateZoneToLba(region.first);
+    uint64_t end =
+        channel_factory_->TranslateZoneToLba(region.first + region.second);
+    std::vector<SZDStatus> zone_status;
+    s = write_channel_[writer]->ResetZones(begin, end, &zone_status);
+    if (szd_unlikely(s != SZDStatus::Success)) {
+      SZD_LOG_ERROR(
+          "SZD: Fragmented log: Reset: Could not reset zones at %lu\n", begin);
+      FreeResetZones(region.first, zone_status);
+      return s;
     }
+    zones_left_ += region.second;
     SZDFreeList *to_delete;
     if (number_of_writers_ > 1) {
       mut_.lock();
@@ -272,29 +297,57 @@ SZDFragmentedLog::Reset(std::vector<std::pair<uint64_t, uint64_t>> &regions,
   return s;
 }
 
+void SZDFragmentedLog::FreeResetZones(
+    uint64_t begin_zone, const std::vector<SZDStatus> &zone_status) {
+  if (number_of_writers_ > 1) {
+    mut_.lock();
+  }
+  SZDFreeList *run;
+  if (SZDFreeListFunctions::FindRegion(begin_zone, seeker_, &run) ==
+      SZDStatus::Success) {
+    // Split the region in runs of equal status and free the runs that reset.
+    uint64_t zone = 0;
+    while (zone < zone_status.size()) {
+      bool reset = zone_status[zone] == SZDStatus::Success;
+      uint64_t run_length = 1;
+      while (zone + run_length < zone_status.size() &&
+             (zone_status[zone + run_length] == SZDStatus::Success) == reset) {
+        run_length++;
+      }
+      SZDFreeListFunctions::SplitRegion(run, run_length);
+      SZDFreeList *next = SZDFreeListFunctions::NextZoneRegion(run);
+      if (reset) {
+        SZDFreeListFunctions::FreeZones(run, &seeker_);
+        zones_left_ += run_length;
+      }
+      run = next;
+      zone += run_length;
+    }
+  }
+  if (number_of_writers_ > 1) {
+    mut_.unlock();
+  }
+}
+
 SZDStatus SZDFragmentedLog::ResetAll(uint8_t writer) {
   if (szd_unlikely(writer > number_of_writers_)) {
     SZD_LOG_ERROR("SZD: Fragmented log: ResetAll: Not a valid writer\n");
     return SZDStatus::InvalidArguments;
   }
   SZDStatus s = SZDStatus::Success;
-  for (uint64_t slba = min_zone_head_; slba != max_zone_head_;
-       slba += zone_cap_) {
-    s = write_channel_[writer]->ResetZone(slba);
-    if (szd_unlikely(s != SZDStatus::Success)) {
-      SZD_LOG_ERROR("SZD: Fragmented log: ResetAll: Could not reset zone\n");
-      return s;
-    }
+  s = write_channel_[writer]->ResetZones(min_zone_head_, max_zone_head_);
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Fragmented log: ResetAll: Could not reset zone\n");
+    return s;
   }
   // Reset list
   if (number_of_writers_ > 1) {
     mut_.lock();
   }
   SZDFreeListFunctions::Destroy(seeker_);
-  SZDFreeListFunctions::Init(&freelist_, min_zone_head_ / zone_cap_,
-                             max_zone_head_ / zone_cap_);
+  SZDFreeListFunctions::Init(&freelist_, min_zone_nr_, max_zone_nr_);
   seeker_ = freelist_;
-  zones_left_ = (max_zone_head_ - min_zone_head_) / zone_cap_;
+  zones_left_ = max_zone_nr_ - min_zone_nr_;
   if (number_of_writers_ > 1) {
     mut_.unlock();
   }
@@ -304,7 +357,7 @@ SZDStatus SZDFragmentedLog::ResetAll(uint8_t writer) {
 SZDStatus SZDFragmentedLog::Recover() { return SZDStatus::Success; }
 
 bool SZDFragmentedLog::Empty() const {
-  return zones_left_ == (max_zone_head_ - min_zone_head_) / zone_cap_;
+  return zones_left_ == max_zone_nr_ - min_zone_nr_;
 }
 
 uint64_t SZDFragmentedLog::SpaceAvailable() const {
@@ -88,29 +88,33 @@ void FreeZones(SZDFreeList *target, SZDFreeList **orig) {
   }
 }
 
+void SplitRegion(SZDFreeList *target, uint64_t zones) {
+  if (target->zones_ <= zones) {
+    return;
+  }
+  // New next
+  SZDFreeList *next = new SZDFreeList();
+  next->used_ = target->used_;
+  next->begin_zone_ = target->begin_zone_ + zones;
+  next->zones_ = target->zones_ - zones;
+  next->prev_ = target;
+  // Change pointers
+  if (target->next_ != nullptr) {
+    target->next_->prev_ = next;
+    next->next_ = target->next_;
+  }
+  target->next_ = next;
+  // Alter current
+  target->zones_ = zones;
+}
+
 void AllocZonesFromRegion(SZDFreeList *target, uint64_t zones) {
   if (szd_unlikely(target->used_ || target->zones_ < zones)) {
     // Should not happen obviously
     SZD_LOG_ERROR("SZD: Freezone: double alloc\n");
     return;
   }
-  // Split
-  if (target->zones_ > zones) {
-    // New next
-    SZDFreeList *next = new SZDFreeList();
-    next->used_ = false;
-    next->begin_zone_ = target->begin_zone_ + zones;
-    next->zones_ = target->zones_ - zones;
-    next->prev_ = target;
-    // Change pointers
-    if (target->next_ != nullptr) {
-      target->next_->prev_ = next;
-      next->next_ = target->next_;
-    }
-    target->next_ = next;
-    // Alter current
-    target->zones_ = zones;
-  }
+  SplitRegion(target, zones);
   target->used_ = true;
 }
 
@@ -5,10 +5,10 @@
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 SZDLog::SZDLog(SZDChannelFactory *channel_factory, const DeviceInfo &info,
                const uint64_t min_zone_nr, const uint64_t max_zone_nr)
-    : min_zone_head_(std::max(min_zone_nr * info.zone_cap,
-                              (info.min_lba / info.zone_size) * info.zone_cap)),
-      max_zone_head_(std::min(max_zone_nr * info.zone_cap,
-                              (info.max_lba / info.zone_size) * info.zone_cap)),
+    : min_zone_head_(channel_factory->TranslateZoneToLba(
+          std::max(min_zone_nr, info.min_lba / info.zone_size))),
+      max_zone_head_(channel_factory->TranslateZoneToLba(
+          std::min(max_zone_nr, info.max_lba / info.zone_size))),
       zone_size_(info.zone_size), zone_cap_(info.zone_cap),
       lba_size_(info.lba_size), channel_factory_(channel_factory) {}
 } // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
@@ -11,9 +11,9 @@ SZDOnceLog::SZDOnceLog(SZDChannelFactory *channel_factory,
                        const uint64_t max_zone_nr,
                        const queue_depth_or_external_channel channel_definition)
     : SZDLog(channel_factory, info, min_zone_nr, max_zone_nr),
-      block_range_((max_zone_nr - min_zone_nr) * info.zone_cap),
+      block_range_(max_zone_head_ - min_zone_head_),
       space_left_(block_range_ * info.lba_size), write_head_(0),
-      zasl_(info.zasl), write_channels_owned_(false) {
+      write_channels_owned_(false) {
   write_head_ = min_zone_head_;
   channel_factory_->Ref();
   if (std::holds_alternative<SZDChannel *>(channel_definition)) {
@@ -43,6 +43,10 @@ SZDOnceLog::SZDOnceLog(SZDChannelFactory *channel_factory,
 #endif
   channel_factory_->register_channel(&read_reset_channel_, min_zone_nr,
                                      max_zone_nr);
+  // Reads are often large (ReadAll), keep multiple in flight.
+  if (read_reset_channel_ != nullptr) {
+    read_reset_channel_->SetPipelineDepth(DEFAULT_PIPELINE_DEPTH);
+  }
 }
 
 SZDOnceLog::~SZDOnceLog() {
@@ -135,12 +139,13 @@ SZDStatus SZDOnceLog::AsyncAppend(const char *data, const size_t size,
     SZD_LOG_ERROR("SZD: Once log: Async Append: No space left\n");
     return SZDStatus::IOError;
   }
-  uint64_t zone_end = (write_head_ / zone_cap_) * zone_cap_ + zone_cap_;
-  // Check if possible to even do async
+  // Check if possible to even do async, the channel splits writes larger than
+  // ZASL or across zones over multiple writers.
   uint64_t alligned_size = write_channel_->allign_size(size);
   uint64_t blocks_needed = alligned_size / lba_size_;
-  bool can_do_async = blocks_needed <= zasl_ / lba_size_ &&
-                      write_head_ + blocks_needed < zone_end;
+  bool can_do_async =
+      write_channel_->AsyncAppendParts(write_head_, alligned_size) <=
+      max_write_depth_;
   // We need to sync all previous writes first, then do a direct append
   // Try to claim a channel
   uint32_t claimed_nr = 0;
@@ -234,16 +239,16 @@ SZDStatus SZDOnceLog::ReadAll(std::string &out) {
 }
 
 SZDStatus SZDOnceLog::ResetAll() {
-  SZDStatus s;
-  for (uint64_t slba = min_zone_head_;
-       slba < max_zone_head_ && slba < write_head_; slba += zone_cap_) {
-    s = read_reset_channel_->ResetZone(slba);
-    if (szd_unlikely(s != SZDStatus::Success)) {
-      SZD_LOG_ERROR("SZD: Once log: ResetZone\n");
-      return s;
-    }
+  // Only zones that are written to need a reset.
+  uint64_t eslba = read_reset_channel_->ZoneStartLba(write_head_);
+  eslba = eslba == write_head_ ? eslba
+                               : read_reset_channel_->ZoneEndLba(write_head_);
+  eslba = eslba > max_zone_head_ ? max_zone_head_ : eslba;
+  SZDStatus s = read_reset_channel_->ResetZones(min_zone_head_, eslba);
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Once log: ResetZone\n");
+    return s;
   }
-  s = SZDStatus::Success;
   write_head_ = min_zone_head_;
   space_left_ = block_range_ * lba_size_;
   return s;
@@ -256,33 +261,34 @@ SZDStatus SZDOnceLog::ResetAllForce() {
 SZDStatus SZDOnceLog::RecoverPointers() {
   SZDStatus s;
 
-  // Retrieve zone heads from the device
-  std::vector<uint64_t> zone_heads;
-  s = read_reset_channel_->ZoneHeads(min_zone_head_, max_zone_head_ - zone_cap_,
-                                     &zone_heads);
+  // Retrieve zone descriptors from the device
+  std::vector<ZoneDescriptor> descs;
+  s = read_reset_channel_->ZoneDescriptors(
+      min_zone_head_, read_reset_channel_->ZoneStartLba(max_zone_head_ - 1),
+      &descs);
   if (szd_unlikely(s != SZDStatus::Success)) {
     SZD_LOG_ERROR("SZD: Once log: Recover pointers\n");
     return s;
   }
-  if (zone_heads.size() !=
-      ((max_zone_head_ - min_zone_head_ - zone_cap_) / zone_cap_) + 1) {
-    SZD_LOG_ERROR("SZD: Once log: ZoneHeads did not return all heads\n");
+  if (descs.size() != (read_reset_channel_->TranslateLbaToPba(max_zone_head_) -
+                       read_reset_channel_->TranslateLbaToPba(min_zone_head_)) /
+                          zone_size_) {
+    SZD_LOG_ERROR("SZD: Once log: ZoneDescriptors did not return all zones\n");
     return SZDStatus::Unknown;
   }
 
-  // Set pointers according to returned zoneheads
+  // Head is at the last zone that is not empty, the log ends at the first
+  // empty zone.
   uint64_t write_head = min_zone_head_;
-  uint64_t slba = min_zone_head_;
-  for (auto &zone_head : zone_heads) {
-    // head is at last zone that is not empty
-    if (zone_head > slba) {
-      write_head = zone_head;
-    }
-    // end has been reached.
-    if (zone_head == slba) {
+  for (auto &desc : descs) {
+    if (desc.state == SZD_ZONE_EMPTY) {
       break;
     }
-    slba += zone_cap_;
+    if (szd_unlikely(desc.state == SZD_ZONE_OFFLINE)) {
+      SZD_LOG_ERROR("SZD: Once log: Recover pointers: zone offline\n");
+      return SZDStatus::DeviceError;
+    }
+    write_head = desc.wp;
   }
   write_head_ = write_head;
   space_left_ = (max_zone_head_ - write_head_) * lba_size_;
@@ -291,10 +297,11 @@ SZDStatus SZDOnceLog::RecoverPointers() {
 
 SZDStatus SZDOnceLog::MarkInactive() {
   SZDStatus s = SZDStatus::Success;
-  if ((write_head_ / zone_cap_) * zone_cap_ != write_head_) {
+  uint64_t zone_start = read_reset_channel_->ZoneStartLba(write_head_);
+  if (zone_start != write_head_) {
     uint64_t wasted_space =
-        (write_head_ / zone_cap_) * zone_cap_ + zone_cap_ - write_head_;
-    s = read_reset_channel_->FinishZone((write_head_ / zone_cap_) * zone_cap_);
+        read_reset_channel_->ZoneEndLba(write_head_) - write_head_;
+    s = read_reset_channel_->FinishZone(zone_start);
     space_left_ -= wasted_space * lba_size_;
     write_head_ += wasted_space;
   }
@@ -2,6 +2,7 @@
 #include "szd/szd.h"
 #include "szd/szd_status.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <string>
@@ -10,14 +11,19 @@ namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 
 SZDChannel::SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
                        uint64_t min_lba, uint64_t max_lba,
-                       bool keep_async_buffer, uint32_t queue_depth)
+                       bool keep_async_buffer, uint32_t queue_depth,
+                       int32_t socket_id, DMAPool *dma_pool)
     : qpair_(qpair.release()), lba_size_(info.lba_size), zasl_(info.zasl),
       mdts_(info.mdts), zone_size_(info.zone_size), zone_cap_(info.zone_cap),
       min_lba_(min_lba), max_lba_(max_lba), can_access_all_(false),
       backed_memory_spill_(nullptr), lba_msb_(msb(info.lba_size)),
-      queue_depth_(queue_depth), outstanding_requests_(0), completion_(nullptr),
-      async_buffer_(nullptr), keep_async_buffer_(keep_async_buffer),
-      async_buffer_size_(0) {
+      queue_depth_(queue_depth), outstanding_requests_(0),
+      async_slots_(nullptr), free_writers_(nullptr), free_writer_pos_(nullptr),
+      free_writers_count_(0), async_err_(0), async_buffer_(nullptr),
+      keep_async_buffer_(keep_async_buffer),
+      async_buffer_size_(0), pipeline_depth_(1), socket_id_(socket_id),
+      dma_cache_(nullptr), bounce_ring_(nullptr),
+      bounce_slot_size_(std::max(zasl_, mdts_)), bounce_ring_size_(0) {
   assert(min_lba_ <= max_lba_);
   // If true, there is a creeping bug not catched during debug? block all IO.
   if (min_lba_ > max_lba) {
@@ -29,16 +35,69 @@ SZDChannel::SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
   if (min_lba_ == 0 && max_lba_ == info.lba_cap) {
     can_access_all_ = true;
   }
-  // Setup all buffers
-  backed_memory_spill_ = szd_calloc(lba_size_, 1, lba_size_);
-  completion_ = new Completion *[queue_depth_];
+  // Zones can differ in capacity, then translation needs each capacity.
+  if (min_lba_ < max_lba_ && zone_size_ != 0) {
+    zone_lbas_.resize((max_lba_ - min_lba_) / zone_size_ + 1);
+    int rc = szd_get_zone_cap_prefix(qpair_->man, min_lba_,
+                                     max_lba_ - zone_size_, zone_lbas_.data());
+    bool uniform = true;
+    for (size_t zone = 0; rc == SZD_SC_SUCCESS && zone < zone_lbas_.size();
+         zone++) {
+      uniform &= zone_lbas_[zone] == (min_lba_ / zone_size_ + zone) * zone_cap_;
+    }
+    if (rc != SZD_SC_SUCCESS || uniform) {
+      zone_lbas_.clear();
+      zone_lbas_.shrink_to_fit();
+    }
+  }
+  // Setup all buffers, a private pool lives as long as the cache on it. Falls
+  // back to a private pool if no cache could be made on the given one.
+  if (dma_pool == nullptr ||
+      szd_dma_cache_create(dma_pool, &dma_cache_) != SZD_SC_SUCCESS) {
+    dma_cache_ = nullptr;
+    DMAPool *private_pool = nullptr;
+    if (szd_dma_pool_create(&private_pool, lba_size_,
+                            std::max(mdts_, zasl_) * MAX_PIPELINE_DEPTH,
+                            socket_id_) == SZD_SC_SUCCESS) {
+      if (szd_dma_cache_create(private_pool, &dma_cache_) != SZD_SC_SUCCESS) {
+        dma_cache_ = nullptr;
+      }
+      szd_dma_pool_destroy(private_pool);
+    }
+  }
+  if (szd_unlikely(dma_cache_ == nullptr)) {
+    SZD_LOG_ERROR("SZD: Channel: Creation: No DMA cache, I/O that does not "
+                  "fit the bounce ring fails\n");
+  }
+  backed_memory_spill_ = szd_calloc_socket(lba_size_, 1, lba_size_, socket_id_);
+  async_slots_ = new AsyncSlot[queue_depth_];
+  free_writers_ = new uint32_t[queue_depth_];
+  free_writer_pos_ = new uint32_t[queue_depth_];
   async_buffer_ = (void **)(new char **[queue_depth_]);
   async_buffer_size_ = new size_t[queue_depth_];
   for (uint32_t i = 0; i < queue_depth_; i++) {
     async_buffer_[i] = nullptr;
-    completion_[i] = nullptr;
     async_buffer_size_[i] = 0;
+    async_slots_[i].completion = Completion_default;
+    async_slots_[i].channel = this;
+    async_slots_[i].read_buffer = nullptr;
+    async_slots_[i].read_size = 0;
+    async_slots_[i].lba = 0;
+    async_slots_[i].size = 0;
+    async_slots_[i].writer = i;
+    async_slots_[i].next = UINT32_MAX;
+    async_slots_[i].owner = i;
+    async_slots_[i].parts_left = 0;
+    async_slots_[i].busy = false;
+    async_slots_[i].bounced = false;
+    // Lowest writer on top, to hand out writers in order.
+    free_writers_[i] = queue_depth_ - 1 - i;
+    free_writer_pos_[queue_depth_ - 1 - i] = i;
   }
+  free_writers_count_ = queue_depth_;
+  // One slot for each writer and one for synchronous I/O, allocated by the
+  // first I/O that bounces.
+  bounce_ring_size_ = queue_depth_ + 1;
   // setup diagnostic variables
 #ifdef SZD_PERF_COUNTERS
   bytes_written_.store(0);
@@ -57,9 +116,10 @@ SZDChannel::SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
 }
 
 SZDChannel::SZDChannel(std::unique_ptr<QPair> qpair, const DeviceInfo &info,
-                       bool keep_async_buffer, uint32_t queue_depth)
+                       bool keep_async_buffer, uint32_t queue_depth,
+                       int32_t socket_id, DMAPool *dma_pool)
     : SZDChannel(std::move(qpair), info, 0, info.lba_cap, keep_async_buffer,
-                 queue_depth) {}
+                 queue_depth, socket_id, dma_pool) {}
 
 SZDChannel::~SZDChannel() {
   if (outstanding_requests_ > 0) {
@@ -69,39 +129,268 @@ SZDChannel::~SZDChannel() {
   // completed before a delete. The destructor should not have to poll.
   if (keep_async_buffer_ && async_buffer_ != nullptr) {
     for (uint32_t i = 0; i < queue_depth_; i++) {
-      if (async_buffer_[i] != nullptr) {
+      if (async_buffer_[i] != nullptr && !InBounceRing(async_buffer_[i])) {
         szd_free(async_buffer_[i]);
       }
-      if (completion_[i] != nullptr) {
+      if (async_slots_[i].busy) {
         SZD_LOG_ERROR(
             "SZD Channel: queue %lu with outstanding request destroyed", i);
       }
     }
   }
-  delete[] completion_;
+  delete[] async_slots_;
+  delete[] free_writers_;
+  delete[] free_writer_pos_;
   delete[] async_buffer_;
   delete[] async_buffer_size_;
+  if (bounce_ring_ != nullptr) {
+    szd_free(bounce_ring_);
+    bounce_ring_ = nullptr;
+  }
   if (backed_memory_spill_ != nullptr) {
     szd_free(backed_memory_spill_);
     backed_memory_spill_ = nullptr;
   }
+  if (dma_cache_ != nullptr) {
+    szd_dma_cache_destroy(dma_cache_);
+    dma_cache_ = nullptr;
+  }
   if (qpair_ != nullptr) {
     szd_destroy_qpair(qpair_);
   }
 }
 
+SZDStatus SZDChannel::SetBounceRingSize(uint32_t slots) {
+  if (szd_unlikely(outstanding_requests_ > 0)) {
+    SZD_LOG_ERROR("SZD: Channel: SetBounceRingSize: Outstanding requests\n");
+    return SZDStatus::InvalidArguments;
+  }
+  // Writers no longer hold on to their buffers, they bounce through the ring.
+  for (uint32_t i = 0; i < queue_depth_; i++) {
+    if (keep_async_buffer_ && async_buffer_[i] != nullptr &&
+        !InBounceRing(async_buffer_[i])) {
+      szd_free(async_buffer_[i]);
+    }
+    async_buffer_[i] = nullptr;
+    async_buffer_size_[i] = 0;
+  }
+  if (bounce_ring_ != nullptr) {
+    szd_free(bounce_ring_);
+    bounce_ring_ = nullptr;
+  }
+  bounce_ring_size_ = slots;
+  return SZDStatus::Success;
+}
+
+bool SZDChannel::AllocBounceRing() {
+  if (szd_likely(bounce_ring_ != nullptr)) {
+    return true;
+  }
+  if (bounce_ring_size_ == 0 || bounce_slot_size_ == 0) {
+    return false;
+  }
+  bounce_ring_ = (char *)szd_calloc_socket(lba_size_, bounce_ring_size_,
+                                           bounce_slot_size_, socket_id_);
+  if (szd_unlikely(bounce_ring_ == nullptr)) {
+    // Not tried again, I/O bounces through the DMA cache from now on.
+    SZD_LOG_ERROR("SZD: Channel: No bounce ring, I/O bounces through the DMA "
+                  "cache\n");
+    bounce_ring_size_ = 0;
+    return false;
+  }
+  return true;
+}
+
+void *SZDChannel::GetSyncBounce(uint64_t *size) {
+  AllocBounceRing();
+  // Slots after those of the writers are next to each other.
+  uint64_t ring_size =
+      (bounce_ring_size_ - AsyncBounceSlots()) * bounce_slot_size_;
+  char *ring = bounce_ring_ + AsyncBounceSlots() * bounce_slot_size_;
+  if (szd_likely(ring_size >= *size)) {
+    return ring;
+  }
+  // A ring that is too small would cut the pipeline depth, the DMA cache
+  // holds the whole pipeline.
+  void *buffer = szd_dma_get(dma_cache_, *size, false);
+  if (szd_unlikely(buffer == nullptr && ring_size != 0)) {
+    *size = ring_size;
+    return ring;
+  }
+  return buffer;
+}
+
+void SZDChannel::PutSyncBounce(void *buffer, uint64_t size) {
+  if (!InBounceRing(buffer)) {
+    szd_dma_put(dma_cache_, buffer, size);
+  }
+}
+
+void *SZDChannel::GetAsyncBounce(uint32_t writer, uint64_t size) {
+  // Bounce through the slot of the writer, or a DMA buffer if it has none.
+  AllocBounceRing();
+  if (writer < AsyncBounceSlots()) {
+    async_buffer_[writer] = bounce_ring_ + writer * bounce_slot_size_;
+    async_buffer_size_[writer] = bounce_slot_size_;
+  } else if (keep_async_buffer_ && async_buffer_size_[writer] < size) {
+    if (async_buffer_[writer] != nullptr) {
+      szd_free(async_buffer_[writer]);
+    }
+    async_buffer_[writer] = szd_calloc_socket(lba_size_, 1, size, socket_id_);
+    async_buffer_size_[writer] = size;
+  } else if (!keep_async_buffer_) {
+    async_buffer_[writer] = szd_dma_get(dma_cache_, size, false);
+    async_buffer_size_[writer] = size;
+  }
+  return async_buffer_[writer];
+}
+
+void SZDChannel::PutAsyncBounce(uint32_t writer) {
+  if (keep_async_buffer_ || InBounceRing(async_buffer_[writer])) {
+    return;
+  }
+  szd_dma_put(dma_cache_, async_buffer_[writer], async_buffer_size_[writer]);
+  async_buffer_[writer] = nullptr;
+}
+
+void SZDChannel::ClaimWriter(uint32_t writer) {
+  uint32_t pos = free_writer_pos_[writer];
+  uint32_t top = free_writers_[--free_writers_count_];
+  free_writers_[pos] = top;
+  free_writer_pos_[top] = pos;
+  async_slots_[writer].busy = true;
+  outstanding_requests_++;
+}
+
+void SZDChannel::ReleaseWriter(uint32_t writer) {
+  free_writer_pos_[writer] = free_writers_count_;
+  free_writers_[free_writers_count_++] = writer;
+  async_slots_[writer].busy = false;
+  outstanding_requests_--;
+}
+
+void SZDChannel::AsyncComplete(void *cb_arg, uint16_t err, uint64_t lba) {
+  AsyncSlot *slot = (AsyncSlot *)cb_arg;
+  SZDChannel *channel = slot->channel;
+  uint32_t next = slot->next;
+  slot->next = UINT32_MAX;
+  // Parts of one zone can be placed in another order than they were sent.
+  if (szd_unlikely(err == 0 && lba != slot->lba)) {
+    err = UINT16_MAX;
+  }
+  if (slot->bounced) {
+    // Only reads into memory that is not DMA-capable are copied.
+    if (slot->read_buffer != nullptr && err == 0) {
+      memcpy(slot->read_buffer, channel->async_buffer_[slot->writer],
+             slot->read_size);
+    }
+    // Remove temporary buffer.
+    channel->PutAsyncBounce(slot->writer);
+  }
+  // Parts of a split append are free again as soon as they are done.
+  AsyncSlot *owner = &channel->async_slots_[slot->owner];
+  if (slot != owner) {
+    slot->completion.err = err;
+    slot->completion.done = true;
+    channel->ReleaseWriter(slot->writer);
+  }
+  if (err != 0) {
+    owner->completion.err = err;
+    channel->async_err_ = err;
+  }
+  if (--owner->parts_left == 0) {
+    owner->completion.done = true;
+    channel->ReleaseWriter(owner->writer);
+  }
+  // The next part of the zone can only land after this one, when this one
+  // failed it can not land at all.
+  if (next != UINT32_MAX) {
+    AsyncSlot *next_slot = &channel->async_slots_[next];
+    uint64_t next_lba = next_slot->lba;
+    if (err == 0 &&
+        szd_append_async_cb(channel->qpair_, &next_lba,
+                            channel->async_buffer_[next], next_slot->size,
+                            AsyncComplete, (void *)next_slot) == 0) {
+      return;
+    }
+    AsyncComplete((void *)next_slot, err != 0 ? err : UINT16_MAX,
+                  next_slot->lba);
+  }
+}
+
 uint64_t SZDChannel::TranslateLbaToPba(uint64_t lba) {
-  // determine lba by going to actual zone offset and readding offset.
-  uint64_t slba = (lba / zone_cap_) * zone_size_;
-  uint64_t slba_offset = lba % zone_cap_;
-  return slba + slba_offset;
+  if (szd_likely(zone_lbas_.empty())) {
+    // determine lba by going to actual zone offset and readding offset.
+    uint64_t slba = (lba / zone_cap_) * zone_size_;
+    uint64_t slba_offset = lba % zone_cap_;
+    return slba + slba_offset;
+  }
+  // Outside of the channel, keep the same distance to the channel.
+  if (lba < zone_lbas_.front()) {
+    return min_lba_ - (zone_lbas_.front() - lba);
+  }
+  if (lba >= zone_lbas_.back()) {
+    return max_lba_ + (lba - zone_lbas_.back());
+  }
+  // Last zone that starts at or before lba.
+  auto zone_start =
+      std::upper_bound(zone_lbas_.begin(), zone_lbas_.end(), lba) - 1;
+  uint64_t zone = zone_start - zone_lbas_.begin();
+  return min_lba_ + zone * zone_size_ + (lba - *zone_start);
 }
 
 uint64_t SZDChannel::TranslatePbaToLba(uint64_t lba) {
-  // determine lba by going to fake zone offset and readding offset.
-  uint64_t slba = (lba / zone_size_) * zone_cap_;
-  uint64_t slba_offset = lba % zone_size_;
-  return slba + slba_offset;
+  if (szd_likely(zone_lbas_.empty())) {
+    // determine lba by going to fake zone offset and readding offset.
+    uint64_t slba = (lba / zone_size_) * zone_cap_;
+    uint64_t slba_offset = lba % zone_size_;
+    return slba + slba_offset;
+  }
+  if (lba < min_lba_) {
+    return zone_lbas_.front() - (min_lba_ - lba);
+  }
+  if (lba >= max_lba_) {
+    return zone_lbas_.back() + (lba - max_lba_);
+  }
+  uint64_t zone = (lba - min_lba_) / zone_size_;
+  return zone_lbas_[zone] + (lba - min_lba_) % zone_size_;
+}
+
+uint64_t SZDChannel::ZoneStartLba(uint64_t lba) {
+  uint64_t pba = TranslateLbaToPba(lba);
+  return TranslatePbaToLba((pba / zone_size_) * zone_size_);
+}
+
+uint64_t SZDChannel::ZoneEndLba(uint64_t lba) {
+  uint64_t pba = TranslateLbaToPba(lba);
+  return ZoneStartLba(lba) + ZoneCapAt(pba);
+}
+
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+void SZDChannel::CountZoneAppends(uint64_t pba, uint64_t lbas) {
+  while (lbas != 0) {
+    uint64_t zslba = (pba / zone_size_) * zone_size_;
+    uint64_t step = zslba + ZoneCapAt(zslba) - pba;
+    step = step > lbas ? lbas : step;
+    append_operations_[(zslba - min_lba_) / zone_size_] +=
+        ((step * lba_size_ + zasl_ - 1) / zasl_);
+    lbas -= step;
+    pba = zslba + zone_size_;
+  }
+}
+#endif
+
+uint64_t SZDChannel::ZonesTraversed(uint64_t slba, uint64_t lbas) const {
+  if (szd_likely(zone_lbas_.empty())) {
+    return lbas / zone_cap_;
+  }
+  uint64_t zones = 0;
+  for (uint64_t cap = ZoneCapAt(slba); lbas >= cap; cap = ZoneCapAt(slba)) {
+    lbas -= cap;
+    zones++;
+    slba += zone_size_;
+  }
+  return zones;
 }
 
 SZDStatus SZDChannel::FlushBufferSection(uint64_t *lba, const SZDBuffer &buffer,
@@ -116,7 +405,7 @@ SZDStatus SZDChannel::FlushBufferSection(uint64_t *lba, const SZDBuffer &buffer,
   // Check if in bounds...
   uint64_t slba = (new_lba / zone_size_) * zone_size_;
   uint64_t zones_needed =
-      (new_lba - slba + (alligned_size / lba_size_)) / zone_cap_;
+      ZonesTraversed(slba, new_lba - slba + alligned_size / lba_size_);
   if (szd_unlikely(addr + alligned_size > available_size || slba < min_lba_ ||
                    slba + zones_needed * zone_size_ > max_lba_ ||
                    (alligned && size != allign_size(size)))) {
@@ -144,11 +433,13 @@ SZDStatus SZDChannel::FlushBufferSection(uint64_t *lba, const SZDBuffer &buffer,
     int rc = 0;
     if (prefix_size > 0) {
 #ifdef SZD_PERF_COUNTERS
-      rc = szd_append_with_diag(qpair_, &new_lba, (char *)cbuffer + addr,
-                                prefix_size, &append_ops);
+      rc = szd_append_pipelined_with_diag(qpair_, &new_lba,
+                                          (char *)cbuffer + addr, prefix_size,
+                                          &append_ops, pipeline_depth_);
       bytes_written_.fetch_add(prefix_size, std::memory_order_relaxed);
 #else
-      rc = szd_append(qpair_, &new_lba, (char *)cbuffer + addr, prefix_size);
+      rc = szd_append_pipelined(qpair_, &new_lba, (char *)cbuffer + addr,
+                                prefix_size, pipeline_depth_);
 #endif
     }
     memset((char *)backed_memory_spill_ + postfix_size, 0,
@@ -165,12 +456,14 @@ SZDStatus SZDChannel::FlushBufferSection(uint64_t *lba, const SZDBuffer &buffer,
     s = FromStatus(rc);
   } else {
 #ifdef SZD_PERF_COUNTERS
-    s = FromStatus(szd_append_with_diag(
-        qpair_, &new_lba, (char *)cbuffer + addr, alligned_size, &append_ops));
+    s = FromStatus(szd_append_pipelined_with_diag(
+        qpair_, &new_lba, (char *)cbuffer + addr, alligned_size, &append_ops,
+        pipeline_depth_));
     bytes_written_.fetch_add(alligned_size, std::memory_order_relaxed);
 #else
-    s = FromStatus(
-        szd_append(qpair_, &new_lba, (char *)cbuffer + addr, alligned_size));
+    s = FromStatus(szd_append_pipelined(qpair_, &new_lba,
+                                        (char *)cbuffer + addr, alligned_size,
+                                        pipeline_depth_));
 #endif
   }
 
@@ -181,7 +474,7 @@ SZDStatus SZDChannel::FlushBufferSection(uint64_t *lba, const SZDBuffer &buffer,
   uint64_t left = alligned_size / lba_size_;
   uint64_t step = 0;
   for (slba = old_lba; left != 0 && slba <= new_lba; slba += step) {
-    uint64_t step = left > zone_cap_ ? zone_cap_ : left;
+    uint64_t step = left > ZoneCapAt(slba) ? ZoneCapAt(slba) : left;
     append_operations_[(slba - min_lba_) / zone_size_] +=
         ((step * lba_size_ + zasl_ - 1) / zasl_);
     left -= step;
@@ -206,7 +499,7 @@ SZDStatus SZDChannel::ReadIntoBuffer(uint64_t lba, SZDBuffer *buffer,
   // Check if in bounds...
   uint64_t slba = (lba / zone_size_) * zone_size_;
   uint64_t zones_needed =
-      (lba - slba + (alligned_size / lba_size_)) / zone_cap_;
+      ZonesTraversed(slba, lba - slba + alligned_size / lba_size_);
   if (addr + alligned_size > available_size || slba < min_lba_ ||
       slba + zones_needed * zone_size_ > max_lba_ ||
       (alligned && size != allign_size(size))) {
@@ -231,12 +524,14 @@ SZDStatus SZDChannel::ReadIntoBuffer(uint64_t lba, SZDBuffer *buffer,
     if (alligned_size > 0) {
 #ifdef SZD_PERF_COUNTERS
       uint64_t read_ops = 0;
-      rc = szd_read_with_diag(qpair_, lba, (char *)cbuffer + addr,
-                              alligned_size, &read_ops);
+      rc = szd_read_pipelined_with_diag(qpair_, lba, (char *)cbuffer + addr,
+                                        alligned_size, &read_ops,
+                                        pipeline_depth_);
       bytes_read_.fetch_add(alligned_size, std::memory_order_relaxed);
       read_operations_.fetch_add(read_ops, std::memory_order_relaxed);
 #else
-      rc = szd_read(qpair_, lba, (char *)cbuffer + addr, alligned_size);
+      rc = szd_read_pipelined(qpair_, lba, (char *)cbuffer + addr,
+                              alligned_size, pipeline_depth_);
 #endif
     }
 #ifdef SZD_PERF_COUNTERS
@@ -258,13 +553,15 @@ SZDStatus SZDChannel::ReadIntoBuffer(uint64_t lba, SZDBuffer *buffer,
   } else {
 #ifdef SZD_PERF_COUNTERS
     uint64_t read_ops = 0;
-    s = FromStatus(szd_read_with_diag(qpair_, lba, (char *)cbuffer + addr,
-                                      alligned_size, &read_ops));
+    s = FromStatus(szd_read_pipelined_with_diag(qpair_, lba,
+                                                (char *)cbuffer + addr,
+                                                alligned_size, &read_ops,
+                                                pipeline_depth_));
     bytes_read_.fetch_add(alligned_size, std::memory_order_relaxed);
     read_operations_.fetch_add(read_ops, std::memory_order_relaxed);
 #else
-    s = FromStatus(
-        szd_read(qpair_, lba, (char *)cbuffer + addr, alligned_size));
+    s = FromStatus(szd_read_pipelined(qpair_, lba, (char *)cbuffer + addr,
+                                      alligned_size, pipeline_depth_));
 #endif
   }
   return s;
@@ -279,21 +576,28 @@ SZDStatus SZDChannel::DirectAppend(uint64_t *lba, void *buffer,
   // Check if in bounds...
   uint64_t slba = (new_lba / zone_size_) * zone_size_;
   uint64_t zones_needed =
-      (new_lba - slba + (alligned_size / lba_size_)) / zone_cap_;
+      ZonesTraversed(slba, new_lba - slba + alligned_size / lba_size_);
   if (szd_unlikely(slba < min_lba_ ||
                    slba + zones_needed * zone_size_ > max_lba_ ||
                    (alligned && size != allign_size(size)))) {
     SZD_LOG_ERROR("SZD: Channel: DirectAppend: OOB\n");
     return SZDStatus::InvalidArguments;
   }
-  // Create temporary DMA buffer of maximum ZASL size
-  size_t dma_buffer_size = zasl_ > alligned_size ? alligned_size : zasl_;
-  void *dma_buffer = szd_calloc(lba_size_, dma_buffer_size, 1);
+  if (szd_dma_capable(qpair_->man, buffer, size)) {
+    SZDStatus s = DirectAppendZeroCopy(&new_lba, buffer, size);
+    *lba = TranslatePbaToLba(new_lba);
+    return s;
+  }
+  // Bounce buffer of maximum ZASL size for each pipelined append
+  uint64_t dma_buffer_size = zasl_ * pipeline_depth_ > alligned_size
+                                 ? alligned_size
+                                 : zasl_ * pipeline_depth_;
+  void *dma_buffer = GetSyncBounce(&dma_buffer_size);
   if (szd_unlikely(dma_buffer == nullptr)) {
     SZD_LOG_ERROR("SZD: Channel: DirectAppend: No DMA buffer\n");
     return SZDStatus::MemoryError;
   }
-  // Write in steps of ZASL
+  // Write in steps of (pipelined) ZASL
   uint64_t begin = 0;
   uint64_t stepsize = dma_buffer_size;
   SZDStatus s = SZDStatus::Success;
@@ -311,24 +615,19 @@ SZDStatus SZDChannel::DirectAppend(uint64_t *lba, void *buffer,
 #ifdef SZD_PERF_PER_ZONE_COUNTERS
     uint64_t prev_lba = new_lba;
 #endif
-    s = FromStatus(szd_append_with_diag(qpair_, &new_lba, dma_buffer, stepsize,
-                                        &append_ops));
+    s = FromStatus(szd_append_pipelined_with_diag(
+        qpair_, &new_lba, dma_buffer, stepsize, &append_ops, pipeline_depth_));
     if (s == SZDStatus::Success) {
       bytes_written_.fetch_add(stepsize, std::memory_order_relaxed);
       append_operations_counter_.fetch_add(append_ops,
                                            std::memory_order_relaxed);
 #ifdef SZD_PERF_PER_ZONE_COUNTERS
-      if ((prev_lba / zone_size_) * zone_size_ !=
-          (new_lba / zone_size_) * zone_size_) {
-        append_operations_[(prev_lba - min_lba_) / zone_size_] += 1;
-      }
-      if (new_lba % zone_size_ != 0 && new_lba < max_lba_) {
-        append_operations_[(new_lba - min_lba_) / zone_size_] += 1;
-      }
+      CountZoneAppends(prev_lba, stepsize / lba_size_);
 #endif
     }
 #else
-    s = FromStatus(szd_append(qpair_, &new_lba, dma_buffer, stepsize));
+    s = FromStatus(szd_append_pipelined(qpair_, &new_lba, dma_buffer, stepsize,
+                                        pipeline_depth_));
 #endif
 
     if (szd_unlikely(s != SZDStatus::Success)) {
@@ -337,8 +636,8 @@ SZDStatus SZDChannel::DirectAppend(uint64_t *lba, void *buffer,
     }
     begin += stepsize;
   }
-  // Remove temporary buffer.
-  szd_free(dma_buffer);
+  // Return bounce buffer.
+  PutSyncBounce(dma_buffer, dma_buffer_size);
   *lba = TranslatePbaToLba(new_lba);
   return s;
 }
@@ -351,25 +650,31 @@ SZDStatus SZDChannel::DirectRead(uint64_t lba, void *buffer, uint64_t size,
   // Check if in bounds...
   uint64_t slba = (lba / zone_size_) * zone_size_;
   uint64_t zones_needed =
-      (lba - slba + (alligned_size / lba_size_)) / zone_cap_;
+      ZonesTraversed(slba, lba - slba + alligned_size / lba_size_);
   if (szd_unlikely(slba < min_lba_ ||
                    slba + zones_needed * zone_size_ > max_lba_ ||
                    (alligned && size != allign_size(size)))) {
     SZD_LOG_ERROR("SZD: Channel: DirectRead: OOB\n");
     return SZDStatus::InvalidArguments;
   }
-  // Create temporary DMA buffer to copy other DMA buffer data into.
-  size_t dma_buffer_size = mdts_ > alligned_size ? alligned_size : mdts_;
-  void *buffer_dma = szd_calloc(lba_size_, 1, dma_buffer_size);
+  if (szd_dma_capable(qpair_->man, buffer, size)) {
+    return DirectReadZeroCopy(lba, buffer, size);
+  }
+  // Bounce buffer to copy other DMA buffer data into, large enough to keep
+  // pipeline_depth_ reads in flight.
+  uint64_t dma_buffer_size = mdts_ * pipeline_depth_ > alligned_size
+                                 ? alligned_size
+                                 : mdts_ * pipeline_depth_;
+  void *buffer_dma = GetSyncBounce(&dma_buffer_size);
   if (szd_unlikely(buffer_dma == nullptr)) {
     SZD_LOG_ERROR("SZD: Channel: DirectRead: OOM\n");
     return SZDStatus::MemoryError;
   }
-  // Read in steps of MDTS
+  // Read in steps of (pipelined) MDTS
   uint64_t begin = 0;
   uint64_t lba_to_read = lba;
   slba = (lba_to_read / zone_size_) * zone_size_;
-  uint64_t current_zone_end = slba + zone_cap_;
+  uint64_t current_zone_end = slba + ZoneCapAt(slba);
   uint64_t stepsize = dma_buffer_size;
   uint64_t alligned_step = dma_buffer_size;
   SZDStatus s = SZDStatus::Success;
@@ -384,12 +689,13 @@ SZDStatus SZDChannel::DirectRead(uint64_t lba, void *buffer, uint64_t size,
     }
 #ifdef SZD_PERF_COUNTERS
     uint64_t read_ops = 0;
-    s = FromStatus(szd_read_with_diag(qpair_, lba_to_read, buffer_dma, stepsize,
-                                      &read_ops));
+    s = FromStatus(szd_read_pipelined_with_diag(
+        qpair_, lba_to_read, buffer_dma, stepsize, &read_ops, pipeline_depth_));
     read_operations_.fetch_add(read_ops, std::memory_order_relaxed);
     bytes_read_.fetch_add(stepsize, std::memory_order_relaxed);
 #else
-    s = FromStatus(szd_read(qpair_, lba_to_read, buffer_dma, stepsize));
+    s = FromStatus(szd_read_pipelined(qpair_, lba_to_read, buffer_dma,
+                                      stepsize, pipeline_depth_));
 #endif
     if (szd_likely(s == SZDStatus::Success)) {
       memcpy((char *)buffer + begin, buffer_dma, alligned_step);
@@ -399,20 +705,189 @@ SZDStatus SZDChannel::DirectRead(uint64_t lba, void *buffer, uint64_t size,
     }
     begin += stepsize;
     lba_to_read += stepsize / lba_size_;
-    if (lba_to_read >= current_zone_end) {
+    // A pipelined step can span more than one zone.
+    while (lba_to_read >= current_zone_end) {
       slba += zone_size_;
       lba_to_read = slba + lba_to_read - current_zone_end;
-      current_zone_end = slba + zone_cap_;
+      current_zone_end = slba + ZoneCapAt(slba);
     }
   }
-  // Remove temporary buffer.
-  szd_free(buffer_dma);
+  // Return bounce buffer.
+  PutSyncBounce(buffer_dma, dma_buffer_size);
   return s;
 }
 
+SZDStatus SZDChannel::DirectAppendZeroCopy(uint64_t *pba, void *buffer,
+                                           uint64_t size) {
+  uint64_t prefix_size = (size / lba_size_) * lba_size_;
+  uint64_t postfix_size = size - prefix_size;
+  int rc = SZD_SC_SUCCESS;
+#ifdef SZD_PERF_COUNTERS
+  uint64_t append_ops = 0;
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+  uint64_t prev_lba = *pba;
+#endif
+#endif
+  if (prefix_size > 0) {
+#ifdef SZD_PERF_COUNTERS
+    rc = szd_append_pipelined_with_diag(qpair_, pba, buffer, prefix_size,
+                                        &append_ops, pipeline_depth_);
+#else
+    rc = szd_append_pipelined(qpair_, pba, buffer, prefix_size,
+                              pipeline_depth_);
+#endif
+  }
+  if (rc == SZD_SC_SUCCESS && postfix_size > 0) {
+    if (szd_unlikely(backed_memory_spill_ == nullptr)) {
+      SZD_LOG_ERROR("SZD: Channel: DirectAppend: No spill buffer\n");
+      return SZDStatus::MemoryError;
+    }
+    memcpy(backed_memory_spill_, (char *)buffer + prefix_size, postfix_size);
+    memset((char *)backed_memory_spill_ + postfix_size, 0,
+           lba_size_ - postfix_size);
+#ifdef SZD_PERF_COUNTERS
+    rc = szd_append_with_diag(qpair_, pba, backed_memory_spill_, lba_size_,
+                              &append_ops);
+#else
+    rc = szd_append(qpair_, pba, backed_memory_spill_, lba_size_);
+#endif
+  }
+  if (szd_unlikely(rc != SZD_SC_SUCCESS)) {
+    SZD_LOG_ERROR("SZD: Channel: DirectAppend: Could not write\n");
+    return FromStatus(rc);
+  }
+#ifdef SZD_PERF_COUNTERS
+  bytes_written_.fetch_add(allign_size(size), std::memory_order_relaxed);
+  append_operations_counter_.fetch_add(append_ops, std::memory_order_relaxed);
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+  CountZoneAppends(prev_lba, allign_size(size) / lba_size_);
+#endif
+#endif
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDChannel::DirectReadZeroCopy(uint64_t pba, void *buffer,
+                                         uint64_t size) {
+  uint64_t prefix_size = (size / lba_size_) * lba_size_;
+  uint64_t postfix_size = size - prefix_size;
+  int rc = SZD_SC_SUCCESS;
+#ifdef SZD_PERF_COUNTERS
+  uint64_t read_ops = 0;
+#endif
+  if (prefix_size > 0) {
+#ifdef SZD_PERF_COUNTERS
+    rc = szd_read_pipelined_with_diag(qpair_, pba, buffer, prefix_size,
+                                      &read_ops, pipeline_depth_);
+#else
+    rc = szd_read_pipelined(qpair_, pba, buffer, prefix_size, pipeline_depth_);
+#endif
+  }
+  if (rc == SZD_SC_SUCCESS && postfix_size > 0) {
+    if (szd_unlikely(backed_memory_spill_ == nullptr)) {
+      SZD_LOG_ERROR("SZD: Channel: DirectRead: No spill buffer\n");
+      return SZDStatus::MemoryError;
+    }
+    // The prefix can span zones, skip what lies beyond their capacity.
+    uint64_t tail_pba = pba + prefix_size / lba_size_;
+    uint64_t slba = (pba / zone_size_) * zone_size_;
+    uint64_t current_zone_end = slba + ZoneCapAt(slba);
+    while (tail_pba >= current_zone_end) {
+      slba += zone_size_;
+      tail_pba = slba + tail_pba - current_zone_end;
+      current_zone_end = slba + ZoneCapAt(slba);
+    }
+#ifdef SZD_PERF_COUNTERS
+    rc = szd_read_with_diag(qpair_, tail_pba, backed_memory_spill_, lba_size_,
+                            &read_ops);
+#else
+    rc = szd_read(qpair_, tail_pba, backed_memory_spill_, lba_size_);
+#endif
+    if (rc == SZD_SC_SUCCESS) {
+      memcpy((char *)buffer + prefix_size, backed_memory_spill_, postfix_size);
+    }
+  }
+  if (szd_unlikely(rc != SZD_SC_SUCCESS)) {
+    SZD_LOG_ERROR("SZD: Channel: DirectRead: Could not read\n");
+    return FromStatus(rc);
+  }
+#ifdef SZD_PERF_COUNTERS
+  bytes_read_.fetch_add(allign_size(size), std::memory_order_relaxed);
+  read_operations_.fetch_add(read_ops, std::memory_order_relaxed);
+#endif
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDChannel::CopyRanges(const std::vector<CopyRange> &ranges,
+                                 uint64_t *lba) {
+  // Translate and check if in bounds...
+  std::vector<CopyRange> pba_ranges(ranges.size());
+  uint64_t lbas = 0;
+  for (size_t i = 0; i < ranges.size(); i++) {
+    pba_ranges[i].slba = TranslateLbaToPba(ranges[i].slba);
+    pba_ranges[i].nlb = ranges[i].nlb;
+    uint64_t slba = (pba_ranges[i].slba / zone_size_) * zone_size_;
+    uint64_t zones_needed =
+        ZonesTraversed(slba, pba_ranges[i].slba - slba + ranges[i].nlb);
+    if (szd_unlikely(slba < min_lba_ ||
+                     slba + zones_needed * zone_size_ > max_lba_)) {
+      SZD_LOG_ERROR("SZD: Channel: CopyRanges: OOB\n");
+      return SZDStatus::InvalidArguments;
+    }
+    lbas += ranges[i].nlb;
+  }
+  uint64_t new_lba = TranslateLbaToPba(*lba);
+  uint64_t slba = (new_lba / zone_size_) * zone_size_;
+  uint64_t zones_needed = ZonesTraversed(slba, new_lba - slba + lbas);
+  if (szd_unlikely(slba < min_lba_ ||
+                   slba + zones_needed * zone_size_ > max_lba_)) {
+    SZD_LOG_ERROR("SZD: Channel: CopyRanges: OOB\n");
+    return SZDStatus::InvalidArguments;
+  }
+#ifdef SZD_PERF_COUNTERS
+  uint64_t copy_ops = 0;
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+  uint64_t prev_lba = new_lba;
+#endif
+  SZDStatus s = FromStatus(szd_copy_with_diag(
+      qpair_, pba_ranges.data(), (uint32_t)pba_ranges.size(), &new_lba,
+      &copy_ops));
+  if (s == SZDStatus::Success) {
+    bytes_written_.fetch_add(lbas * lba_size_, std::memory_order_relaxed);
+    append_operations_counter_.fetch_add(copy_ops, std::memory_order_relaxed);
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+    CountZoneAppends(prev_lba, lbas);
+#endif
+  }
+#else
+  SZDStatus s = FromStatus(szd_copy(qpair_, pba_ranges.data(),
+                                    (uint32_t)pba_ranges.size(), &new_lba));
+#endif
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Channel: CopyRanges: Could not copy\n");
+  }
+  *lba = TranslatePbaToLba(new_lba);
+  return s;
+}
+
+uint64_t SZDChannel::AsyncAppendParts(uint64_t lba, uint64_t size) {
+  uint64_t pba = TranslateLbaToPba(lba);
+  uint64_t left = allign_size(size) / lba_size_;
+  // Each part is at most ZASL and ends at the end of its zone.
+  uint64_t parts = 0;
+  do {
+    uint64_t zslba = (pba / zone_size_) * zone_size_;
+    uint64_t zone_end = zslba + ZoneCapAt(zslba);
+    uint64_t step = std::min(std::min(left, zone_end - pba), zasl_ / lba_size_);
+    left -= step;
+    pba = pba + step == zone_end ? zslba + zone_size_ : pba + step;
+    parts++;
+  } while (left != 0);
+  return parts;
+}
+
 SZDStatus SZDChannel::AsyncAppend(uint64_t *lba, void *buffer,
                                   const uint64_t size, uint32_t writer) {
-  if (szd_unlikely(writer >= queue_depth_)) {
+  if (szd_unlikely(writer >= queue_depth_ || async_slots_[writer].busy)) {
     SZD_LOG_ERROR("SZD: Channel: AsyncAppend: Invalid writer\n");
     return SZDStatus::InvalidArguments;
   }
@@ -420,141 +895,213 @@ SZDStatus SZDChannel::AsyncAppend(uint64_t *lba, void *buffer,
   uint64_t new_lba = TranslateLbaToPba(*lba);
   // Allign
   uint64_t alligned_size = allign_size(size);
-  if (alligned_size > zasl_) {
-    SZD_LOG_ERROR(
-        "SZD: Channel: AsyncAppend: Writes larger than ZASL not supported\n");
-    return SZDStatus::InvalidArguments;
-  }
   // Check if in bounds...
   uint64_t slba = (new_lba / zone_size_) * zone_size_;
   uint64_t zones_needed =
-      (new_lba - slba + (alligned_size / lba_size_) + zone_cap_ - 1) /
-      zone_cap_;
-  if (szd_unlikely(zones_needed > 1 || slba < min_lba_ ||
+      ZonesTraversed(slba, new_lba - slba + alligned_size / lba_size_);
+  if (szd_unlikely(slba < min_lba_ ||
                    slba + zones_needed * zone_size_ > max_lba_)) {
     SZD_LOG_ERROR("SZD: Channel: AsyncAppend: OOB\n");
     return SZDStatus::InvalidArguments;
   }
-  // Create temporary DMA buffer and copy normal buffer to DMA.
-  if (keep_async_buffer_ && async_buffer_size_[writer] < alligned_size) {
-    if (async_buffer_[writer] != nullptr) {
-      szd_free(async_buffer_[writer]);
+  uint64_t parts = AsyncAppendParts(*lba, alligned_size);
+  if (szd_unlikely(parts > queue_depth_)) {
+    SZD_LOG_ERROR(
+        "SZD: Channel: AsyncAppend: Write needs more writers than queue\n");
+    return SZDStatus::InvalidArguments;
+  }
+  // Wait till the other parts have writers, writer itself is free. Waits on
+  // busy writers one by one, with the wait policy of the channel.
+  for (uint32_t i = 0; free_writers_count_ < parts && i < queue_depth_; i++) {
+    if (async_slots_[i].busy) {
+      szd_poll_async(qpair_, &async_slots_[i].completion);
     }
-    async_buffer_[writer] = szd_calloc(lba_size_, 1, alligned_size);
-    async_buffer_size_[writer] = alligned_size;
-  } else if (!keep_async_buffer_) {
-    async_buffer_[writer] = szd_calloc(lba_size_, 1, alligned_size);
-  } else {
-    memset(async_buffer_[writer], 0, async_buffer_size_[writer]);
   }
-  if (szd_unlikely(async_buffer_[writer] == nullptr)) {
-    SZD_LOG_ERROR("SZD: Channel: AsyncAppend: OOM\n");
-    return SZDStatus::MemoryError;
+#ifdef SZD_PERF_COUNTERS
+#ifdef SZD_PERF_PER_ZONE_COUNTERS
+  uint64_t prev_lba = new_lba;
+#endif
+#endif
+  AsyncSlot *owner = &async_slots_[writer];
+  owner->completion = Completion_default;
+  owner->parts_left = parts;
+  SZDStatus s = SZDStatus::Success;
+  uint64_t begin = 0;
+  uint32_t part = 0;
+  uint32_t part_writer = writer;
+  AsyncSlot *prev = nullptr;
+  for (; part < parts; part++) {
+    uint64_t zslba = (new_lba / zone_size_) * zone_size_;
+    uint64_t zone_end = zslba + ZoneCapAt(zslba);
+    // Parts start at the next zone when the previous one filled a zone.
+    bool next_zone = new_lba >= zone_end;
+    if (next_zone) {
+      new_lba = zslba + zone_size_;
+      zone_end = new_lba + ZoneCapAt(new_lba);
+    }
+    uint64_t step = std::min(alligned_size - begin, zasl_);
+    step = std::min(step, (zone_end - new_lba) * lba_size_);
+    uint64_t copy = begin + step > size ? size - begin : step;
+    if (part != 0) {
+      part_writer = free_writers_[free_writers_count_ - 1];
+    }
+    if (szd_unlikely(GetAsyncBounce(part_writer, step) == nullptr)) {
+      SZD_LOG_ERROR("SZD: Channel: AsyncAppend: OOM\n");
+      s = SZDStatus::MemoryError;
+      break;
+    }
+    // Only the padding needs to be zero, the rest is overwritten.
+    memcpy(async_buffer_[part_writer], (char *)buffer + begin, copy);
+    memset((char *)async_buffer_[part_writer] + copy, 0, step - copy);
+    AsyncSlot *slot = &async_slots_[part_writer];
+    if (part != 0) {
+      slot->completion = Completion_default;
+    }
+    slot->read_buffer = nullptr;
+    slot->bounced = true;
+    slot->owner = writer;
+    slot->lba = new_lba;
+    slot->size = step;
+    slot->next = UINT32_MAX;
+    if (prev != nullptr && !next_zone) {
+      // Appends to one zone that are in flight together can land in any
+      // order, so the part is submitted when the previous one completed.
+      prev->next = part_writer;
+    } else {
+      uint64_t submit_lba = new_lba;
+      s = FromStatus(szd_append_async_cb(qpair_, &submit_lba,
+                                         async_buffer_[part_writer], step,
+                                         AsyncComplete, (void *)slot));
+      if (szd_unlikely(s != SZDStatus::Success)) {
+        SZD_LOG_ERROR("SZD: Channel: AsyncAppend: Could not submit\n");
+        PutAsyncBounce(part_writer);
+        break;
+      }
+    }
+    ClaimWriter(part_writer);
+    new_lba += step / lba_size_;
+    begin += step;
+    prev = slot;
   }
-  memcpy(async_buffer_[writer], buffer, size);
-  if (completion_[writer] != nullptr) {
-    delete completion_[writer];
+  if (szd_unlikely(part != parts)) {
+    // Parts in flight still complete writer, with an error as the write is
+    // incomplete.
+    owner->parts_left -= parts - part;
+    if (part != 0) {
+      owner->completion.err = UINT16_MAX;
+      async_err_ = UINT16_MAX;
+      *lba = TranslatePbaToLba(new_lba);
+    }
+    return s;
   }
-  completion_[writer] = new Completion;
-  SZDStatus s = SZDStatus::Success;
 #ifdef SZD_PERF_COUNTERS
-  uint64_t append_ops = 0;
-  s = FromStatus(szd_append_async_with_diag(
-      qpair_, &new_lba, async_buffer_[writer], alligned_size, &append_ops,
-      completion_[writer]));
-  if (s == SZDStatus::Success) {
-    // Diag register
-    bytes_written_.fetch_add(alligned_size, std::memory_order_relaxed);
-    append_operations_counter_.fetch_add(append_ops, std::memory_order_relaxed);
+  // Diag register, each part is one append.
+  bytes_written_.fetch_add(alligned_size, std::memory_order_relaxed);
+  append_operations_counter_.fetch_add(parts, std::memory_order_relaxed);
 #ifdef SZD_PERF_PER_ZONE_COUNTERS
-    uint64_t left = alligned_size / lba_size_;
-    for (slba = TranslateLbaToPba(*lba); left != 0 && slba <= new_lba;
-         slba += zone_size_) {
-      uint64_t step = left > zone_cap_ ? zone_cap_ : left;
-      append_operations_[(slba - min_lba_) / zone_size_] +=
-          ((step * lba_size_ + zasl_ - 1) / zasl_);
-      left -= step;
-    }
+  CountZoneAppends(prev_lba, alligned_size / lba_size_);
 #endif
-  }
-#else
-  s = FromStatus(szd_append_async(qpair_, &new_lba, async_buffer_[writer],
-                                  alligned_size, completion_[writer]));
 #endif
-  outstanding_requests_++;
 
   *lba = TranslatePbaToLba(new_lba);
   return s;
 }
 
-bool SZDChannel::PollOnce(uint32_t writer) {
-  if (writer > queue_depth_) {
-    return false;
+SZDStatus SZDChannel::AsyncRead(uint64_t lba, void *buffer, uint64_t size,
+                                uint32_t reader, bool alligned) {
+  if (szd_unlikely(reader >= queue_depth_ || async_slots_[reader].busy)) {
+    SZD_LOG_ERROR("SZD: Channel: AsyncRead: Invalid reader\n");
+    return SZDStatus::InvalidArguments;
   }
-  if (completion_[writer] == nullptr) {
-    return true;
+  lba = TranslateLbaToPba(lba);
+  // Allign
+  uint64_t alligned_size = allign_size(size);
+  if (szd_unlikely(alligned_size > mdts_)) {
+    SZD_LOG_ERROR(
+        "SZD: Channel: AsyncRead: Reads larger than MDTS not supported\n");
+    return SZDStatus::InvalidArguments;
   }
-  szd_poll_once(qpair_, completion_[writer]);
-  if (completion_[writer]->done || completion_[writer]->err != 0) {
-    // Remove temporary buffer.
-    if (!keep_async_buffer_) {
-      szd_free(async_buffer_[writer]);
-      async_buffer_[writer] = nullptr;
+  // Check if in bounds...
+  uint64_t slba = (lba / zone_size_) * zone_size_;
+  if (szd_unlikely(slba < min_lba_ || slba + zone_size_ > max_lba_ ||
+                   lba - slba + alligned_size / lba_size_ > ZoneCapAt(slba) ||
+                   (alligned && size != alligned_size))) {
+    SZD_LOG_ERROR("SZD: Channel: AsyncRead: OOB\n");
+    return SZDStatus::InvalidArguments;
+  }
+  AsyncSlot *slot = &async_slots_[reader];
+  slot->completion = Completion_default;
+  slot->owner = reader;
+  slot->lba = lba;
+  slot->next = UINT32_MAX;
+  slot->parts_left = 1;
+  slot->read_buffer = nullptr;
+  slot->bounced = size != alligned_size ||
+                  !szd_dma_capable(qpair_->man, buffer, alligned_size);
+  void *buffer_dma = buffer;
+  if (slot->bounced) {
+    buffer_dma = GetAsyncBounce(reader, alligned_size);
+    if (szd_unlikely(buffer_dma == nullptr)) {
+      SZD_LOG_ERROR("SZD: Channel: AsyncRead: OOM\n");
+      return SZDStatus::MemoryError;
+    }
+    slot->read_buffer = buffer;
+    slot->read_size = size;
+  }
+  SZDStatus s = FromStatus(szd_read_async_cb(
+      qpair_, lba, buffer_dma, alligned_size, AsyncComplete, (void *)slot));
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Channel: AsyncRead: Could not submit\n");
+    if (slot->bounced) {
+      PutAsyncBounce(reader);
     }
-    delete completion_[writer];
-    completion_[writer] = nullptr;
-    outstanding_requests_--;
+    return s;
+  }
+  ClaimWriter(reader);
+#ifdef SZD_PERF_COUNTERS
+  bytes_read_.fetch_add(alligned_size, std::memory_order_relaxed);
+  read_operations_.fetch_add(1, std::memory_order_relaxed);
+#endif
+  return s;
+}
+
+bool SZDChannel::PollOnce(uint32_t writer) {
+  if (writer >= queue_depth_) {
+    return false;
+  }
+  if (!async_slots_[writer].busy) {
     return true;
   }
-  return false;
+  szd_poll_once_raw(qpair_);
+  return !async_slots_[writer].busy;
 }
 
 bool SZDChannel::FindFreeWriter(uint32_t *any_writer) {
-  szd_poll_once_raw(qpair_);
-  for (uint32_t i = 0; i < queue_depth_; i++) {
-    if (completion_[i] == nullptr) {
-      *any_writer = i;
-      return true;
-    }
-    if (completion_[i]->err != 0x0 || completion_[i]->done) {
-      // Remove temporary buffer.
-      if (!keep_async_buffer_) {
-        szd_free(async_buffer_[i]);
-        async_buffer_[i] = nullptr;
-      }
-      delete completion_[i];
-      completion_[i] = nullptr;
-      *any_writer = i;
-      outstanding_requests_--;
-      return true;
+  if (szd_unlikely(free_writers_count_ == 0)) {
+    szd_poll_once_raw(qpair_);
+    if (free_writers_count_ == 0) {
+      return false;
     }
   }
-  return false;
+  *any_writer = free_writers_[free_writers_count_ - 1];
+  return true;
 }
 
 SZDStatus SZDChannel::Sync() {
   SZDStatus s = SZDStatus::Success;
-  if (completion_ == nullptr) {
+  if (async_slots_ == nullptr) {
     return s;
   }
-  // poll
-  for (uint32_t i = 0; i < queue_depth_; i++) {
-    if (completion_[i] == nullptr) {
-      continue;
-    }
-    s = FromStatus(szd_poll_async(qpair_, completion_[i]));
-    if (szd_unlikely(s != SZDStatus::Success)) {
-      SZD_LOG_ERROR("SZD: Channel: Sync: Failed a poll\n");
-      break;
+  // poll, failed requests are recorded in async_err_
+  for (uint32_t i = 0; i < queue_depth_ && outstanding_requests_ > 0; i++) {
+    if (async_slots_[i].busy) {
+      szd_poll_async(qpair_, &async_slots_[i].completion);
     }
-    // Remove temporary buffer.
-    if (!keep_async_buffer_) {
-      szd_free(async_buffer_[i]);
-      async_buffer_[i] = nullptr;
-    }
-    delete completion_[i];
-    completion_[i] = nullptr;
-    outstanding_requests_--;
+  }
+  if (szd_unlikely(async_err_ != 0)) {
+    SZD_LOG_ERROR("SZD: Channel: Sync: Failed a request %x\n", async_err_);
+    async_err_ = 0;
+    s = FromStatus(SZD_SC_SPDK_ERROR_POLLING);
   }
   return s;
 }
@@ -575,23 +1122,57 @@ SZDStatus SZDChannel::ResetZone(uint64_t slba) {
   return s;
 }
 
-SZDStatus SZDChannel::ResetAllZones() {
-  SZDStatus s = SZDStatus::Success;
-  // If we can not access all, there is no partial reset; reset the partial
-  // zones one by one.
-  if (!can_access_all_) {
-    for (uint64_t slba = min_lba_; slba != max_lba_; slba += zone_size_) {
-      if ((s = FromStatus(szd_reset(qpair_, slba))) != SZDStatus::Success) {
-        SZD_LOG_ERROR("SZD: Channel: ResetAllZones: OOB\n");
-        return s;
-      }
+SZDStatus SZDChannel::ResetZones(uint64_t slba, uint64_t eslba,
+                                 std::vector<SZDStatus> *zone_status) {
+  slba = TranslateLbaToPba(slba);
+  eslba = TranslateLbaToPba(eslba);
+  if (szd_unlikely(slba < min_lba_ || eslba > max_lba_ || slba > eslba ||
+                   slba % zone_size_ != 0 || eslba % zone_size_ != 0)) {
+    SZD_LOG_ERROR("SZD: Channel: ResetZones: OOB\n");
+    return SZDStatus::InvalidArguments;
+  }
+  uint64_t zones = (eslba - slba) / zone_size_;
+  if (zone_status != nullptr) {
+    zone_status->assign(zones, SZDStatus::Success);
+  }
+  if (zones == 0) {
+    return SZDStatus::Success;
+  }
+  std::vector<uint64_t> slbas(zones);
+  std::vector<int> status(zones, SZD_SC_SUCCESS);
+  for (uint64_t zone = 0; zone < zones; zone++) {
+    slbas[zone] = slba + zone * zone_size_;
+  }
+  SZDStatus s =
+      FromStatus(szd_reset_many(qpair_, slbas.data(), zones, status.data()));
 #ifdef SZD_PERF_COUNTERS
-      zones_reset_counter_.fetch_add(1, std::memory_order_relaxed);
+  for (uint64_t zone = 0; zone < zones; zone++) {
+    if (status[zone] != SZD_SC_SUCCESS) {
+      continue;
+    }
+    zones_reset_counter_.fetch_add(1, std::memory_order_relaxed);
 #ifdef SZD_PERF_PER_ZONE_COUNTERS
-      zones_reset_[(slba - min_lba_) / zone_size_]++;
+    zones_reset_[(slbas[zone] - min_lba_) / zone_size_]++;
 #endif
+  }
 #endif
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Channel: ResetZones: Could not reset all zones\n");
+    if (zone_status != nullptr) {
+      for (uint64_t zone = 0; zone < zones; zone++) {
+        (*zone_status)[zone] = FromStatus(status[zone]);
+      }
     }
+  }
+  return s;
+}
+
+SZDStatus SZDChannel::ResetAllZones() {
+  SZDStatus s = SZDStatus::Success;
+  // If we can not access all, there is no partial reset; reset the partial
+  // zones in batches.
+  if (!can_access_all_) {
+    s = ResetZones(TranslatePbaToLba(min_lba_), TranslatePbaToLba(max_lba_));
   } else {
     s = FromStatus(szd_reset_all(qpair_));
 #ifdef SZD_PERF_COUNTERS
@@ -642,6 +1223,36 @@ SZDStatus SZDChannel::ZoneHeads(uint64_t slba, uint64_t eslba,
   return s;
 }
 
+SZDStatus SZDChannel::ZoneDescriptors(uint64_t slba, uint64_t eslba,
+                                      std::vector<ZoneDescriptor> *descs) {
+  slba = TranslateLbaToPba(slba);
+  eslba = TranslateLbaToPba(eslba);
+  if (szd_unlikely(slba < min_lba_ || slba >= max_lba_ || eslba >= max_lba_ ||
+                   eslba < slba)) {
+    SZD_LOG_ERROR("SZD: Channel: ZoneDescriptors: OOB\n");
+    return SZDStatus::InvalidArguments;
+  }
+  uint64_t desc_size = (eslba - slba) / zone_size_ + 1;
+  std::vector<ZoneDescriptor> descs_c(desc_size);
+  SZDStatus s = FromStatus(
+      szd_get_zone_descriptors(qpair_, slba, eslba, descs_c.data()));
+  if (szd_unlikely(s != SZDStatus::Success)) {
+    SZD_LOG_ERROR("SZD: Channel: ZoneDescriptors: error in retrieving\n");
+    return s;
+  }
+  for (ZoneDescriptor &desc : descs_c) {
+    if (desc.state == SZD_ZONE_FULL || desc.wp > desc.zslba + desc.zcap) {
+      desc.wp = desc.zslba + desc.zcap;
+    } else if (szd_unlikely(desc.wp < desc.zslba)) {
+      desc.wp = desc.zslba;
+    }
+    desc.wp = TranslatePbaToLba(desc.zslba) + (desc.wp - desc.zslba);
+    desc.zslba = TranslatePbaToLba(desc.zslba);
+    descs->push_back(desc);
+  }
+  return s;
+}
+
 SZDStatus SZDChannel::FinishZone(uint64_t slba) {
   slba = TranslateLbaToPba(slba);
   if (szd_unlikely(slba < min_lba_ || slba > max_lba_)) {
@@ -4,21 +4,31 @@
 #include "szd/szd_channel.hpp"
 #include "szd/szd_status.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace SIMPLE_ZNS_DEVICE_NAMESPACE {
 SZDChannelFactory::SZDChannelFactory(DeviceManager *device_manager,
-                                     size_t max_channel_count)
+                                     size_t max_channel_count,
+                                     SZDPlacement placement)
     : max_channel_count_(max_channel_count), channel_count_(0),
-      device_manager_(device_manager), refs_(0) {}
-SZDChannelFactory::~SZDChannelFactory() {}
+      device_manager_(device_manager), placement_(placement), refs_(0) {}
+SZDChannelFactory::~SZDChannelFactory() {
+  // Channels that outlive the factory keep their pool alive.
+  for (auto &pool : dma_pools_) {
+    szd_dma_pool_destroy(pool.second);
+  }
+}
 
-SZDStatus SZDChannelFactory::register_raw_qpair(QPair **qpair) {
+SZDStatus
+SZDChannelFactory::register_raw_qpair(QPair **qpair,
+                                      const QPairOptions &qpair_options) {
   if (channel_count_ >= max_channel_count_ || qpair == nullptr) {
     SZD_LOG_ERROR("SZD: Channel factory: Too many QPairs\n");
     return SZDStatus::InvalidArguments;
   }
-  SZDStatus s = FromStatus(szd_create_qpair(device_manager_, qpair));
+  SZDStatus s = FromStatus(
+      szd_create_qpair_with_options(device_manager_, qpair, &qpair_options));
   if (s == SZDStatus::Success) {
     channel_count_++;
   }
@@ -33,40 +43,49 @@ SZDStatus SZDChannelFactory::unregister_raw_qpair(QPair *qpair) {
   return s;
 }
 
-SZDStatus SZDChannelFactory::register_channel(SZDChannel **channel,
-                                              uint64_t min_zone_nr,
-                                              uint64_t max_zone_nr,
-                                              bool preserve_async_buffer,
-                                              uint32_t channel_depth) {
+SZDStatus SZDChannelFactory::register_channel(
+    SZDChannel **channel, uint64_t min_zone_nr, uint64_t max_zone_nr,
+    bool preserve_async_buffer, uint32_t channel_depth,
+    const QPairOptions &qpair_options) {
   if (channel_count_ >= max_channel_count_) {
     SZD_LOG_ERROR("SZD: Channel factory: Too many Channels\n");
     return SZDStatus::InvalidArguments;
   }
   SZDStatus s;
   QPair **qpair = new QPair *;
-  if ((s = FromStatus(szd_create_qpair(device_manager_, qpair))) !=
-      SZDStatus::Success) {
+  if ((s = FromStatus(szd_create_qpair_with_options(
+           device_manager_, qpair, &qpair_options))) != SZDStatus::Success) {
     SZD_LOG_ERROR("SZD: Channel factory: Could not create QPair\n");
+    delete qpair;
     return s;
   }
+  // The QPair would silently queue requests the channel thinks are in flight.
+  if (channel_depth > (*qpair)->options.io_queue_requests) {
+    SZD_LOG_ERROR("SZD: Channel factory: Channel deeper than QPair\n");
+    szd_destroy_qpair(*qpair);
+    delete qpair;
+    return SZDStatus::InvalidArguments;
+  }
+  int32_t socket_id = PlacementSocketId();
   *channel =
       new SZDChannel(std::unique_ptr<QPair>(*qpair), device_manager_->info,
                      min_zone_nr * device_manager_->info.zone_size,
                      max_zone_nr * device_manager_->info.zone_size,
-                     preserve_async_buffer, channel_depth);
+                     preserve_async_buffer, channel_depth, socket_id,
+                     DMAPoolOf(socket_id));
 
   channel_count_++;
   delete qpair;
   return SZDStatus::Success;
 }
 
-SZDStatus SZDChannelFactory::register_channel(SZDChannel **channel,
-                                              bool preserve_async_buffer,
-                                              uint32_t channel_depth) {
+SZDStatus SZDChannelFactory::register_channel(
+    SZDChannel **channel, bool preserve_async_buffer, uint32_t channel_depth,
+    const QPairOptions &qpair_options) {
   return register_channel(
       channel, device_manager_->info.min_lba / device_manager_->info.zone_size,
       device_manager_->info.max_lba / device_manager_->info.zone_size,
-      preserve_async_buffer, channel_depth);
+      preserve_async_buffer, channel_depth, qpair_options);
 }
 
 SZDStatus SZDChannelFactory::unregister_channel(SZDChannel *channel) {
@@ -74,4 +93,52 @@ SZDStatus SZDChannelFactory::unregister_channel(SZDChannel *channel) {
   channel_count_--;
   return SZDStatus::Success;
 }
+
+int32_t SZDChannelFactory::PlacementSocketId() const {
+  int32_t socket_id = SZD_SOCKET_ID_ANY;
+  switch (placement_) {
+  case SZDPlacement::Device:
+    if (szd_get_socket_id(device_manager_, &socket_id) != SZD_SC_SUCCESS) {
+      socket_id = SZD_SOCKET_ID_ANY;
+    }
+    break;
+  case SZDPlacement::Caller:
+    socket_id = szd_current_socket_id();
+    break;
+  case SZDPlacement::Any:
+    break;
+  }
+  return socket_id;
+}
+
+DMAPool *SZDChannelFactory::DMAPoolOf(int32_t socket_id) {
+  auto pool = dma_pools_.find(socket_id);
+  if (pool != dma_pools_.end()) {
+    return pool->second;
+  }
+  // Large enough for the biggest temporary buffer of a channel.
+  const DeviceInfo &info = device_manager_->info;
+  DMAPool *dma_pool;
+  if (szd_dma_pool_create(&dma_pool, info.lba_size,
+                          std::max(info.mdts, info.zasl) * MAX_PIPELINE_DEPTH,
+                          socket_id) != SZD_SC_SUCCESS) {
+    return nullptr;
+  }
+  dma_pools_[socket_id] = dma_pool;
+  return dma_pool;
+}
+
+uint64_t SZDChannelFactory::TranslateZoneToLba(uint64_t zone_nr) const {
+  const DeviceInfo &info = device_manager_->info;
+  // A zone starts where the zone before it ends, the first zone is not
+  // preceded by anything and zones outside of the device have the first cap.
+  uint64_t zone_cap_prefix[2];
+  if (zone_nr > 0 &&
+      szd_get_zone_cap_prefix(device_manager_, (zone_nr - 1) * info.zone_size,
+                              (zone_nr - 1) * info.zone_size,
+                              zone_cap_prefix) == SZD_SC_SUCCESS) {
+    return zone_cap_prefix[1];
+  }
+  return zone_nr * info.zone_cap;
+}
 } // namespace SIMPLE_ZNS_DEVICE_NAMESPACE
\ No newline at end of file
@@ -12,7 +12,8 @@ static bool dpdk_initialised = false;
 
 SZDDevice::SZDDevice(const std::string &application_name)
     : application_name_(application_name), initialised_device_(false),
-      device_opened_(false), manager_(new DeviceManager *), opened_device_() {}
+      device_opened_(false), manager_(new DeviceManager *), opened_device_(),
+      probed_(nullptr) {}
 
 SZDDevice::~SZDDevice() {
   if (initialised_device_ || device_opened_) {
@@ -21,9 +22,17 @@ SZDDevice::~SZDDevice() {
   delete manager_;
 }
 
-SZDStatus SZDDevice::Init() {
+SZDStatus SZDDevice::Init(bool emulated) { return Init(emulated, ""); }
+
+SZDStatus SZDDevice::Init(bool emulated, const std::string &bdev_config) {
+  // SZD keeps the config around for Reinit.
+  bdev_config_.assign(bdev_config);
   DeviceOptions opts = {.name = application_name_.data(),
-                        .setup_spdk = !dpdk_initialised};
+                        .setup_spdk = !dpdk_initialised,
+                        .emulated = emulated,
+                        .bdev_config = bdev_config_.empty()
+                                           ? nullptr
+                                           : bdev_config_.data()};
   SZDStatus s = FromStatus(szd_init(manager_, &opts));
   if (s == SZDStatus::Success) {
     initialised_device_ = true;
@@ -37,6 +46,7 @@ SZDStatus SZDDevice::Reinit() {
     SZD_LOG_ERROR("SZD: Device: Reinit: Not initialised\n");
     return SZDStatus::InvalidArguments;
   }
+  ReleaseProbed();
   SZDStatus s = FromStatus(szd_reinit(manager_));
   if (s == SZDStatus::Success) {
     initialised_device_ = true;
@@ -45,38 +55,86 @@ SZDStatus SZDDevice::Reinit() {
 }
 
 SZDStatus SZDDevice::Probe(std::vector<DeviceOpenInfo> &info) {
-  if (!initialised_device_) {
-    SZD_LOG_ERROR("SZD: Device: Probe: Invalid args\n");
+  // Releasing the previous probe needs a Reinit, which would close the device.
+  if (!initialised_device_ || device_opened_) {
+    SZD_LOG_ERROR("SZD: Device: Probe: Invalid args/state\n");
     return SZDStatus::InvalidArguments;
   }
-  ProbeInformation **prober = new ProbeInformation *;
-  SZDStatus s = FromStatus(szd_probe(*manager_, prober));
+  SZDStatus s = ReleaseProbedAndReinit();
+  if (s != SZDStatus::Success) {
+    return s;
+  }
+  // Controllers stay attached, so that Open does not need to probe again.
+  s = FromStatus(szd_probe_attached(*manager_, &probed_));
   if (s != SZDStatus::Success) {
     SZD_LOG_ERROR("SZD: Device: Probe: Failed probing\n");
+    ReleaseProbed();
     return s;
   }
-  for (uint8_t dev = 0; dev < (*prober)->devices; dev++) {
+  for (uint8_t dev = 0; dev < probed_->devices; dev++) {
     std::string trid;
-    trid.assign((*prober)->traddr[dev], strlen((*prober)->traddr[dev]));
-    info.push_back(
-        DeviceOpenInfo{.traddr = trid, .is_zns = (*prober)->zns[dev]});
-  }
-  szd_free_probe_information(*prober);
-  delete prober;
-  // Probe can leave SZD in a weird attached state (zombie devices).
-  s = Reinit();
+    trid.assign(probed_->traddr[dev], strlen(probed_->traddr[dev]));
+    info.push_back(DeviceOpenInfo{.traddr = trid, .is_zns = probed_->zns[dev]});
+  }
   return s;
 }
 
+void SZDDevice::ReleaseProbed() {
+  if (probed_ != nullptr) {
+    szd_free_probe_information(probed_);
+    probed_ = nullptr;
+  }
+}
+
+SZDStatus SZDDevice::ReleaseProbedAndReinit() {
+  if (probed_ == nullptr) {
+    return SZDStatus::Success;
+  }
+  ReleaseProbed();
+  // Detaching can leave SZD in a weird attached state (zombie devices).
+  return Reinit();
+}
+
 SZDStatus SZDDevice::Open(const std::string &device_name, uint64_t min_zone,
                           uint64_t max_zone) {
+  if (!initialised_device_ || device_opened_ || probed_ == nullptr) {
+    return Open(device_name, min_zone, max_zone, TransportOptions_default);
+  }
+  bool probed = false;
+  for (uint8_t dev = 0; dev < probed_->devices; dev++) {
+    probed = probed || (probed_->ctrlr[dev] != nullptr &&
+                        device_name == probed_->traddr[dev]);
+  }
+  if (!probed) {
+    return Open(device_name, min_zone, max_zone, TransportOptions_default);
+  }
+  // Take over the controller that Probe attached. The others stay attached
+  // until the device is closed, as detaching them needs a Reinit.
+  opened_device_.assign(device_name);
+  DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
+  SZDStatus s = FromStatus(
+      szd_open_probed(*manager_, probed_, opened_device_.data(), &oopts));
+  if (s == SZDStatus::Success) {
+    device_opened_ = true;
+  }
+  return s;
+}
+
+SZDStatus SZDDevice::Open(const std::string &device_name, uint64_t min_zone,
+                          uint64_t max_zone,
+                          const TransportOptions &transport_options) {
   if (!initialised_device_ || device_opened_) {
     SZD_LOG_ERROR("SZD: Device: Open: Invalid args/state\n");
     return SZDStatus::InvalidArguments;
   }
+  SZDStatus s = ReleaseProbedAndReinit();
+  if (s != SZDStatus::Success) {
+    return s;
+  }
   opened_device_.assign(device_name);
   DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
-  SZDStatus s = FromStatus(szd_open(*manager_, opened_device_.data(), &oopts));
+  s = FromStatus(szd_open_transport(*manager_, opened_device_.data(),
+                                    &transport_options, &oopts));
   if (s == SZDStatus::Success) {
     device_opened_ = true;
   }
@@ -87,12 +145,103 @@ SZDStatus SZDDevice::Open(const std::string &device_name) {
   return Open(device_name, 0, 0);
 }
 
+SZDStatus SZDDevice::OpenGroup(const std::vector<std::string> &device_names,
+                               uint64_t min_zone, uint64_t max_zone) {
+  if (!initialised_device_ || device_opened_ || device_names.empty() ||
+      device_names.size() > MAX_GROUP_DEVICES) {
+    SZD_LOG_ERROR("SZD: Device: OpenGroup: Invalid args/state\n");
+    return SZDStatus::InvalidArguments;
+  }
+  // Members are opened with szd_open, they can not be attached already.
+  SZDStatus s = ReleaseProbedAndReinit();
+  if (s != SZDStatus::Success) {
+    return s;
+  }
+  opened_group_ = device_names;
+  opened_device_.assign(device_names[0]);
+  std::vector<const char *> traddrs;
+  for (const std::string &name : opened_group_) {
+    traddrs.push_back(name.data());
+  }
+  DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
+  s = FromStatus(szd_open_group(*manager_, traddrs.data(),
+                                static_cast<uint32_t>(traddrs.size()), &oopts));
+  if (s == SZDStatus::Success) {
+    device_opened_ = true;
+  }
+  return s;
+}
+
+SZDStatus SZDDevice::OpenGroup(const std::vector<std::string> &device_names) {
+  return OpenGroup(device_names, 0, 0);
+}
+
+SZDStatus SZDDevice::OpenEmulated(const EmuOptions &emu_options,
+                                  uint64_t min_zone, uint64_t max_zone) {
+  if (!initialised_device_ || device_opened_) {
+    SZD_LOG_ERROR("SZD: Device: OpenEmulated: Invalid args/state\n");
+    return SZDStatus::InvalidArguments;
+  }
+  opened_device_.assign(emu_options.path != nullptr ? emu_options.path
+                                                    : "emulated");
+  DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
+  SZDStatus s = FromStatus(szd_open_emu(*manager_, &emu_options, &oopts));
+  if (s == SZDStatus::Success) {
+    device_opened_ = true;
+  }
+  return s;
+}
+
+SZDStatus SZDDevice::OpenEmulated(const EmuOptions &emu_options) {
+  return OpenEmulated(emu_options, 0, 0);
+}
+
+SZDStatus
+SZDDevice::OpenGroupEmulated(const std::vector<EmuOptions> &emu_options,
+                             uint64_t min_zone, uint64_t max_zone) {
+  if (!initialised_device_ || device_opened_ || emu_options.empty() ||
+      emu_options.size() > MAX_GROUP_DEVICES) {
+    SZD_LOG_ERROR("SZD: Device: OpenGroupEmulated: Invalid args/state\n");
+    return SZDStatus::InvalidArguments;
+  }
+  opened_device_.assign("emulated");
+  DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
+  SZDStatus s = FromStatus(
+      szd_open_group_emu(*manager_, emu_options.data(),
+                         static_cast<uint32_t>(emu_options.size()), &oopts));
+  if (s == SZDStatus::Success) {
+    device_opened_ = true;
+  }
+  return s;
+}
+
+SZDStatus SZDDevice::OpenBdev(const std::string &bdev_name, uint64_t min_zone,
+                              uint64_t max_zone) {
+  if (!initialised_device_ || device_opened_) {
+    SZD_LOG_ERROR("SZD: Device: OpenBdev: Invalid args/state\n");
+    return SZDStatus::InvalidArguments;
+  }
+  opened_device_.assign(bdev_name);
+  DeviceOpenOptions oopts = {.min_zone = min_zone, .max_zone = max_zone};
+  SZDStatus s =
+      FromStatus(szd_open_bdev(*manager_, opened_device_.data(), &oopts));
+  if (s == SZDStatus::Success) {
+    device_opened_ = true;
+  }
+  return s;
+}
+
+SZDStatus SZDDevice::OpenBdev(const std::string &bdev_name) {
+  return OpenBdev(bdev_name, 0, 0);
+}
+
 SZDStatus SZDDevice::Close() {
   if (!initialised_device_ || !device_opened_) {
     SZD_LOG_ERROR("SZD: Device: Close: Nothing to close\n");
     return SZDStatus::InvalidArguments;
   }
   device_opened_ = false;
+  opened_group_.clear();
   return FromStatus(szd_close(*manager_));
 }
 
@@ -110,6 +259,7 @@ SZDStatus SZDDevice::Destroy() {
     SZD_LOG_ERROR("SZD: Device: Destroy: Not initialised\n");
     return SZDStatus::InvalidArguments;
   }
+  ReleaseProbed();
   SZDStatus s = FromStatus(szd_destroy(*manager_));
   device_opened_ = false;
   initialised_device_ = false;
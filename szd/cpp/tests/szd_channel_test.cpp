@@ -6,7 +6,10 @@
 #include <szd/szd_device.hpp>
 #include <szd/szd_status.hpp>
 
+#include <algorithm>
 #include <numeric>
+#include <pthread.h>
+#include <sched.h>
 #include <string>
 #include <vector>
 
@@ -152,6 +155,77 @@ TEST_F(SZDChannelTest, TranslateAddress) {
   factory.unregister_channel(channel);
 }
 
+TEST_F(SZDChannelTest, TranslateAddressMixedCapacity) {
+  SZD::SZDDevice dev("TranslateAddressMixedCapacity");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+
+  // Mock a device whose zones differ in capacity, by shrinking zones in the
+  // zone state table (zones can always be written less than the capacity).
+  SZD::DeviceManagerInternal *private_ =
+      (SZD::DeviceManagerInternal *)dev.GetDeviceManager()->private_;
+  ASSERT_EQ(private_->zone_min_, begin_zone);
+  std::vector<uint64_t> caps(end_zone - begin_zone, info.zone_cap);
+  caps[1] = info.zone_cap / 2;
+  caps[3] = info.zone_cap - 10;
+  for (size_t zone = 0; zone < caps.size(); zone++) {
+    private_->zone_cap_[zone] = caps[zone];
+  }
+  __zone_table_build_prefix(dev.GetDeviceManager());
+  factory.register_channel(&channel, begin_zone, end_zone);
+
+  // Each zone starts right after the capacity of the previous one.
+  uint64_t zone_lba = begin_zone * info.zone_cap;
+  for (size_t zone = 0; zone < caps.size(); zone++) {
+    uint64_t zone_pba = (begin_zone + zone) * info.zone_size;
+    ASSERT_EQ(factory.TranslateZoneToLba(begin_zone + zone), zone_lba);
+    for (uint64_t offset : {0UL, 1UL, caps[zone] - 1}) {
+      ASSERT_EQ(channel->TranslateLbaToPba(zone_lba + offset),
+                zone_pba + offset);
+      ASSERT_EQ(channel->TranslatePbaToLba(zone_pba + offset),
+                zone_lba + offset);
+    }
+    ASSERT_EQ(channel->ZoneStartLba(zone_lba + caps[zone] - 1), zone_lba);
+    ASSERT_EQ(channel->ZoneEndLba(zone_lba), zone_lba + caps[zone]);
+    zone_lba += caps[zone];
+  }
+
+  // I/O follows the capacities, this write crosses the shrunk zone.
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  uint64_t range = (info.zone_cap + caps[1] + 2) * info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferw(range);
+  SZDTestUtil::RAIICharBuffer bufferr(range);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  uint64_t write_head = begin_zone * info.zone_cap;
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, factory.TranslateZoneToLba(begin_zone + 2) + 2);
+  ASSERT_EQ(channel->DirectRead(begin_zone * info.zone_cap, bufferr.buff_,
+                                range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+  // The data of the shrunk zone ends at its capacity.
+  ASSERT_EQ(channel->DirectRead(factory.TranslateZoneToLba(begin_zone + 2),
+                                bufferr.buff_, info.lba_size, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_ + (range - 2 * info.lba_size),
+                     bufferr.buff_, info.lba_size) == 0);
+  // So does the tail of a read into DMA memory that is not a whole lba.
+  uint64_t dma_range = range - info.lba_size / 2;
+  SZD::SZDBuffer dma_buffer(dma_range, info.lba_size);
+  char *raw_dma_buffer = nullptr;
+  ASSERT_EQ(dma_buffer.GetBuffer((void **)&raw_dma_buffer),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->DirectRead(begin_zone * info.zone_cap, raw_dma_buffer,
+                                dma_range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, raw_dma_buffer, dma_range) == 0);
+
+  factory.unregister_channel(channel);
+}
+
 TEST_F(SZDChannelTest, DirectIO) {
   SZD::SZDDevice dev("DirectIO");
   SZD::DeviceInfo info;
@@ -177,6 +251,10 @@ TEST_F(SZDChannelTest, DirectIO) {
   uint64_t begin_lba = begin_zone * info.zone_cap;
   uint64_t write_head = begin_lba;
   uint64_t range = info.lba_size * info.zone_cap + info.lba_size * 2;
+  ASSERT_EQ(channel->ZoneStartLba(begin_lba + 3), begin_lba);
+  ASSERT_EQ(channel->ZoneEndLba(begin_lba), begin_lba + info.zone_cap);
+  ASSERT_EQ(channel->ZoneStartLba(begin_lba + info.zone_cap),
+            begin_lba + info.zone_cap);
   SZDTestUtil::RAIICharBuffer bufferw(range + 1);
   SZDTestUtil::RAIICharBuffer bufferr(range + 1);
   SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
@@ -279,6 +357,216 @@ TEST_F(SZDChannelTest, DirectIO) {
   factory.unregister_channel(channel);
 }
 
+TEST_F(SZDChannelTest, PipelinedIO) {
+  SZD::SZDDevice dev("PipelinedIO");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel);
+  channel->SetPipelineDepth(4);
+  ASSERT_EQ(channel->GetPipelineDepth(), 4);
+
+  // Have to reset for a clean state
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Write 1 zone and 2 lbas and verify if this data can be read.
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_lba;
+  uint64_t range = info.lba_size * info.zone_cap + info.lba_size * 2;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_lba + info.zone_cap + 2);
+  ASSERT_EQ(channel->DirectRead(begin_lba, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  // The same for DMA buffers
+  SZD::SZDBuffer buffer(range, info.lba_size);
+  char *raw_buffer = nullptr;
+  ASSERT_EQ(buffer.GetBuffer((void **)&raw_buffer), SZD::SZDStatus::Success);
+  ASSERT_NE(raw_buffer, nullptr);
+  memcpy(raw_buffer, bufferw.buff_, range);
+  ASSERT_EQ(channel->FlushBuffer(&write_head, buffer), SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_lba + 2 * (info.zone_cap + 2));
+  memset(raw_buffer, 0, range);
+  ASSERT_EQ(channel->ReadIntoBuffer(begin_lba + info.zone_cap + 2, &buffer, 0,
+                                    range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, raw_buffer, range) == 0);
+
+  // Depth is clamped
+  channel->SetPipelineDepth(0);
+  ASSERT_EQ(channel->GetPipelineDepth(), 1);
+  channel->SetPipelineDepth(MAX_PIPELINE_DEPTH + 1);
+  ASSERT_EQ(channel->GetPipelineDepth(), MAX_PIPELINE_DEPTH);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, PipelinedAppendError) {
+  SZD::SZDDevice dev("PipelinedAppendError");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel);
+  channel->SetPipelineDepth(4);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Leave 2 lbas in the first zone and make the next zone fail appends.
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t next_zone_lba = begin_lba + info.zone_cap;
+  uint64_t write_head = begin_lba;
+  uint64_t range = (info.zone_cap - 2) * info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 2 * info.zasl);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range + 2 * info.zasl, 0);
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->FinishZone(next_zone_lba), SZD::SZDStatus::Success);
+
+  // The appends in the first zone land, the head ends after them.
+  ASSERT_NE(channel->DirectAppend(&write_head, bufferw.buff_,
+                                  2 * info.lba_size + 2 * info.zasl, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, next_zone_lba);
+  std::vector<uint64_t> zone_heads;
+  ASSERT_EQ(channel->ZoneHeads(begin_lba, begin_lba, &zone_heads),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(zone_heads[0], next_zone_lba);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, BounceRing) {
+  SZD::SZDDevice dev("BounceRing");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel, false, 2);
+  // One slot for each writer and one for synchronous I/O, allocated when I/O
+  // first bounces.
+  ASSERT_EQ(channel->GetBounceRingSize(), 3);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_lba;
+  uint64_t range = info.zasl * 2 + info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  // Synchronous and async I/O share the ring, without and with slots to spare.
+  for (uint32_t slots : {3u, 0u, 1u, 2u + MAX_PIPELINE_DEPTH}) {
+    ASSERT_EQ(channel->SetBounceRingSize(slots), SZD::SZDStatus::Success);
+    ASSERT_EQ(channel->GetBounceRingSize(), slots);
+    channel->SetPipelineDepth(slots == 0 ? 1 : MAX_PIPELINE_DEPTH);
+    uint64_t lba = write_head;
+    ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, false),
+              SZD::SZDStatus::Success);
+    memset(bufferr.buff_, 0, range);
+    ASSERT_EQ(channel->DirectRead(lba, bufferr.buff_, range, false),
+              SZD::SZDStatus::Success);
+    ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+    lba = write_head;
+    ASSERT_EQ(
+        channel->AsyncAppend(&write_head, bufferw.buff_, info.lba_size, 0),
+        SZD::SZDStatus::Success);
+    // The ring can not change under outstanding requests.
+    ASSERT_NE(channel->SetBounceRingSize(slots), SZD::SZDStatus::Success);
+    ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+    memset(bufferr.buff_, 0, range);
+    ASSERT_EQ(channel->DirectRead(lba, bufferr.buff_, info.lba_size, true),
+              SZD::SZDStatus::Success);
+    ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, info.lba_size) == 0);
+  }
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, ZeroCopyIO) {
+  SZD::SZDDevice dev("ZeroCopyIO");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // DMA memory with a tail that is not a whole lba.
+  uint64_t range = info.lba_size * 3 + info.lba_size / 2;
+  SZD::SZDBuffer bufferw(range, info.lba_size);
+  SZD::SZDBuffer bufferr(range, info.lba_size);
+  char *raw_bufferw = nullptr;
+  char *raw_bufferr = nullptr;
+  ASSERT_EQ(bufferw.GetBuffer((void **)&raw_bufferw), SZD::SZDStatus::Success);
+  ASSERT_EQ(bufferr.GetBuffer((void **)&raw_bufferr), SZD::SZDStatus::Success);
+  ASSERT_TRUE(szd_dma_capable(dev.GetDeviceManager(), raw_bufferw, range));
+  ASSERT_FALSE(szd_dma_capable(dev.GetDeviceManager(), raw_bufferw + 1, 4));
+  // Memory SPDK does not know bounces, also on the emulator.
+  std::vector<char> heap_buffer(range);
+  ASSERT_FALSE(
+      szd_dma_capable(dev.GetDeviceManager(), heap_buffer.data(), range));
+  SZDTestUtil::CreateCyclicPattern(raw_bufferw, range, 0);
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_lba;
+  ASSERT_EQ(channel->DirectAppend(&write_head, raw_bufferw, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_lba + 4);
+  ASSERT_EQ(channel->DirectRead(begin_lba, raw_bufferr, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(raw_bufferw, raw_bufferr, range) == 0);
+  // The tail is padded with zeroes.
+  SZDTestUtil::RAIICharBuffer tail(info.lba_size);
+  ASSERT_EQ(channel->DirectRead(begin_lba + 3, tail.buff_, info.lba_size, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(tail.buff_[info.lba_size - 1], 0);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, WaitPolicy) {
+  SZD::SZDDevice dev("WaitPolicy");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel);
+  ASSERT_EQ(channel->GetWaitPolicy(), SZD::SZD_WAIT_SPIN);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  // Spinning is not counted
+  ASSERT_EQ(channel->GetWaitStats().waits, 0u);
+
+  channel->SetWaitPolicy(SZD::SZD_WAIT_HYBRID);
+  ASSERT_EQ(channel->GetWaitPolicy(), SZD::SZD_WAIT_HYBRID);
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_lba;
+  uint64_t range = info.lba_size * 4;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  for (uint64_t i = 0; i < 8; i++) {
+    ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+              SZD::SZDStatus::Success);
+    ASSERT_EQ(channel->DirectRead(begin_lba + i * 4, bufferr.buff_, range,
+                                  true),
+              SZD::SZDStatus::Success);
+    ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+  }
+  ASSERT_EQ(channel->ResetZone(begin_lba), SZD::SZDStatus::Success);
+  SZD::WaitStats stats = channel->GetWaitStats();
+  ASSERT_GE(stats.waits, 17u);
+  ASSERT_GT(stats.ewma_ns[SZD::SZD_WAIT_OP_APPEND], 0u);
+  ASSERT_GT(stats.ewma_ns[SZD::SZD_WAIT_OP_READ], 0u);
+  ASSERT_GT(stats.ewma_ns[SZD::SZD_WAIT_OP_RESET], 0u);
+
+  factory.unregister_channel(channel);
+}
+
 TEST_F(SZDChannelTest, DirectIONonAlligned) {
   SZD::SZDDevice dev("DirectIONonAlligned");
   SZD::DeviceInfo info;
@@ -557,6 +845,27 @@ TEST_F(SZDChannelTest, ResetZone) {
             SZD::SZDStatus::Success);
   ASSERT_EQ(zone_head, (begin_zone + 4) * info.zone_cap);
 
+  // Reset the last 2 zones in one batch
+  ASSERT_EQ(channel->ResetZones((begin_zone + 2) * info.zone_cap,
+                                (begin_zone + 4) * info.zone_cap),
+            SZD::SZDStatus::Success);
+  diag_reset_ops += 2;
+  resets[2]++;
+  resets[3]++;
+  ASSERT_EQ(channel->ZoneHead((begin_zone + 3) * info.zone_cap, &zone_head),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(zone_head, (begin_zone + 3) * info.zone_cap);
+  ASSERT_EQ(channel->ZoneHead(begin_zone * info.zone_cap, &zone_head),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(zone_head, (begin_zone + 1) * info.zone_cap);
+  // Batches must be zone alligned and in range
+  ASSERT_EQ(channel->ResetZones(begin_zone * info.zone_cap + 1,
+                                (begin_zone + 1) * info.zone_cap),
+            SZD::SZDStatus::InvalidArguments);
+  ASSERT_EQ(channel->ResetZones(begin_zone * info.zone_cap,
+                                (end_zone + 1) * info.zone_cap),
+            SZD::SZDStatus::InvalidArguments);
+
 // Yes, we need to test our diagnostics as well
 #ifdef SZD_PERF_COUNTERS
   ASSERT_EQ(channel->GetBytesWritten(), diag_bytes_written);
@@ -685,6 +994,266 @@ TEST_F(SZDChannelTest, FinishZone) {
   factory.unregister_channel(channel);
 }
 
+TEST_F(SZDChannelTest, DeviceGroup) {
+  SZD::SZDDevice dev("DeviceGroup");
+  SZD::DeviceInfo info;
+  size_t members;
+  SZDTestUtil::SZDSetupDeviceGroup(begin_zone, end_zone, &dev, &info,
+                                   &members);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel);
+  channel->SetPipelineDepth(4);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Write 2 zones and 2 lbas, the zones are on different members.
+  uint64_t begin_lba = factory.TranslateZoneToLba(begin_zone);
+  uint64_t write_head = begin_lba;
+  uint64_t lbas = channel->ZoneEndLba(begin_lba) - begin_lba;
+  lbas += channel->ZoneEndLba(begin_lba + lbas) - (begin_lba + lbas) + 2;
+  uint64_t range = info.lba_size * lbas;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_lba + lbas);
+  ASSERT_EQ(channel->DirectRead(begin_lba, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  // Zone z of the group is zone z / members of member z % members. The group
+  // test needs two ZNS devices or the emulator.
+  ASSERT_GE(members, 2u);
+  const SZD::DeviceManagerInternal *group =
+      static_cast<const SZD::DeviceManagerInternal *>(
+          dev.GetDeviceManager()->private_);
+  ASSERT_EQ(group->group_size_, members);
+  uint64_t written_zones = (lbas + info.zone_cap - 1) / info.zone_cap;
+  char *member_buffer =
+      static_cast<char *>(SZD::szd_calloc(info.lba_size, info.zone_cap,
+                                          info.lba_size));
+  ASSERT_NE(member_buffer, nullptr);
+  for (uint64_t i = 0; i < written_zones; i++) {
+    uint64_t zone = begin_zone + i;
+    uint64_t zone_lbas = std::min(info.zone_cap, lbas - i * info.zone_cap);
+    SZD::DeviceManager *member = group->group_[zone % members];
+    uint64_t member_lba = (zone / members) * info.zone_size;
+    SZD::QPair *member_qpair;
+    ASSERT_EQ(SZD::szd_create_qpair(member, &member_qpair),
+              SZD::SZD_SC_SUCCESS);
+    ASSERT_EQ(SZD::szd_read(member_qpair, member_lba, member_buffer,
+                            zone_lbas * info.lba_size),
+              SZD::SZD_SC_SUCCESS);
+    ASSERT_TRUE(memcmp(bufferw.buff_ + i * info.zone_cap * info.lba_size,
+                       member_buffer, zone_lbas * info.lba_size) == 0);
+    // The member itself reports the head, not the table of the group.
+    ASSERT_EQ(SZD::szd_refresh_zone_table(member_qpair), SZD::SZD_SC_SUCCESS);
+    uint64_t member_head;
+    ASSERT_EQ(SZD::szd_get_zone_head(member_qpair, member_lba, &member_head),
+              SZD::SZD_SC_SUCCESS);
+    ASSERT_EQ(member_head, zone_lbas == info.zone_cap
+                               ? member_lba + info.zone_size
+                               : member_lba + zone_lbas);
+    ASSERT_EQ(SZD::szd_destroy_qpair(member_qpair), SZD::SZD_SC_SUCCESS);
+  }
+  SZD::szd_free(member_buffer);
+
+  // Heads are translated back from the members
+  uint64_t third_lba = factory.TranslateZoneToLba(begin_zone + 2);
+  std::vector<uint64_t> heads;
+  ASSERT_EQ(channel->ZoneHeads(begin_lba, third_lba, &heads),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(heads.size(), 3u);
+  ASSERT_EQ(heads[2], third_lba + 2);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  heads.clear();
+  ASSERT_EQ(channel->ZoneHeads(begin_lba, third_lba, &heads),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(heads[2], third_lba);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, QPairOptions) {
+  SZD::SZDDevice dev("QPairOptions");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 2);
+  SZD::QPairOptions options = SZD::QPairOptions_default;
+  options.io_queue_size = 16;
+  options.io_queue_requests = 8;
+  options.delay_cmd_submit = true;
+
+  // Requests are at least the queue size
+  SZD::QPair *qpair;
+  ASSERT_EQ(factory.register_raw_qpair(&qpair, options),
+            SZD::SZDStatus::Success);
+  ASSERT_LE(qpair->options.io_queue_size, 16u);
+  ASSERT_EQ(qpair->options.io_queue_requests, qpair->options.io_queue_size);
+  ASSERT_TRUE(qpair->options.delay_cmd_submit);
+  ASSERT_EQ(factory.unregister_raw_qpair(qpair), SZD::SZDStatus::Success);
+
+  // A channel can not be deeper than its QPair
+  SZD::SZDChannel *channel;
+  options.io_queue_requests = 16;
+  ASSERT_EQ(factory.register_channel(&channel, true, 32, options),
+            SZD::SZDStatus::InvalidArguments);
+  ASSERT_EQ(factory.register_channel(&channel, true, 4, options),
+            SZD::SZDStatus::Success);
+
+  // Batched doorbells still complete
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  uint64_t range = info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  uint64_t begin_head = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_head;
+  for (uint32_t i = 0; i < 4; i++) {
+    ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, range, i),
+              SZD::SZDStatus::Success);
+  }
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_head + 4);
+  ASSERT_EQ(channel->DirectRead(begin_head + 3, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, CopyRanges) {
+  SZD::SZDDevice dev("CopyRanges");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  ASSERT_EQ(factory.register_channel(&channel), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Fill the start of two zones
+  uint64_t range = info.lba_size * 4;
+  SZDTestUtil::RAIICharBuffer bufferw(range * 2 + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range * 2, 0);
+  uint64_t first_head = begin_zone * info.zone_cap;
+  uint64_t second_head = (begin_zone + 1) * info.zone_cap;
+  uint64_t write_head = first_head;
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+  write_head = second_head;
+  ASSERT_EQ(
+      channel->DirectAppend(&write_head, bufferw.buff_ + range, range, true),
+      SZD::SZDStatus::Success);
+
+  // Copy parts of both, in order, to a third zone
+  uint64_t third_head = (begin_zone + 2) * info.zone_cap;
+  write_head = third_head;
+  std::vector<SZD::CopyRange> ranges = {{first_head + 1, 2}, {second_head, 2}};
+  ASSERT_EQ(channel->CopyRanges(ranges, &write_head), SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, third_head + 4);
+  ASSERT_EQ(channel->DirectRead(third_head, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferr.buff_, bufferw.buff_ + info.lba_size,
+                     info.lba_size * 2) == 0);
+  ASSERT_TRUE(memcmp(bufferr.buff_ + info.lba_size * 2, bufferw.buff_ + range,
+                     info.lba_size * 2) == 0);
+
+  // Out of range sources are not copied
+  ranges = {{end_zone * info.zone_cap, 1}};
+  ASSERT_EQ(channel->CopyRanges(ranges, &write_head),
+            SZD::SZDStatus::InvalidArguments);
+  ASSERT_EQ(write_head, third_head + 4);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, Placement) {
+  SZD::SZDDevice dev("Placement");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  int32_t device_socket;
+  ASSERT_EQ(szd_get_socket_id(dev.GetDeviceManager(), &device_socket),
+            SZD::SZD_SC_SUCCESS);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1,
+                                 SZD::SZDPlacement::Device);
+  SZD::SZDChannel *channel;
+  ASSERT_EQ(factory.register_channel(&channel, true, 2),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->GetSocketId(), device_socket);
+
+  // Buffers on the node of the device work as any other
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  uint64_t range = info.lba_size * 3 + 7;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  uint64_t begin_head = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_head;
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, info.lba_size, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->DirectRead(begin_head, bufferr.buff_, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+  // SZDBuffers can be placed with the channel, also when they grow
+  SZD::SZDBuffer buffer(info.lba_size, info.lba_size, channel->GetSocketId());
+  ASSERT_EQ(buffer.GetSocketId(), device_socket);
+  ASSERT_EQ(buffer.ReallocBuffer(range), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->ReadIntoBuffer(begin_head, &buffer, 0, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(buffer.ReadFromBuffer(bufferr.buff_, 0, range),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, PlacementCaller) {
+  SZD::SZDDevice dev("PlacementCaller");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1,
+                                 SZD::SZDPlacement::Caller);
+  ASSERT_EQ(factory.GetPlacement(), SZD::SZDPlacement::Caller);
+
+  // Stay on one cpu while registering, so that the node can not change.
+  cpu_set_t old_set;
+  ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(old_set), &old_set),
+            0);
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(sched_getcpu(), &set);
+  ASSERT_EQ(pthread_setaffinity_np(pthread_self(), sizeof(set), &set), 0);
+  int32_t caller_socket = SZD::szd_current_socket_id();
+  SZD::SZDChannel *channel;
+  SZD::SZDStatus s = factory.register_channel(&channel, true, 2);
+  ASSERT_EQ(pthread_setaffinity_np(pthread_self(), sizeof(old_set), &old_set),
+            0);
+  ASSERT_EQ(s, SZD::SZDStatus::Success);
+  ASSERT_TRUE(caller_socket == SZD_SOCKET_ID_ANY || caller_socket >= 0);
+  ASSERT_EQ(channel->GetSocketId(), caller_socket);
+
+  // Buffers on the node of the caller work as any other
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+  uint64_t range = info.lba_size * 3 + 7;
+  SZDTestUtil::RAIICharBuffer bufferw(range + 1);
+  SZDTestUtil::RAIICharBuffer bufferr(range + 1);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  uint64_t begin_head = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_head;
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->DirectRead(begin_head, bufferr.buff_, range, false),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  factory.unregister_channel(channel);
+}
+
 // Note that testing async is non-trivial. We only test easy paths.
 TEST_F(SZDChannelTest, AsyncTest) {
   SZD::SZDDevice dev("AsyncTest");
@@ -732,6 +1301,10 @@ TEST_F(SZDChannelTest, AsyncTest) {
   ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, range, 4),
             SZD::SZDStatus::Success);
   ASSERT_EQ(channel->GetOutstandingRequests(), 3);
+  // Busy writers are not handed out
+  ASSERT_TRUE(channel->FindFreeWriter(&any_writer));
+  ASSERT_TRUE(any_writer != 0 && any_writer != 1 && any_writer != 4);
+  ASSERT_EQ(channel->PollOnce(any_writer), true);
   diag_bytes_written += 3 * range;
   diag_append_ops += 3;
   appends[0] += 3;
@@ -767,9 +1340,30 @@ TEST_F(SZDChannelTest, AsyncTest) {
   ASSERT_NE(channel->AsyncAppend(&write_head, bufferw.buff_, range, 8),
             SZD::SZDStatus::Success);
 
-  // We can not write more than ZASL
-  ASSERT_NE(channel->AsyncAppend(&write_head, bufferw.buff_,
-                                 info.zasl + info.lba_size, 0),
+  // Writes of more than ZASL take multiple writers
+  uint64_t large_range = info.zasl + info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferl(large_range);
+  SZDTestUtil::CreateCyclicPattern(bufferl.buff_, large_range, 0);
+  ASSERT_EQ(channel->AsyncAppendParts(write_head, large_range), 2);
+  uint64_t large_head = write_head;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferl.buff_, large_range, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->GetOutstandingRequests(), 2);
+  // writer 0 completes only when both parts do
+  while (!channel->PollOnce(0u))
+    ;
+  ASSERT_EQ(channel->GetOutstandingRequests(), 0);
+  ASSERT_EQ(write_head, large_head + large_range / info.lba_size);
+  diag_bytes_written += large_range;
+  diag_append_ops += 2;
+  appends[0] += 2;
+  SZDTestUtil::RAIICharBuffer bufferr(large_range);
+  ASSERT_EQ(channel->DirectRead(large_head, bufferr.buff_, large_range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferl.buff_, bufferr.buff_, large_range) == 0);
+  // But not more writers than the queue depth
+  ASSERT_NE(channel->AsyncAppend(&write_head, bufferl.buff_,
+                                 8 * info.zasl + info.lba_size, 0),
             SZD::SZDStatus::Success);
 
   // We can not write across borders
@@ -792,14 +1386,25 @@ TEST_F(SZDChannelTest, AsyncTest) {
                       begin_zone * info.zone_cap,
                       begin_zone * info.zone_cap + info.zone_cap - 1,
                       info.zone_cap, info.zasl / info.lba_size);
-  ASSERT_NE(channel->AsyncAppend(&write_head, bufferw.buff_, range, 0),
+  // Writes across borders are split as well
+  uint64_t border_head = write_head;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, range, 0),
             SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, border_head + range / info.lba_size);
+  ASSERT_EQ(channel->DirectRead(border_head, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+  diag_bytes_written += range;
+  diag_append_ops += 2;
+  appends[0] += 1;
+  appends[1] += 1;
   ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, info.lba_size, 0),
             SZD::SZDStatus::Success);
   ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
   diag_bytes_written += info.lba_size;
   diag_append_ops += 1;
-  appends[0] += 1;
+  appends[1] += 1;
 
 // Yes, we need to test our diagnostics as well
 #ifdef SZD_PERF_COUNTERS
@@ -818,6 +1423,187 @@ TEST_F(SZDChannelTest, AsyncTest) {
   factory.unregister_channel(channel);
 }
 
+TEST_F(SZDChannelTest, AsyncAppendInOrder) {
+  SZD::SZDDevice dev("AsyncAppendInOrder");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel, false, 8);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Parts in one zone are submitted one after the other, so they land in
+  // order.
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t range = 4 * info.zasl;
+  SZDTestUtil::RAIICharBuffer bufferw(range);
+  SZDTestUtil::RAIICharBuffer bufferr(range);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  ASSERT_EQ(channel->AsyncAppendParts(begin_lba, range), 4);
+  uint64_t write_head = begin_lba;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, range, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(write_head, begin_lba + range / info.lba_size);
+  ASSERT_EQ(channel->GetOutstandingRequests(), 4);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->GetOutstandingRequests(), 0);
+  uint64_t zone_head;
+  ASSERT_EQ(channel->ZoneHead(begin_lba, &zone_head), SZD::SZDStatus::Success);
+  ASSERT_EQ(zone_head, write_head);
+  ASSERT_EQ(channel->DirectRead(begin_lba, bufferr.buff_, range, true),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  // When a part fails, the parts after it in the zone are not submitted.
+  uint64_t next_lba = begin_lba + info.zone_cap;
+  ASSERT_EQ(channel->FinishZone(next_lba), SZD::SZDStatus::Success);
+  write_head = next_lba;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, range, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_NE(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->GetOutstandingRequests(), 0);
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, AsyncRead) {
+  SZD::SZDDevice dev("AsyncRead");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel, false, 8);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // One lba for each reader
+  uint64_t range = info.lba_size * 8;
+  SZDTestUtil::RAIICharBuffer bufferw(range);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, range, 0);
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t write_head = begin_lba;
+  ASSERT_EQ(channel->DirectAppend(&write_head, bufferw.buff_, range, true),
+            SZD::SZDStatus::Success);
+
+  // Readers bounce normal memory...
+  SZDTestUtil::RAIICharBuffer bufferr(range);
+  for (uint32_t i = 0; i < 8; i++) {
+    ASSERT_EQ(channel->AsyncRead(begin_lba + i,
+                                 bufferr.buff_ + i * info.lba_size,
+                                 info.lba_size, i),
+              SZD::SZDStatus::Success);
+  }
+  ASSERT_EQ(channel->GetOutstandingRequests(), 8);
+  // A reader can not be reused before it completed
+  ASSERT_NE(channel->AsyncRead(begin_lba, bufferr.buff_, info.lba_size, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->GetOutstandingRequests(), 0);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, range) == 0);
+
+  // ...and read into DMA memory as is, also non-alligned
+  SZD::SZDBuffer bufferd(range, info.lba_size);
+  char *raw_bufferd = nullptr;
+  ASSERT_EQ(bufferd.GetBuffer((void **)&raw_bufferd), SZD::SZDStatus::Success);
+  uint32_t reader;
+  ASSERT_TRUE(channel->FindFreeWriter(&reader));
+  ASSERT_EQ(channel->AsyncRead(begin_lba, raw_bufferd, range, reader),
+            SZD::SZDStatus::Success);
+  ASSERT_TRUE(channel->FindFreeWriter(&reader));
+  ASSERT_EQ(channel->AsyncRead(begin_lba, bufferr.buff_, info.lba_size + 1,
+                               reader, false),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_TRUE(memcmp(bufferw.buff_, raw_bufferd, range) == 0);
+  ASSERT_TRUE(memcmp(bufferw.buff_, bufferr.buff_, info.lba_size + 1) == 0);
+
+  // Reads can not cross zones
+  ASSERT_NE(channel->AsyncRead(begin_lba + info.zone_cap - 1, bufferr.buff_,
+                               info.lba_size * 2, 0),
+            SZD::SZDStatus::Success);
+#ifdef SZD_PERF_COUNTERS
+  ASSERT_EQ(channel->GetReadOperationsCounter(), 10);
+#endif
+
+  factory.unregister_channel(channel);
+}
+
+TEST_F(SZDChannelTest, AsyncError) {
+  SZD::SZDDevice dev("AsyncError");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  SZD::SZDChannelFactory factory(dev.GetDeviceManager(), 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel, false, 2);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  // Appends to a full zone fail on the device.
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  ASSERT_EQ(channel->FinishZone(begin_lba), SZD::SZDStatus::Success);
+  SZDTestUtil::RAIICharBuffer bufferw(info.lba_size);
+  SZDTestUtil::CreateCyclicPattern(bufferw.buff_, info.lba_size, 0);
+  uint64_t write_head = begin_lba;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, info.lba_size, 0),
+            SZD::SZDStatus::Success);
+  // The failed writer is freed by a poll, Sync still reports it once.
+  while (!channel->PollOnce(0u))
+    ;
+  ASSERT_EQ(channel->GetOutstandingRequests(), 0);
+  ASSERT_NE(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+
+  // Appends the device places elsewhere than expected fail too, as when
+  // parts are reordered. Here the write head is ahead of the empty zone.
+  write_head = begin_lba + info.zone_cap + 1;
+  ASSERT_EQ(channel->AsyncAppend(&write_head, bufferw.buff_, info.lba_size, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_NE(channel->Sync(), SZD::SZDStatus::Success);
+
+  factory.unregister_channel(channel);
+}
+
+// Only the emulator rejects reads larger than its MDTS, an SSD may serve them.
+#ifdef SZD_TEST_EMU
+// Overstates the MDTS of a device, restored when it goes out of scope (also on
+// a failed assert).
+struct OverstatedMdts {
+  OverstatedMdts(SZD::DeviceManager *manager)
+      : manager_(manager), mdts_(manager->info.mdts) {
+    manager_->info.mdts = 2 * mdts_;
+  }
+  ~OverstatedMdts() { manager_->info.mdts = mdts_; }
+  SZD::DeviceManager *manager_;
+  uint64_t mdts_;
+};
+
+TEST_F(SZDChannelTest, AsyncReadError) {
+  SZD::SZDDevice dev("AsyncReadError");
+  SZD::DeviceInfo info;
+  SZDTestUtil::SZDSetupDevice(begin_zone, end_zone, &dev, &info);
+  // Mock reads that fail on the device, by overstating its MDTS.
+  SZD::DeviceManager *manager = dev.GetDeviceManager();
+  OverstatedMdts overstated(manager);
+  SZD::SZDChannelFactory factory(manager, 1);
+  SZD::SZDChannel *channel;
+  factory.register_channel(&channel, false, 2);
+  ASSERT_EQ(channel->ResetAllZones(), SZD::SZDStatus::Success);
+
+  uint64_t begin_lba = begin_zone * info.zone_cap;
+  uint64_t range = info.mdts + info.lba_size;
+  SZDTestUtil::RAIICharBuffer bufferr(range);
+  memset(bufferr.buff_, 0x5a, range);
+  ASSERT_EQ(channel->AsyncRead(begin_lba, bufferr.buff_, range, 0),
+            SZD::SZDStatus::Success);
+  while (!channel->PollOnce(0u))
+    ;
+  // The buffer is left as is and the failure is kept for Sync.
+  ASSERT_EQ(bufferr.buff_[0], 0x5a);
+  ASSERT_NE(channel->Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->Sync(), SZD::SZDStatus::Success);
+
+  factory.unregister_channel(channel);
+}
+#endif
+
 TEST_F(SZDChannelTest, MaxZoneHeads) {
   SZD::SZDDevice dev("MaxZoneHeads");
   SZD::DeviceInfo info;
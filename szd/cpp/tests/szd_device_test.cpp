@@ -2,12 +2,17 @@
 #include <szd/szd_device.hpp>
 #include <szd/szd_status.hpp>
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 
 namespace {
 
 class SZDTest : public ::testing::Test {};
 
+// Tests that probe and open SSDs, there are none when testing emulated.
+#ifndef SZD_TEST_EMU
 TEST_F(SZDTest, OpenAndClosing) {
   SZD::SZDDevice dev("OpenAndClosing");
   ASSERT_EQ(dev.Init(), SZD::SZDStatus::Success);
@@ -122,4 +127,271 @@ TEST_F(SZDTest, TestValidInfo) {
   ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
 }
 
+TEST_F(SZDTest, ProbeThenOpen) {
+  SZD::SZDDevice dev("ProbeThenOpen");
+  ASSERT_EQ(dev.Init(), SZD::SZDStatus::Success);
+  std::vector<SZD::DeviceOpenInfo> info;
+  ASSERT_EQ(dev.Probe(info), SZD::SZDStatus::Success);
+  // Probing again detaches what the first probe attached, and reinits.
+  info.clear();
+  ASSERT_EQ(dev.Probe(info), SZD::SZDStatus::Success);
+  std::string device_to_use = "None";
+  for (auto it = info.begin(); it != info.end(); it++) {
+    if (it->is_zns) {
+      device_to_use.assign(it->traddr);
+    }
+  }
+  // Opens the attached controller, the device info comes with the first qpair.
+  ASSERT_EQ(dev.Open(device_to_use, 10, 15), SZD::SZDStatus::Success);
+  SZD::DeviceInfo dinfo;
+  ASSERT_EQ(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+  ASSERT_GT(dinfo.zone_cap, 0);
+  SZD::DeviceInfo queried;
+  ASSERT_EQ(szd_get_device_info(&queried, dev.GetDeviceManager()),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(queried.zone_cap, dinfo.zone_cap);
+  SZD::QPair *qpair;
+  ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+            SZD::SZD_SC_SUCCESS);
+  uint64_t write_head;
+  ASSERT_EQ(szd_get_zone_head(qpair, dinfo.min_lba, &write_head),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+  // The other probed devices are still attached, they can not be released
+  // while the device is open.
+  ASSERT_NE(dev.Probe(info), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  // Closed devices are no longer attached, so they are probed again.
+  ASSERT_EQ(dev.Open(device_to_use), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  // And after the Reinit of a new probe, opened from the probe again.
+  info.clear();
+  ASSERT_EQ(dev.Probe(info), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Open(device_to_use), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+}
+
+TEST_F(SZDTest, OpenTransport) {
+  SZD::SZDDevice dev("OpenTransport");
+  ASSERT_EQ(dev.Init(), SZD::SZDStatus::Success);
+  std::vector<SZD::DeviceOpenInfo> info;
+  ASSERT_EQ(dev.Probe(info), SZD::SZDStatus::Success);
+  std::string device_to_use = "None";
+  for (auto it = info.begin(); it != info.end(); it++) {
+    if (it->is_zns) {
+      device_to_use.assign(it->traddr);
+    }
+  }
+  // Nothing listens on the port, and the transport ID is malformed.
+  ASSERT_NE(dev.Open("trtype:TCP adrfam:IPv4 traddr:127.0.0.1 trsvcid:1 "
+                     "subnqn:nqn.2016-06.io.spdk:none"),
+            SZD::SZDStatus::Success);
+  ASSERT_NE(dev.Open("trtype:NONE traddr:" + device_to_use),
+            SZD::SZDStatus::Success);
+
+  // The PCIe device as a transport ID, its qpairs use the transport's options
+  SZD::TransportOptions transport = SZD::TransportOptions_default;
+  transport.qpair.io_queue_size = 0x40;
+  ASSERT_EQ(dev.Open("trtype:PCIe traddr:" + device_to_use, 10, 15, transport),
+            SZD::SZDStatus::Success);
+  SZD::QPair *qpair;
+  ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_LE(qpair->options.io_queue_size, 0x40u);
+  ASSERT_GE(qpair->options.io_queue_requests, qpair->options.io_queue_size);
+  ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+}
+
+// Needs an NVMe/TCP target on the loopback that exports a ZNS namespace (e.g.
+// SPDK's nvmf_tgt), its transport ID is passed in SZD_TEST_TCP_TRID.
+TEST_F(SZDTest, OpenTransportLoopback) {
+  const char *tcp_trid = getenv("SZD_TEST_TCP_TRID");
+  if (tcp_trid == nullptr) {
+    return;
+  }
+  // The same transport ID with an upper-case trtype key that uses '='.
+  std::string trid(tcp_trid);
+  size_t key = trid.find("trtype:");
+  ASSERT_NE(key, std::string::npos);
+  std::string spelled =
+      trid.substr(0, key) + "TRTYPE=" + trid.substr(key + strlen("trtype:"));
+
+  SZD::SZDDevice dev("OpenTransportLoopback");
+  ASSERT_EQ(dev.Init(), SZD::SZDStatus::Success);
+  for (const std::string &t : {trid, spelled}) {
+    // Probing PCIe for the address would not find it.
+    ASSERT_EQ(dev.Open(t, 10, 15), SZD::SZDStatus::Success);
+    SZD::DeviceInfo dinfo;
+    ASSERT_EQ(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+    SZD::QPair *qpair;
+    ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+              SZD::SZD_SC_SUCCESS);
+    ASSERT_EQ(szd_reset_all(qpair), SZD::SZD_SC_SUCCESS);
+    char *buffer = (char *)SZD::szd_calloc(dinfo.lba_size, dinfo.lba_size, 1);
+    memset(buffer, 0xEF, dinfo.lba_size);
+    uint64_t head = dinfo.min_lba;
+    ASSERT_EQ(szd_append(qpair, &head, buffer, dinfo.lba_size),
+              SZD::SZD_SC_SUCCESS);
+    ASSERT_EQ(head, dinfo.min_lba + 1);
+    memset(buffer, 0, dinfo.lba_size);
+    ASSERT_EQ(szd_read(qpair, dinfo.min_lba, buffer, dinfo.lba_size),
+              SZD::SZD_SC_SUCCESS);
+    for (uint64_t i = 0; i < dinfo.lba_size; i++) {
+      ASSERT_EQ((unsigned char)buffer[i], 0xEF);
+    }
+    SZD::szd_free(buffer);
+    ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+    ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  }
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+}
+
+TEST_F(SZDTest, OpenGroup) {
+  SZD::SZDDevice dev("OpenGroup");
+  ASSERT_EQ(dev.Init(), SZD::SZDStatus::Success);
+  std::vector<SZD::DeviceOpenInfo> info;
+  ASSERT_EQ(dev.Probe(info), SZD::SZDStatus::Success);
+  std::vector<std::string> devices;
+  for (auto it = info.begin(); it != info.end(); it++) {
+    if (it->is_zns) {
+      devices.push_back(it->traddr);
+    }
+  }
+  ASSERT_NE(dev.OpenGroup({}), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.OpenGroup(devices, 10, 15), SZD::SZDStatus::Success);
+  ASSERT_NE(dev.OpenGroup(devices, 10, 15), SZD::SZDStatus::Success);
+
+  // The group is one device with the zones of all members
+  SZD::DeviceInfo dinfo;
+  ASSERT_EQ(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+  ASSERT_GT(dinfo.lba_size, 0);
+  ASSERT_GT(dinfo.mdts, 0);
+  ASSERT_GT(dinfo.zasl, 0);
+  ASSERT_GT(dinfo.zone_cap, 0);
+  ASSERT_EQ(dinfo.lba_cap % (devices.size() * dinfo.zone_size), 0u);
+  ASSERT_EQ(dinfo.min_lba, 10 * dinfo.zone_size);
+  ASSERT_EQ(dinfo.max_lba, 15 * dinfo.zone_size);
+
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  ASSERT_NE(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+}
+#endif
+
+TEST_F(SZDTest, OpenEmulated) {
+  SZD::SZDDevice dev("OpenEmulated");
+  ASSERT_EQ(dev.Init(true), SZD::SZDStatus::Success);
+  SZD::EmuOptions options = SZD::EmuOptions_default;
+  options.nr_zones = 0x10;
+  std::string path = ::testing::TempDir() + "szd_open_emulated";
+  std::remove(path.data());
+  options.path = path.data();
+  ASSERT_EQ(dev.OpenEmulated(options, 10, 15), SZD::SZDStatus::Success);
+  ASSERT_NE(dev.OpenEmulated(options, 10, 15), SZD::SZDStatus::Success);
+
+  // The device has the geometry it is given
+  SZD::DeviceInfo dinfo;
+  ASSERT_EQ(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+  ASSERT_EQ(dinfo.lba_size, options.lba_size);
+  ASSERT_EQ(dinfo.zone_size, options.zone_size);
+  ASSERT_EQ(dinfo.zone_cap, options.zone_cap);
+  ASSERT_EQ(dinfo.lba_cap, options.nr_zones * options.zone_size);
+  ASSERT_EQ(dinfo.min_lba, 10 * dinfo.zone_size);
+  ASSERT_EQ(dinfo.max_lba, 15 * dinfo.zone_size);
+
+  // Data and write pointers of a file backed device survive a close
+  SZD::QPair *qpair;
+  ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+            SZD::SZD_SC_SUCCESS);
+  char *buffer = (char *)SZD::szd_calloc(dinfo.lba_size, dinfo.lba_size, 1);
+  memset(buffer, 0xAB, dinfo.lba_size);
+  uint64_t head = dinfo.min_lba;
+  ASSERT_EQ(szd_append(qpair, &head, buffer, dinfo.lba_size),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(head, dinfo.min_lba + 1);
+  ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+
+  ASSERT_EQ(dev.OpenEmulated(options, 10, 15), SZD::SZDStatus::Success);
+  ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(szd_get_zone_head(qpair, dinfo.min_lba, &head),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(head, dinfo.min_lba + 1);
+  memset(buffer, 0, dinfo.lba_size);
+  ASSERT_EQ(szd_read(qpair, dinfo.min_lba, buffer, dinfo.lba_size),
+            SZD::SZD_SC_SUCCESS);
+  for (uint64_t i = 0; i < dinfo.lba_size; i++) {
+    ASSERT_EQ((unsigned char)buffer[i], 0xAB);
+  }
+  SZD::szd_free(buffer);
+  ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+  std::remove(path.data());
+}
+
+#ifdef SZD_BDEV
+TEST_F(SZDTest, OpenBdev) {
+  // A zoned bdev on top of a malloc bdev, set up from an SPDK JSON config.
+  std::string config = ::testing::TempDir() + "szd_open_bdev.json";
+  FILE *file = fopen(config.data(), "w");
+  ASSERT_NE(file, nullptr);
+  fputs(R"({"subsystems": [{"subsystem": "bdev", "config": [
+    {"method": "bdev_malloc_create",
+     "params": {"name": "Malloc0", "num_blocks": 32768, "block_size": 4096}},
+    {"method": "bdev_zone_block_create",
+     "params": {"name": "Zoned0", "base_bdev": "Malloc0",
+                "zone_capacity": 2048, "optimal_open_zones": 4}}]}]})",
+        file);
+  fclose(file);
+  SZD::SZDDevice dev("OpenBdev");
+  ASSERT_EQ(dev.Init(true, config), SZD::SZDStatus::Success);
+  ASSERT_NE(dev.OpenBdev("NoBdev"), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.OpenBdev("Zoned0", 2, 6), SZD::SZDStatus::Success);
+  ASSERT_NE(dev.OpenBdev("Zoned0", 2, 6), SZD::SZDStatus::Success);
+
+  SZD::DeviceInfo dinfo;
+  ASSERT_EQ(dev.GetInfo(&dinfo), SZD::SZDStatus::Success);
+  ASSERT_EQ(dinfo.lba_size, 4096u);
+  ASSERT_EQ(dinfo.zone_size, 2048u);
+  ASSERT_EQ(dinfo.zone_cap, 2048u);
+  ASSERT_EQ(dinfo.lba_cap, 32768u);
+  ASSERT_GT(dinfo.mdts, 0u);
+  ASSERT_GT(dinfo.zasl, 0u);
+  ASSERT_EQ(dinfo.min_lba, 2 * dinfo.zone_size);
+  ASSERT_EQ(dinfo.max_lba, 6 * dinfo.zone_size);
+
+  // The same calls as for an SSD
+  SZD::QPair *qpair;
+  ASSERT_EQ(szd_create_qpair(dev.GetDeviceManager(), &qpair),
+            SZD::SZD_SC_SUCCESS);
+  char *buffer = (char *)SZD::szd_calloc(dinfo.lba_size, dinfo.lba_size, 2);
+  memset(buffer, 0xCD, 2 * dinfo.lba_size);
+  uint64_t head = dinfo.min_lba;
+  ASSERT_EQ(szd_append(qpair, &head, buffer, 2 * dinfo.lba_size),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(head, dinfo.min_lba + 2);
+  ASSERT_EQ(szd_get_zone_head(qpair, dinfo.min_lba, &head),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(head, dinfo.min_lba + 2);
+  memset(buffer, 0, 2 * dinfo.lba_size);
+  ASSERT_EQ(szd_read(qpair, dinfo.min_lba, buffer, 2 * dinfo.lba_size),
+            SZD::SZD_SC_SUCCESS);
+  for (uint64_t i = 0; i < 2 * dinfo.lba_size; i++) {
+    ASSERT_EQ((unsigned char)buffer[i], 0xCD);
+  }
+  ASSERT_EQ(szd_reset_all(qpair), SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(szd_get_zone_head(qpair, dinfo.min_lba, &head),
+            SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(head, dinfo.min_lba);
+  SZD::szd_free(buffer);
+  ASSERT_EQ(szd_destroy_qpair(qpair), SZD::SZD_SC_SUCCESS);
+  ASSERT_EQ(dev.Close(), SZD::SZDStatus::Success);
+  ASSERT_EQ(dev.Destroy(), SZD::SZDStatus::Success);
+  std::remove(config.data());
+}
+#endif
+
 } // namespace
\ No newline at end of file
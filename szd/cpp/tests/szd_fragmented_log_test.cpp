@@ -229,4 +229,38 @@ TEST_F(SZDTest, MultipleWritersFragmentedLogFragmentingTest) {
             SZD::SZDStatus::Success);
 }
 
+TEST_F(SZDTest, FreelistPartialFreeTest) {
+  SZD::SZDFreeList *freelist;
+  SZD::SZDFreeListFunctions::Init(&freelist, begin_zone, end_zone);
+  std::vector<std::pair<uint64_t, uint64_t>> regions;
+  ASSERT_EQ(SZD::SZDFreeListFunctions::AllocZones(regions, &freelist, 4),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(regions.size(), 1u);
+
+  // Free the last zones of the region only, as a partially failed reset does.
+  SZD::SZDFreeList *region;
+  ASSERT_EQ(
+      SZD::SZDFreeListFunctions::FindRegion(begin_zone, freelist, &region),
+      SZD::SZDStatus::Success);
+  SZD::SZDFreeListFunctions::SplitRegion(region, 1);
+  SZD::SZDFreeList *tail = SZD::SZDFreeListFunctions::NextZoneRegion(region);
+  ASSERT_TRUE(tail->used_);
+  ASSERT_EQ(tail->begin_zone_, begin_zone + 1);
+  ASSERT_EQ(tail->zones_, 3u);
+  SZD::SZDFreeListFunctions::FreeZones(tail, &freelist);
+
+  // The freed zones merge with the free remainder, the failed zone stays used.
+  SZD::SZDFreeList *first =
+      SZD::SZDFreeListFunctions::FirstZoneRegion(freelist);
+  ASSERT_TRUE(first->used_);
+  ASSERT_EQ(first->zones_, 1u);
+  SZD::SZDFreeList *rest = SZD::SZDFreeListFunctions::NextZoneRegion(first);
+  ASSERT_NE(rest, nullptr);
+  ASSERT_FALSE(rest->used_);
+  ASSERT_EQ(rest->begin_zone_, begin_zone + 1);
+  ASSERT_EQ(rest->zones_, end_zone - begin_zone - 1);
+  ASSERT_EQ(SZD::SZDFreeListFunctions::NextZoneRegion(rest), nullptr);
+  SZD::SZDFreeListFunctions::Destroy(freelist);
+}
+
 } // namespace
@@ -279,6 +279,19 @@ TEST_F(SZDTest, OnceLogAsyncTest) {
     }
     // We can sync to ensure persistence
     ASSERT_EQ(log.Sync(), SZD::SZDStatus::Success);
+
+    // Writes larger than ZASL are split over multiple writers
+    size_t large_range = info.zasl + info.lba_size;
+    SZDTestUtil::RAIICharBuffer bufflw(large_range);
+    SZDTestUtil::RAIICharBuffer bufflr(large_range);
+    SZDTestUtil::CreateCyclicPattern(bufflw.buff_, large_range, 0);
+    uint64_t head = log.GetWriteHead();
+    ASSERT_EQ(log.AsyncAppend(bufflw.buff_, large_range, nullptr, true),
+              SZD::SZDStatus::Success);
+    ASSERT_EQ(log.Sync(), SZD::SZDStatus::Success);
+    ASSERT_EQ(log.Read(head, bufflr.buff_, large_range, true),
+              SZD::SZDStatus::Success);
+    ASSERT_TRUE(memcmp(bufflw.buff_, bufflr.buff_, large_range) == 0);
   }
   factory->unregister_channel(channel[0]);
   factory->Unref();
@@ -3,8 +3,15 @@
 #include <szd/szd_status.hpp>
 
 namespace SZDTestUtil {
+// Tests run on the first ZNS device, or on an emulated device when built with
+// SZD_TEST_EMU (TESTING_EMULATED).
 static void SZDSetupDevice(uint64_t min_zone, uint64_t max_zone,
                            SZD::SZDDevice *device, SZD::DeviceInfo *dinfo) {
+#ifdef SZD_TEST_EMU
+  ASSERT_EQ(device->Init(true), SZD::SZDStatus::Success);
+  ASSERT_EQ(device->OpenEmulated(SZD::EmuOptions_default, min_zone, max_zone),
+            SZD::SZDStatus::Success);
+#else
   ASSERT_EQ(device->Init(), SZD::SZDStatus::Success);
   std::vector<SZD::DeviceOpenInfo> info;
   ASSERT_EQ(device->Probe(info), SZD::SZDStatus::Success);
@@ -18,7 +25,38 @@ static void SZDSetupDevice(uint64_t min_zone, uint64_t max_zone,
   }
   ASSERT_EQ(device->Open(device_to_use, min_zone, max_zone),
             SZD::SZDStatus::Success);
+#endif
+  ASSERT_EQ(device->GetInfo(dinfo), SZD::SZDStatus::Success);
+}
+
+// Opens all ZNS devices as one device group.
+static void SZDSetupDeviceGroup(uint64_t min_zone, uint64_t max_zone,
+                                SZD::SZDDevice *device, SZD::DeviceInfo *dinfo,
+                                size_t *members) {
+#ifdef SZD_TEST_EMU
+  // Two emulated devices, so that zones really are interleaved.
+  ASSERT_EQ(device->Init(true), SZD::SZDStatus::Success);
+  std::vector<SZD::EmuOptions> emu_options(2, SZD::EmuOptions_default);
+  *members = emu_options.size();
+  ASSERT_EQ(device->OpenGroupEmulated(emu_options, min_zone, max_zone),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(device->GetInfo(dinfo), SZD::SZDStatus::Success);
+#else
+  ASSERT_EQ(device->Init(), SZD::SZDStatus::Success);
+  std::vector<SZD::DeviceOpenInfo> info;
+  ASSERT_EQ(device->Probe(info), SZD::SZDStatus::Success);
+  std::vector<std::string> devices_to_use;
+  for (auto it = info.begin(); it != info.end(); it++) {
+    if (it->is_zns && devices_to_use.size() < MAX_GROUP_DEVICES) {
+      devices_to_use.push_back(it->traddr);
+      printf("using device at traddr %s \n", it->traddr.data());
+    }
+  }
+  *members = devices_to_use.size();
+  ASSERT_EQ(device->OpenGroup(devices_to_use, min_zone, max_zone),
+            SZD::SZDStatus::Success);
   ASSERT_EQ(device->GetInfo(dinfo), SZD::SZDStatus::Success);
+#endif
 }
 
 void CreateCyclicPattern(char *arr, size_t range, uint64_t jump) {
@@ -11,35 +11,46 @@
 #include <cmath>
 #include <sys/time.h>
 
+// Usage: reset_perf [traddr|emu] [fill]. "emu" measures an emulated device
+// in memory, which needs no SSD, hugepages or root.
 int main(int argc, char **argv) {
   std::string device_to_use = argc <= 1 ? "" : argv[1];
   bool fill = argc <= 2 ? false : std::string(argv[2]) == "1";
+  bool emulated = device_to_use == "emu";
 
   // Setup SZD
   SZD::SZDDevice dev("ResetPerfTest");
-  dev.Init();
-  // Probe devices
-  std::string picked_device;
-  std::vector<SZD::DeviceOpenInfo> devices_available;
-  dev.Probe(devices_available);
-  for (auto it = devices_available.begin(); it != devices_available.end();
-       it++) {
-    if (device_to_use != "" && it->traddr != device_to_use) {
-      continue;
+  dev.Init(emulated);
+  if (emulated) {
+    printf("Using an emulated device\n");
+    if (dev.OpenEmulated(SZD::EmuOptions_default) != SZD::SZDStatus::Success) {
+      printf("ERROR: Could not open an emulated device\n");
+      return 1;
     }
-    if (it->is_zns) {
-      picked_device.assign(it->traddr);
-      break;
+  } else {
+    // Probe devices
+    std::string picked_device;
+    std::vector<SZD::DeviceOpenInfo> devices_available;
+    dev.Probe(devices_available);
+    for (auto it = devices_available.begin(); it != devices_available.end();
+         it++) {
+      if (device_to_use != "" && it->traddr != device_to_use) {
+        continue;
+      }
+      if (it->is_zns) {
+        picked_device.assign(it->traddr);
+        break;
+      }
     }
+    // Check picked device is found
+    if (picked_device == "") {
+      printf("ERROR: No suitable device found\n");
+      return 1;
+    }
+    printf("Using device %s \n", picked_device.data());
+    // Open the device for usage
+    dev.Open(picked_device);
   }
-  // Check picked device is found
-  if (picked_device == "") {
-    printf("ERROR: No suitable device found\n");
-    return 1;
-  }
-  printf("Using device %s \n", picked_device.data());
-  // Open the device for usage
-  dev.Open(picked_device);
   // Get device info
   SZD::DeviceInfo info;
   dev.GetInfo(&info);
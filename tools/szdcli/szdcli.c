@@ -24,7 +24,9 @@ int min_uint64_t(uint64_t l1, uint64_t l2) { return l1 < l2 ? l1 : l2; }
 int print_help_util() {
   fprintf(
       stdout,
-      "szdcli [options]\n"
+      "szdcli [-e] [options]\n"
+      " -e      use an emulated device, <trid> is the file that holds it (it "
+      "is created with the default geometry if it does not exist)\n"
       "options:\n"
       " probe   get trid from all devices and ZNS indicators\n"
       " info    get device information (sizes etc.)\n"
@@ -66,6 +68,19 @@ void print_disclaimer() {
       " The tool will also only work properly with NVMe ZNS devices only\n");
 }
 
+// Opens the device at the trid of the context, or the emulated device in the
+// file at trid.
+int open_device(CliContext *cli_context) {
+  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
+  if (cli_context->dev_options.emulated) {
+    EmuOptions emu_options = EmuOptions_default;
+    emu_options.path = cli_context->target_trid;
+    return szd_open_emu(*cli_context->dev_manager, &emu_options, &ooptions);
+  }
+  return szd_open(*cli_context->dev_manager, cli_context->target_trid,
+                  &ooptions);
+}
+
 int parse_reset_zns(int argc, char **argv, CliContext *cli_context) {
   // Parse and setup args
   bool trid_set = false;
@@ -96,10 +111,8 @@ int parse_reset_zns(int argc, char **argv, CliContext *cli_context) {
   }
 
   // Open device and verify args for device
-  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
   int szd_rc;
-  if ((szd_rc = szd_open(*cli_context->dev_manager, cli_context->target_trid,
-                         &ooptions))) {
+  if ((szd_rc = open_device(cli_context))) {
     fprintf(stderr, "Reset request: Invalid trid %s\n",
             cli_context->target_trid);
     return ERROR_STATE;
@@ -169,10 +182,8 @@ int parse_read_zns(int argc, char **argv, CliContext *cli_context) {
   }
 
   // Open device and verify args for device
-  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
   int szd_rc;
-  if ((szd_rc = szd_open(*cli_context->dev_manager, cli_context->target_trid,
-                         &ooptions))) {
+  if ((szd_rc = open_device(cli_context))) {
     fprintf(stderr, "Read request: Invalid trid %s\n",
             cli_context->target_trid);
     return ERROR_STATE;
@@ -277,10 +288,8 @@ int parse_append_zns(int argc, char **argv, CliContext *cli_context) {
   }
 
   // Open device and verify args for device
-  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
   int szd_rc;
-  if ((szd_rc = szd_open(*cli_context->dev_manager, cli_context->target_trid,
-                         &ooptions))) {
+  if ((szd_rc = open_device(cli_context))) {
     fprintf(stderr, "Append request: Invalid trid %s\n",
             cli_context->target_trid);
     free(data);
@@ -398,10 +407,8 @@ int parse_info_zns(int argc, char **argv, CliContext *cli_context) {
   }
 
   // Open device
-  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
   int szd_rc;
-  if ((szd_rc = szd_open(*cli_context->dev_manager, cli_context->target_trid,
-                         &ooptions))) {
+  if ((szd_rc = open_device(cli_context))) {
     fprintf(stderr, "Info command: Invalid trid %s or not a ZNS device\n",
             cli_context->target_trid);
     return 1;
@@ -443,10 +450,8 @@ int parse_zones_zns(int argc, char **argv, CliContext *cli_context) {
   }
 
   // Open device
-  DeviceOpenOptions ooptions = DeviceOpenOptions_default;
   int szd_rc;
-  if ((szd_rc = szd_open(*cli_context->dev_manager, cli_context->target_trid,
-                         &ooptions))) {
+  if ((szd_rc = open_device(cli_context))) {
     fprintf(stderr, "Zones request: Invalid trid %s\n",
             cli_context->target_trid);
     return ERROR_STATE;
@@ -494,10 +499,12 @@ int parse_help_zns(int argc, char **argv, CliContext *cli_context) {
   return print_help_util();
 }
 
-CliContext new_cli_context(void) {
+CliContext new_cli_context(bool emulated) {
   CliContext context = {
       .dev_manager = (DeviceManager **)calloc(1, sizeof(DeviceManager)),
-      .dev_options = {.name = "znscli", .setup_spdk = true},
+      .dev_options = {.name = "znscli",
+                      .setup_spdk = true,
+                      .emulated = emulated},
       .target_trid = (char *)calloc(MAX_TRADDR_LENGTH + 1, sizeof(char *))};
   return context;
 }
@@ -537,6 +544,11 @@ int parse_args_zns(int argc, char **argv, CliContext *cli_context) {
 
 int main(int argc, char **argv) {
   print_disclaimer();
+  bool emulated = argc > 1 && strcmp(argv[1], "-e") == 0;
+  if (emulated) {
+    argc--;
+    argv++;
+  }
   if (argc < 2) {
     fprintf(stderr, "Not enough args provided\n");
     print_help_util();
@@ -544,7 +556,7 @@ int main(int argc, char **argv) {
   }
 
   // Setup SZD context
-  CliContext context = new_cli_context();
+  CliContext context = new_cli_context(emulated);
   int szd_rc;
   if ((szd_rc = szd_init(context.dev_manager, &context.dev_options))) {
     fprintf(stderr, "Failed to create context. Are you running as root?\n");